@@ -87,6 +87,11 @@ class AtomicIntegerT : boost::noncopyable
     return __sync_lock_test_and_set(&value_, newValue);
   }
 
+  T compareAndSwap(T expected, T newValue)//value等于expected时设为newValue，返回原来的值
+  {
+    return __sync_val_compare_and_swap(&value_, expected, newValue);
+  }
+
  private:
   volatile T value_;//volatile关键词的意思是，每次读取value_值时，都是从该地址，而不是暂存的寄存器中读取
 };
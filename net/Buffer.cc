@@ -9,6 +9,7 @@
 
 #include <muduo/net/Buffer.h>
 
+#include <muduo/base/ThreadLocalSingleton.h>
 #include <muduo/net/SocketsOps.h>
 
 #include <errno.h>
@@ -22,6 +23,18 @@ const char Buffer::kCRLF[] = "\r\n";
 const size_t Buffer::kCheapPrepend;
 const size_t Buffer::kInitialSize;
 
+namespace
+{
+
+// 每个线程一块64K的读缓冲区，所有Buffer共用，
+// 空闲连接不必为读操作保留任何内存
+struct ReadArea
+{
+  char data[65536];
+};
+
+}
+
 // 结合栈上的空间，避免内存使用过大，提高内存使用率
 // 如果有5K个连接，每个连接就分配64K+64K的缓冲区的话，将占用640M内存，
 // 而大多数时候，这些缓冲区的使用率很低
@@ -30,7 +43,8 @@ ssize_t Buffer::readFd(int fd, int* savedErrno)
 {
   // saved an ioctl()/FIONREAD call to tell how much to read
   // 节省一次ioctl系统调用，因为最大的TCP包也可以装的下，所以就不需要ioctl查看fd有多少数据可读了
-  char extrabuf[65536];
+  char* extrabuf = ThreadLocalSingleton<ReadArea>::instance().data;
+  const size_t extraSize = sizeof(ReadArea);
   struct iovec vec[2];
   const size_t writable = writableBytes();//可以写的空间
   // 第一块缓冲区，指向可写空间
@@ -38,7 +52,7 @@ ssize_t Buffer::readFd(int fd, int* savedErrno)
   vec[0].iov_len = writable;
   // 第二块缓冲区，指向栈上空间
   vec[1].iov_base = extrabuf;
-  vec[1].iov_len = sizeof extrabuf;
+  vec[1].iov_len = extraSize;
   const ssize_t n = sockets::readv(fd, vec, 2);//将fd的内容读取到buffer_数组和extrabuf数组中
   if (n < 0)
   {
@@ -50,7 +64,7 @@ ssize_t Buffer::readFd(int fd, int* savedErrno)
   }
   else		// 当前缓冲区，不够容纳，因而数据被接收到了第二块缓冲区extrabuf，将其append至buffer
   {
-    writerIndex_ = buffer_.size();
+    writerIndex_ = capacity_;
     append(extrabuf, n - writable);
   }
   // if (n == writable + sizeof extrabuf)
@@ -15,10 +15,11 @@
 #include <muduo/base/StringPiece.h>
 #include <muduo/base/Types.h>
 
+#include <muduo/net/BufferAllocator.h>
+#include <muduo/net/ByteScan.h>
 #include <muduo/net/Endian.h>
 
 #include <algorithm>
-#include <vector>
 
 #include <assert.h>
 #include <string.h>
@@ -45,21 +46,42 @@ class Buffer : public muduo::copyable
   static const size_t kCheapPrepend = 8;//默认预留8个字节，这8个字节是不会存放数据的
   static const size_t kInitialSize = 1024;//初始大小
 
-  Buffer()
-    : buffer_(kCheapPrepend + kInitialSize),//刚开始默认创建一个1024+8的缓冲区
+  explicit Buffer(size_t initialSize = kInitialSize)
+    : capacity_(kCheapPrepend + initialSize),//刚开始默认创建一个1024+8的缓冲区
+      buffer_(BufferAllocator::allocate(&capacity_)),
       readerIndex_(kCheapPrepend),
       writerIndex_(kCheapPrepend)
   {
     assert(readableBytes() == 0);
-    assert(writableBytes() == kInitialSize);
+    assert(writableBytes() >= initialSize);
     assert(prependableBytes() == kCheapPrepend);
   }
 
-  // default copy-ctor, dtor and assignment are fine
+  Buffer(const Buffer& rhs)
+    : capacity_(rhs.capacity_),
+      buffer_(BufferAllocator::allocate(&capacity_)),
+      readerIndex_(rhs.readerIndex_),
+      writerIndex_(rhs.writerIndex_)
+  {
+    ::memcpy(begin()+readerIndex_, rhs.peek(), rhs.readableBytes());
+  }
+
+  ~Buffer()
+  {
+    BufferAllocator::deallocate(buffer_);
+  }
+
+  Buffer& operator=(const Buffer& rhs)
+  {
+    Buffer copy(rhs);
+    swap(copy);
+    return *this;
+  }
 
   void swap(Buffer& rhs)//交换buffer_和rhs
   {
-    buffer_.swap(rhs.buffer_);
+    std::swap(capacity_, rhs.capacity_);
+    std::swap(buffer_, rhs.buffer_);
     std::swap(readerIndex_, rhs.readerIndex_);
     std::swap(writerIndex_, rhs.writerIndex_);
   }
@@ -68,7 +90,7 @@ class Buffer : public muduo::copyable
   { return writerIndex_ - readerIndex_; }
 
   size_t writableBytes() const//返回可写大小
-  { return buffer_.size() - writerIndex_; }
+  { return capacity_ - writerIndex_; }
 
   size_t prependableBytes() const//返回预留区域+已经读完的数据的大小
   { return readerIndex_; }
@@ -78,16 +100,26 @@ class Buffer : public muduo::copyable
 
   const char* findCRLF() const//在可读数据中查找结尾符
   {
-    const char* crlf = std::search(peek(), beginWrite(), kCRLF, kCRLF+2);
-    return crlf == beginWrite() ? NULL : crlf;
+    return scan::findCRLF(peek(), beginWrite());
   }
 
   const char* findCRLF(const char* start) const//从指定的start位置开始，到写位置处中查找结尾符
   {
     assert(peek() <= start);
     assert(start <= beginWrite());
-    const char* crlf = std::search(start, beginWrite(), kCRLF, kCRLF+2);
-    return crlf == beginWrite() ? NULL : crlf;
+    return scan::findCRLF(start, beginWrite());
+  }
+
+  const char* findEOL() const//在可读数据中查找\n
+  {
+    return scan::findEOL(peek(), beginWrite());
+  }
+
+  const char* findEOL(const char* start) const
+  {
+    assert(peek() <= start);
+    assert(start <= beginWrite());
+    return scan::findEOL(start, beginWrite());
   }
 
   // retrieve returns void, to prevent
@@ -113,6 +145,11 @@ class Buffer : public muduo::copyable
     retrieve(end - peek());
   }
   //处理读写指针
+  void retrieveInt64()
+  {
+    retrieve(sizeof(int64_t));
+  }
+
   void retrieveInt32()
   {
     retrieve(sizeof(int32_t));
@@ -160,7 +197,7 @@ class Buffer : public muduo::copyable
   void append(const char* /*restrict*/ data, size_t len)//data是要添加的字符串指针，添加字符串的长度
   {
     ensureWritableBytes(len);
-    std::copy(data, data+len, beginWrite());
+    ::memcpy(beginWrite(), data, len);
     hasWritten(len);
   }
 
@@ -188,10 +225,25 @@ class Buffer : public muduo::copyable
   void hasWritten(size_t len)//在写完len个指针之后改变writerIndex_的值到对应位置
   { writerIndex_ += len; }
 
+  void unwrite(size_t len)//撤销最后写入的len个字节
+  {
+    assert(len <= readableBytes());
+    writerIndex_ -= len;
+  }
+
   ///
-  /// Append int32_t using network endian
+  /// Append int64_t using network endian
   ///
   //添加数据的封装
+  void appendInt64(int64_t x)
+  {
+    int64_t be64 = sockets::hostToNetwork64(x);
+    append(&be64, sizeof be64);
+  }
+
+  ///
+  /// Append int32_t using network endian
+  ///
   void appendInt32(int32_t x)
   {
     int32_t be32 = sockets::hostToNetwork32(x);
@@ -209,11 +261,22 @@ class Buffer : public muduo::copyable
     append(&x, sizeof x);
   }
 
+  ///
+  /// Read int64_t from network endian
+  ///
+  /// Require: buf->readableBytes() >= sizeof(int64_t)
+  //读数据的封装，包括读数据和处理读指针
+  int64_t readInt64()
+  {
+    int64_t result = peekInt64();
+    retrieveInt64();
+    return result;
+  }
+
   ///
   /// Read int32_t from network endian
   ///
   /// Require: buf->readableBytes() >= sizeof(int32_t)
-  //读数据的封装，包括读数据和处理读指针
   int32_t readInt32()
   {
     int32_t result = peekInt32();
@@ -235,6 +298,18 @@ class Buffer : public muduo::copyable
     return result;
   }
 
+  ///
+  /// Peek int64_t from network endian
+  ///
+  /// Require: buf->readableBytes() >= sizeof(int64_t)
+  int64_t peekInt64() const//读64位数据
+  {
+    assert(readableBytes() >= sizeof(int64_t));
+    int64_t be64 = 0;
+    ::memcpy(&be64, peek(), sizeof be64);
+    return sockets::networkToHost64(be64);
+  }
+
   ///
   /// Peek int32_t from network endian
   ///
@@ -262,6 +337,15 @@ class Buffer : public muduo::copyable
     return x;
   }
 
+  ///
+  /// Prepend int64_t using network endian
+  ///
+  void prependInt64(int64_t x)//向已读区域中放入64位数据
+  {
+    int64_t be64 = sockets::hostToNetwork64(x);
+    prepend(&be64, sizeof be64);
+  }
+
   ///
   /// Prepend int32_t using network endian
   ///
@@ -293,33 +377,46 @@ class Buffer : public muduo::copyable
   // 收缩，保留reserve个字节+buffer_中可读的字节
   void shrink(size_t reserve)
   {
-    // FIXME: use vector::shrink_to_fit() in C++ 11 if possible.
-    Buffer other;
-    other.ensureWritableBytes(readableBytes()+reserve);//为了other创造reserve个字节+buffer_中可读的字节
+    Buffer other(readableBytes()+reserve);//为了other创造reserve个字节+buffer_中可读的字节
     other.append(toStringPiece());//这就是把可读的内容拷贝到other数组中去
     swap(other);//将buffer_和other交换，相当于就收缩了buffer_数组
   }
 
+  size_t internalCapacity() const
+  {
+    return capacity_;
+  }
+
   /// Read data directly into buffer.
   ///
   /// It may implement with readv(2)
+  /// Bytes that don't fit go to a read area shared by all buffers
+  /// of the calling thread, then are appended.
   /// @return result of read(2), @c errno is saved
   ssize_t readFd(int fd, int* savedErrno);//从文件描述符中把数据读到缓冲区中
 
  private:
 
   char* begin()//得到缓冲区的首地址
-  { return &*buffer_.begin(); }
+  { return buffer_; }
 
   const char* begin() const//得到buffer_的头指针
-  { return &*buffer_.begin(); }
+  { return buffer_; }
 
   void makeSpace(size_t len)//为len个字节创建空间
   {
     if (writableBytes() + prependableBytes() < len + kCheapPrepend)//确保可写空间+预留空间+已读空间<待写空间+预留空间
     {
-      // FIXME: move readable data
-      buffer_.resize(writerIndex_+len);//扩充vector数组
+      // 新的内存不清零，只拷贝可读的数据，顺便把它们挪到前面
+      size_t readable = readableBytes();
+      size_t newCapacity = std::max(capacity_*2, kCheapPrepend+readable+len);
+      char* newBuffer = BufferAllocator::allocate(&newCapacity);
+      ::memcpy(newBuffer+kCheapPrepend, peek(), readable);
+      BufferAllocator::deallocate(buffer_);
+      buffer_ = newBuffer;
+      capacity_ = newCapacity;
+      readerIndex_ = kCheapPrepend;
+      writerIndex_ = readerIndex_ + readable;
     }
     else//如果可以依靠内部腾挪就装得下
     {
@@ -336,7 +433,8 @@ class Buffer : public muduo::copyable
   }
 
  private:
-  std::vector<char> buffer_;	// vector用于替代固定大小数组，就相当于字符串数组
+  size_t capacity_;
+  char* buffer_;	// 由BufferAllocator分配，不做初始化
   size_t readerIndex_;			// 读位置
   size_t writerIndex_;			// 写位置
 
@@ -0,0 +1,367 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include <muduo/net/BufferAllocator.h>
+
+#include <muduo/base/Atomic.h>
+#include <muduo/base/Logging.h>
+#include <muduo/base/Mutex.h>
+#include <muduo/net/Buffer.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+// 小于这个大小的请求（比如没有存储空间的Buffer）直接走malloc
+const size_t kMinSlabRequest = 512;
+// 每个线程每一级最多缓存的字节数
+const size_t kMaxCachedBytesPerClass = 4*1024*1024;
+
+class ThreadCache;
+
+// 每个内存块前面的头部，16字节，保证数据部分的对齐
+struct BlockHeader
+{
+  ThreadCache* owner;   // NULL if from malloc(3) directly
+  size_t sizeClass;
+};
+
+// 空闲块的数据部分用来串成单链表
+struct FreeNode
+{
+  FreeNode* next;
+};
+
+const size_t kSizeClasses[BufferAllocator::kNumSizeClasses] =
+{
+  Buffer::kCheapPrepend + 1024,
+  Buffer::kCheapPrepend + 4*1024,
+  Buffer::kCheapPrepend + 16*1024,
+  Buffer::kCheapPrepend + 64*1024,
+  Buffer::kCheapPrepend + 256*1024,
+  Buffer::kCheapPrepend + 1024*1024,
+};
+
+const size_t kNotCached = BufferAllocator::kNumSizeClasses;
+
+BufferAllocator::Policy g_policy = BufferAllocator::kHeap;
+
+char* payloadOf(BlockHeader* header)
+{
+  return reinterpret_cast<char*>(header + 1);
+}
+
+BlockHeader* headerOf(char* block)
+{
+  return reinterpret_cast<BlockHeader*>(block) - 1;
+}
+
+FreeNode* nodeOf(BlockHeader* header)
+{
+  return reinterpret_cast<FreeNode*>(payloadOf(header));
+}
+
+BlockHeader* headerOf(FreeNode* node)
+{
+  return headerOf(reinterpret_cast<char*>(node));
+}
+
+BlockHeader* mallocBlock(ThreadCache* owner, size_t sizeClass, size_t usable)
+{
+  void* p = ::malloc(sizeof(BlockHeader) + usable);
+  if (p == NULL)
+  {
+    LOG_SYSFATAL << "BufferAllocator - malloc " << usable;
+  }
+  BlockHeader* header = static_cast<BlockHeader*>(p);
+  header->owner = owner;
+  header->sizeClass = sizeClass;
+  return header;
+}
+
+void freeList(FreeNode* node)
+{
+  while (node)
+  {
+    FreeNode* next = node->next;
+    ::free(headerOf(node));
+    node = next;
+  }
+}
+
+///
+/// Size-class free lists of one thread.
+///
+/// Blocks freed by the owner thread go to the local lists without locking,
+/// blocks freed by other threads are handed back through remote_.
+class ThreadCache : boost::noncopyable
+{
+ public:
+  ThreadCache()
+    : exited_(false)
+  {
+    for (size_t i = 0; i < kNotCached; ++i)
+    {
+      free_[i] = NULL;
+      freeCount_[i] = 0;
+      remote_[i] = NULL;
+    }
+  }
+
+  char* allocate(size_t sizeClass)
+  {
+    assert(sizeClass < kNotCached);
+    if (free_[sizeClass] == NULL)
+    {
+      reclaimRemote();
+    }
+    BlockHeader* header = NULL;
+    if (free_[sizeClass])
+    {
+      FreeNode* node = free_[sizeClass];
+      free_[sizeClass] = node->next;
+      --freeCount_[sizeClass];
+      header = headerOf(node);
+    }
+    else
+    {
+      header = mallocBlock(this, sizeClass, kSizeClasses[sizeClass]);
+    }
+    outstanding_.increment();
+    return payloadOf(header);
+  }
+
+  // in owner thread
+  void deallocateLocal(BlockHeader* header)
+  {
+    assert(header->owner == this);
+    outstanding_.decrement();
+    pushLocal(header);
+  }
+
+  // in any other thread
+  void deallocateRemote(BlockHeader* header)
+  {
+    assert(header->owner == this);
+    bool last = false;
+    {
+      MutexLockGuard lock(mutex_);
+      if (exited_)
+      {
+        ::free(header);
+        last = outstanding_.decrementAndGet() == 0;
+      }
+      else
+      {
+        FreeNode* node = nodeOf(header);
+        node->next = remote_[header->sizeClass];
+        remote_[header->sizeClass] = node;
+        outstanding_.decrement();
+      }
+    }
+    if (last)
+    {
+      delete this;
+    }
+  }
+
+  // owner thread is exiting, the cache lives on until
+  // all its outstanding blocks are returned.
+  void exit()
+  {
+    bool last = false;
+    {
+      MutexLockGuard lock(mutex_);
+      exited_ = true;
+      for (size_t i = 0; i < kNotCached; ++i)
+      {
+        freeList(free_[i]);
+        free_[i] = NULL;
+        freeCount_[i] = 0;
+        freeList(remote_[i]);
+        remote_[i] = NULL;
+      }
+      last = outstanding_.get() == 0;
+    }
+    if (last)
+    {
+      delete this;
+    }
+  }
+
+  size_t cachedBlocks() const
+  {
+    size_t n = 0;
+    for (size_t i = 0; i < kNotCached; ++i)
+    {
+      n += freeCount_[i];
+    }
+    return n;
+  }
+
+ private:
+  void pushLocal(BlockHeader* header)
+  {
+    size_t sizeClass = header->sizeClass;
+    if ((freeCount_[sizeClass]+1) * kSizeClasses[sizeClass] <= kMaxCachedBytesPerClass)
+    {
+      FreeNode* node = nodeOf(header);
+      node->next = free_[sizeClass];
+      free_[sizeClass] = node;
+      ++freeCount_[sizeClass];
+    }
+    else
+    {
+      ::free(header);
+    }
+  }
+
+  void reclaimRemote()
+  {
+    FreeNode* remote[kNotCached];
+    {
+      MutexLockGuard lock(mutex_);
+      for (size_t i = 0; i < kNotCached; ++i)
+      {
+        remote[i] = remote_[i];
+        remote_[i] = NULL;
+      }
+    }
+    for (size_t i = 0; i < kNotCached; ++i)
+    {
+      FreeNode* node = remote[i];
+      while (node)
+      {
+        FreeNode* next = node->next;
+        pushLocal(headerOf(node));
+        node = next;
+      }
+    }
+  }
+
+  FreeNode* free_[kNotCached];
+  size_t freeCount_[kNotCached];
+  MutexLock mutex_;
+  FreeNode* remote_[kNotCached];  // @GuardedBy mutex_
+  bool exited_;                   // @GuardedBy mutex_
+  AtomicInt64 outstanding_;       // blocks handed out and not yet returned
+};
+
+__thread ThreadCache* t_cache = NULL;
+
+pthread_key_t g_exitKey;
+pthread_once_t g_exitKeyOnce = PTHREAD_ONCE_INIT;
+
+void onThreadExit(void* cache)
+{
+  assert(cache == t_cache);
+  t_cache = NULL;
+  static_cast<ThreadCache*>(cache)->exit();
+}
+
+void createExitKey()
+{
+  pthread_key_create(&g_exitKey, &onThreadExit);
+}
+
+ThreadCache* threadCache()
+{
+  if (t_cache == NULL)
+  {
+    pthread_once(&g_exitKeyOnce, &createExitKey);
+    t_cache = new ThreadCache;
+    pthread_setspecific(g_exitKey, t_cache);
+  }
+  return t_cache;
+}
+
+size_t findSizeClass(size_t size)
+{
+  if (size < kMinSlabRequest)
+  {
+    return kNotCached;
+  }
+  for (size_t i = 0; i < kNotCached; ++i)
+  {
+    if (size <= kSizeClasses[i])
+    {
+      return i;
+    }
+  }
+  return kNotCached;
+}
+
+}
+
+const int BufferAllocator::kNumSizeClasses;
+
+void BufferAllocator::setPolicy(Policy policy)
+{
+  __sync_synchronize();
+  g_policy = policy;
+  __sync_synchronize();
+}
+
+BufferAllocator::Policy BufferAllocator::policy()
+{
+  return g_policy;
+}
+
+size_t BufferAllocator::sizeClass(int index)
+{
+  assert(0 <= index && index < kNumSizeClasses);
+  return kSizeClasses[index];
+}
+
+char* BufferAllocator::allocate(size_t* size)
+{
+  if (g_policy == kThreadCache)
+  {
+    size_t sizeClass = findSizeClass(*size);
+    if (sizeClass != kNotCached)
+    {
+      *size = kSizeClasses[sizeClass];
+      return threadCache()->allocate(sizeClass);
+    }
+  }
+  return payloadOf(mallocBlock(NULL, kNotCached, *size));
+}
+
+void BufferAllocator::deallocate(char* block)
+{
+  if (block == NULL)
+  {
+    return;
+  }
+  BlockHeader* header = headerOf(block);
+  if (header->owner == NULL)
+  {
+    ::free(header);
+  }
+  else if (header->owner == t_cache)
+  {
+    header->owner->deallocateLocal(header);
+  }
+  else
+  {
+    header->owner->deallocateRemote(header);
+  }
+}
+
+size_t BufferAllocator::cachedBlocksInThisThread()
+{
+  return t_cache ? t_cache->cachedBlocks() : 0;
+}
@@ -0,0 +1,59 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+/*Buffer的存储分配策略，默认直接用malloc，也可以切换为每个线程一个按大小分级的slab缓存，
+ *被其他线程释放的内存块会归还给分配它的线程*/
+#ifndef MUDUO_NET_BUFFERALLOCATOR_H
+#define MUDUO_NET_BUFFERALLOCATOR_H
+
+#include <stddef.h>
+
+namespace muduo
+{
+namespace net
+{
+
+///
+/// Storage policy of Buffer.
+///
+/// Memory is never zero-filled, Buffer only copies its readable bytes
+/// when it grows.
+class BufferAllocator
+{
+ public:
+  enum Policy
+  {
+    kHeap,          // malloc(3)/free(3)
+    kThreadCache,   // per-thread size-class slabs
+  };
+
+  /// Takes effect for subsequent allocations, blocks allocated under
+  /// the other policy are still freed correctly.
+  /// Thread safe.
+  static void setPolicy(Policy policy);
+  static Policy policy();
+
+  /// Returns uninitialised storage of at least @c *size bytes,
+  /// @c *size is updated to the usable size of the block.
+  static char* allocate(size_t* size);
+  static void deallocate(char* block);
+
+  /// Usable sizes of the slab classes, 1K/4K/16K/64K/256K/1M plus
+  /// Buffer::kCheapPrepend, so that a default Buffer fits the first one.
+  static const int kNumSizeClasses = 6;
+  static size_t sizeClass(int index);
+
+  /// Blocks cached by the calling thread, for tests and benchmarks.
+  static size_t cachedBlocksInThisThread();
+};
+
+}
+}
+
+#endif  // MUDUO_NET_BUFFERALLOCATOR_H
@@ -0,0 +1,69 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include <muduo/net/BufferPool.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const size_t BufferPool::kDefaultMaxFree;
+
+BufferPool::BufferPool(size_t maxFree)
+  : free_(maxFree, Buffer(0)),	// 一次建好所有的槽，之后存取都是swap，不再拷贝Buffer
+    freeCount_(0)
+{
+}
+
+BufferPool::~BufferPool()
+{
+}
+
+void BufferPool::acquire(Buffer* buf)
+{
+  if (hasStorage(*buf))
+  {
+    return;
+  }
+  assert(buf->readableBytes() == 0);
+  if (freeCount_ > 0)
+  {
+    buf->swap(free_[--freeCount_]);
+  }
+  else
+  {
+    Buffer fresh;
+    buf->swap(fresh);
+  }
+  assert(hasStorage(*buf));
+}
+
+void BufferPool::release(Buffer* buf)
+{
+  assert(buf->readableBytes() == 0);
+  if (!hasStorage(*buf))
+  {
+    return;
+  }
+  const size_t kDefaultCapacity = Buffer::kCheapPrepend + Buffer::kInitialSize;
+  const bool defaultSized = buf->internalCapacity() >= kDefaultCapacity
+                         && buf->internalCapacity() < 2*kDefaultCapacity;
+  if (defaultSized && freeCount_ < free_.size())
+  {
+    // 槽里空的Buffer换给buf
+    Buffer& slot = free_[freeCount_++];
+    slot.swap(*buf);
+    slot.retrieveAll();
+  }
+  else
+  {
+    // 容量不是默认大小（比如曾经扩充过），直接释放
+    Buffer empty(0);
+    buf->swap(empty);
+  }
+  assert(!hasStorage(*buf));
+}
@@ -0,0 +1,58 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is an internal header file, you should not include this.
+/*每个EventLoop一个缓冲区池，低内存模式下的TcpConnection只在有数据收发时才从池中借用Buffer的存储空间，
+ *数据处理完就归还，这样空闲连接几乎不占用缓冲区内存*/
+#ifndef MUDUO_NET_BUFFERPOOL_H
+#define MUDUO_NET_BUFFERPOOL_H
+
+#include <muduo/net/Buffer.h>
+
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+namespace muduo
+{
+namespace net
+{
+
+///
+/// Per-loop cache of Buffer storage.
+///
+/// Not thread safe, always used in the owner loop's thread.
+class BufferPool : boost::noncopyable
+{
+ public:
+  static const size_t kDefaultMaxFree = 64;
+
+  explicit BufferPool(size_t maxFree = kDefaultMaxFree);
+  ~BufferPool();
+
+  /// Gives @c buf storage of the default size, if it has none.
+  void acquire(Buffer* buf);
+
+  /// Takes the storage of an empty @c buf, leaving it without storage.
+  /// Oversized storage is freed instead of pooled.
+  void release(Buffer* buf);
+
+  static bool hasStorage(const Buffer& buf)
+  { return buf.internalCapacity() > Buffer::kCheapPrepend; }
+
+  size_t freeCount() const { return freeCount_; }
+
+ private:
+  // 前freeCount_个有存储空间，后面的槽放着没有存储空间的Buffer
+  std::vector<Buffer> free_;
+  size_t freeCount_;
+};
+
+}
+}
+
+#endif  // MUDUO_NET_BUFFERPOOL_H
@@ -0,0 +1,392 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include <muduo/net/ByteScan.h>
+
+#include <assert.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MUDUO_BYTESCAN_X86 1
+#include <immintrin.h>
+#endif
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+const char* findCRLFScalar(const char* begin, const char* end)
+{
+  for (const char* p = begin; p + 1 < end; ++p)
+  {
+    if (p[0] == '\r' && p[1] == '\n')
+    {
+      return p;
+    }
+  }
+  return NULL;
+}
+
+const char* findEOLScalar(const char* begin, const char* end)
+{
+  for (const char* p = begin; p < end; ++p)
+  {
+    if (*p == '\n')
+    {
+      return p;
+    }
+  }
+  return NULL;
+}
+
+const char* findFirstOfScalar(const char* begin, const char* end,
+                              const char* delimiters, size_t n)
+{
+  // 不足4个的用第一个补齐，省掉内层循环
+  const char d0 = delimiters[0];
+  const char d1 = n > 1 ? delimiters[1] : d0;
+  const char d2 = n > 2 ? delimiters[2] : d0;
+  const char d3 = n > 3 ? delimiters[3] : d0;
+  for (const char* p = begin; p < end; ++p)
+  {
+    const char c = *p;
+    if (c == d0 || c == d1 || c == d2 || c == d3)
+    {
+      return p;
+    }
+  }
+  return NULL;
+}
+
+#ifdef MUDUO_BYTESCAN_X86
+
+// x86_64都支持SSE2，i386上看编译选项
+#ifdef __SSE2__
+
+// 下面的*Mask16()各看p开始的16个字节，返回命中位置的位图。
+// 末尾不足16字节时，只要整段够长，就把最后一块和前一块重叠着再看一次，
+// 重叠部分前面已经确认没有命中，不会找错
+
+// 第二次加载错开一个字节，两个比较结果相与就是\r\n的位置，不用处理跨块的进位，
+// 要求p[16]可读
+inline int crlfMask16(const char* p)
+{
+  __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+  __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1));
+  return _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, _mm_set1_epi8('\r')),
+                                         _mm_cmpeq_epi8(b, _mm_set1_epi8('\n'))));
+}
+
+inline int eolMask16(const char* p)
+{
+  __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(a, _mm_set1_epi8('\n')));
+}
+
+inline int firstOfMask16(const char* p, const char* delimiters, size_t n)
+{
+  __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+  __m128i eq = _mm_cmpeq_epi8(a, _mm_set1_epi8(delimiters[0]));
+  for (size_t i = 1; i < n; ++i)
+  {
+    eq = _mm_or_si128(eq, _mm_cmpeq_epi8(a, _mm_set1_epi8(delimiters[i])));
+  }
+  return _mm_movemask_epi8(eq);
+}
+
+const char* findCRLFSse2(const char* begin, const char* end)
+{
+  const char* p = begin;
+  while (end - p >= 17)
+  {
+    int mask = crlfMask16(p);
+    if (mask != 0)
+    {
+      return p + __builtin_ctz(mask);
+    }
+    p += 16;
+  }
+  if (p != end && end - begin >= 17)
+  {
+    p = end - 17;
+    int mask = crlfMask16(p);
+    return mask != 0 ? p + __builtin_ctz(mask) : NULL;
+  }
+  return findCRLFScalar(p, end);
+}
+
+const char* findEOLSse2(const char* begin, const char* end)
+{
+  const char* p = begin;
+  while (end - p >= 16)
+  {
+    int mask = eolMask16(p);
+    if (mask != 0)
+    {
+      return p + __builtin_ctz(mask);
+    }
+    p += 16;
+  }
+  if (p != end && end - begin >= 16)
+  {
+    p = end - 16;
+    int mask = eolMask16(p);
+    return mask != 0 ? p + __builtin_ctz(mask) : NULL;
+  }
+  return findEOLScalar(p, end);
+}
+
+const char* findFirstOfSse2(const char* begin, const char* end,
+                            const char* delimiters, size_t n)
+{
+  const char* p = begin;
+  while (end - p >= 16)
+  {
+    int mask = firstOfMask16(p, delimiters, n);
+    if (mask != 0)
+    {
+      return p + __builtin_ctz(mask);
+    }
+    p += 16;
+  }
+  if (p != end && end - begin >= 16)
+  {
+    p = end - 16;
+    int mask = firstOfMask16(p, delimiters, n);
+    return mask != 0 ? p + __builtin_ctz(mask) : NULL;
+  }
+  return findFirstOfScalar(p, end, delimiters, n);
+}
+
+// 短于这个长度时AVX2反而慢：HTTP请求的各行都很短，实测整个解析比SSE2慢一倍多
+const ptrdiff_t kMinAvx2Length = 256;
+
+// 32字节版本，要求p[32]可读
+__attribute__((target("avx2")))
+inline unsigned crlfMask32(const char* p)
+{
+  __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+  __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 1));
+  return static_cast<unsigned>(_mm256_movemask_epi8(
+      _mm256_and_si256(_mm256_cmpeq_epi8(a, _mm256_set1_epi8('\r')),
+                       _mm256_cmpeq_epi8(b, _mm256_set1_epi8('\n')))));
+}
+
+__attribute__((target("avx2")))
+inline unsigned eolMask32(const char* p)
+{
+  __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+  return static_cast<unsigned>(_mm256_movemask_epi8(
+      _mm256_cmpeq_epi8(a, _mm256_set1_epi8('\n'))));
+}
+
+__attribute__((target("avx2")))
+inline unsigned firstOfMask32(const char* p, const __m256i* delims, size_t n)
+{
+  __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+  __m256i eq = _mm256_cmpeq_epi8(a, delims[0]);
+  for (size_t i = 1; i < n; ++i)
+  {
+    eq = _mm256_or_si256(eq, _mm256_cmpeq_epi8(a, delims[i]));
+  }
+  return static_cast<unsigned>(_mm256_movemask_epi8(eq));
+}
+
+// 短的交给SSE2版本，见kMinAvx2Length。
+// 末尾不足一块的和前一块重叠着看
+__attribute__((target("avx2")))
+const char* findCRLFAvx2(const char* begin, const char* end)
+{
+  if (end - begin < kMinAvx2Length)
+  {
+    return findCRLFSse2(begin, end);
+  }
+  const char* p = begin;
+  while (end - p >= 33)
+  {
+    unsigned mask = crlfMask32(p);
+    if (mask != 0)
+    {
+      return p + __builtin_ctz(mask);
+    }
+    p += 32;
+  }
+  if (p + 1 < end)
+  {
+    p = end - 33;
+    unsigned mask = crlfMask32(p);
+    return mask != 0 ? p + __builtin_ctz(mask) : NULL;
+  }
+  return NULL;
+}
+
+__attribute__((target("avx2")))
+const char* findEOLAvx2(const char* begin, const char* end)
+{
+  if (end - begin < kMinAvx2Length)
+  {
+    return findEOLSse2(begin, end);
+  }
+  const char* p = begin;
+  while (end - p >= 32)
+  {
+    unsigned mask = eolMask32(p);
+    if (mask != 0)
+    {
+      return p + __builtin_ctz(mask);
+    }
+    p += 32;
+  }
+  if (p != end)
+  {
+    p = end - 32;
+    unsigned mask = eolMask32(p);
+    return mask != 0 ? p + __builtin_ctz(mask) : NULL;
+  }
+  return NULL;
+}
+
+__attribute__((target("avx2")))
+const char* findFirstOfAvx2(const char* begin, const char* end,
+                            const char* delimiters, size_t n)
+{
+  if (end - begin < kMinAvx2Length)
+  {
+    return findFirstOfSse2(begin, end, delimiters, n);
+  }
+  __m256i delims[scan::kMaxDelimiters];
+  for (size_t i = 0; i < n; ++i)
+  {
+    delims[i] = _mm256_set1_epi8(delimiters[i]);
+  }
+  const char* p = begin;
+  while (end - p >= 32)
+  {
+    unsigned mask = firstOfMask32(p, delims, n);
+    if (mask != 0)
+    {
+      return p + __builtin_ctz(mask);
+    }
+    p += 32;
+  }
+  if (p != end)
+  {
+    p = end - 32;
+    unsigned mask = firstOfMask32(p, delims, n);
+    return mask != 0 ? p + __builtin_ctz(mask) : NULL;
+  }
+  return NULL;
+}
+
+#endif  // __SSE2__
+#endif  // MUDUO_BYTESCAN_X86
+
+struct Kernels
+{
+  scan::Implementation impl;
+  const char* name;
+  const char* (*findCRLF)(const char*, const char*);
+  const char* (*findEOL)(const char*, const char*);
+  const char* (*findFirstOf)(const char*, const char*, const char*, size_t);
+};
+
+const Kernels kScalarKernels =
+  { scan::kScalar, "scalar", findCRLFScalar, findEOLScalar, findFirstOfScalar };
+
+#if defined(MUDUO_BYTESCAN_X86) && defined(__SSE2__)
+const Kernels kSse2Kernels =
+  { scan::kSse2, "sse2", findCRLFSse2, findEOLSse2, findFirstOfSse2 };
+const Kernels kAvx2Kernels =
+  { scan::kAvx2, "avx2", findCRLFAvx2, findEOLAvx2, findFirstOfAvx2 };
+// 常量初始化，其他编译单元的静态初始化中也能用
+const Kernels* g_kernels = &kSse2Kernels;
+#else
+const Kernels* g_kernels = &kScalarKernels;
+#endif
+
+bool cpuSupports(scan::Implementation impl)
+{
+  switch (impl)
+  {
+    case scan::kScalar:
+      return true;
+#if defined(MUDUO_BYTESCAN_X86) && defined(__SSE2__)
+    case scan::kSse2:
+      return true;
+    case scan::kAvx2:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx2");
+#endif
+    default:
+      return false;
+  }
+}
+
+// 启动时选用CPU支持的最快实现
+struct KernelSelector
+{
+  KernelSelector()
+  {
+    scan::setImplementation(scan::kAvx2);
+  }
+};
+
+KernelSelector selector;
+
+}
+
+const char* scan::findCRLF(const char* begin, const char* end)
+{
+  return g_kernels->findCRLF(begin, end);
+}
+
+const char* scan::findEOL(const char* begin, const char* end)
+{
+  return g_kernels->findEOL(begin, end);
+}
+
+const char* scan::findFirstOf(const char* begin, const char* end,
+                              const char* delimiters, size_t n)
+{
+  assert(1 <= n && n <= kMaxDelimiters);
+  return g_kernels->findFirstOf(begin, end, delimiters, n);
+}
+
+scan::Implementation scan::implementation()
+{
+  return g_kernels->impl;
+}
+
+const char* scan::implementationName()
+{
+  return g_kernels->name;
+}
+
+bool scan::setImplementation(Implementation impl)
+{
+  if (!cpuSupports(impl))
+  {
+    return false;
+  }
+  switch (impl)
+  {
+#if defined(MUDUO_BYTESCAN_X86) && defined(__SSE2__)
+    case kAvx2:
+      g_kernels = &kAvx2Kernels;
+      break;
+    case kSse2:
+      g_kernels = &kSse2Kernels;
+      break;
+#endif
+    default:
+      g_kernels = &kScalarKernels;
+      break;
+  }
+  return true;
+}
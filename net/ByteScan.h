@@ -0,0 +1,65 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+/* 在一段字节中查找\r\n、\n或者几个分隔符之一。x86上用SSE2/AVX2一次比较16/32个字节，
+ * 启动时按CPU支持的指令集选一套实现，其他平台用逐字节的实现。
+ */
+#ifndef MUDUO_NET_BYTESCAN_H
+#define MUDUO_NET_BYTESCAN_H
+
+#include <stddef.h>
+
+namespace muduo
+{
+namespace net
+{
+namespace scan
+{
+
+/// Kernels, the best one supported by the CPU is chosen at startup.
+enum Implementation
+{
+  kScalar,
+  kSse2,
+  kAvx2
+};
+
+/// Most delimiters findFirstOf() accepts.
+const size_t kMaxDelimiters = 4;
+
+/// First "\r\n" in [begin, end), or NULL.
+const char* findCRLF(const char* begin, const char* end);
+
+/// First '\n' in [begin, end), or NULL.
+const char* findEOL(const char* begin, const char* end);
+
+/// First byte in [begin, end) equal to one of the @c n bytes of
+/// @c delimiters, or NULL.  Requires 1 <= n <= kMaxDelimiters.
+const char* findFirstOf(const char* begin, const char* end,
+                        const char* delimiters, size_t n);
+
+/// First @c c in [begin, end), or @c end, like std::find.
+inline const char* find(const char* begin, const char* end, char c)
+{
+  const char* p = findFirstOf(begin, end, &c, 1);
+  return p ? p : end;
+}
+
+Implementation implementation();
+const char* implementationName();
+
+/// Switches kernels, for tests and benchmarks.  Returns false if the CPU
+/// doesn't support @c impl.  Not thread safe.
+bool setImplementation(Implementation impl);
+
+}
+}
+}
+
+#endif  // MUDUO_NET_BYTESCAN_H
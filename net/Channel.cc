@@ -104,7 +104,11 @@ void Channel::handleEventWithGuard(Timestamp receiveTime)
     LOG_WARN << "Channel::handle_event() POLLNVAL";
   }
 
-  if (revents_ & (POLLERR | POLLNVAL))//发生错误或者描述符不可打开
+  if ((revents_ & POLLERR) && errorQueueCallback_)//错误队列中可能有消息，如MSG_ZEROCOPY的完成通知
+  {
+    errorQueueCallback_();
+  }
+  else if (revents_ & (POLLERR | POLLNVAL))//发生错误或者描述符不可打开
   {
     if (errorCallback_) errorCallback_();
   }
@@ -51,6 +51,11 @@ class Channel : boost::noncopyable
   { closeCallback_ = cb; }
   void setErrorCallback(const EventCallback& cb)
   { errorCallback_ = cb; }//设置四种回调函数
+  /// If set, POLLERR is handed to this callback instead of the error
+  /// callback, for sockets expecting messages on their error queue
+  /// (MSG_ZEROCOPY completions).
+  void setErrorQueueCallback(const EventCallback& cb)
+  { errorQueueCallback_ = cb; }
 
   /// Tie this channel to the owner object managed by shared_ptr,
   /// prevent the owner object being destroyed in handleEvent.
@@ -63,11 +68,12 @@ class Channel : boost::noncopyable
   bool isNoneEvent() const { return events_ == kNoneEvent; }//判断事件是否为0，也就是没有关注的事件
 
   void enableReading() { events_ |= kReadEvent; update(); }//设置读事件，并将当前channel加入到poll队列当中
-  // void disableReading() { events_ &= ~kReadEvent; update(); }
+  void disableReading() { events_ &= ~kReadEvent; update(); }//停止关注读事件
   void enableWriting() { events_ |= kWriteEvent; update(); }//设置写事件，并将当前channel加入到poll队列当中
   void disableWriting() { events_ &= ~kWriteEvent; update(); }//关闭写事件，并将当前channel加入到poll队列当中
   void disableAll() { events_ = kNoneEvent; update(); }//关闭所有事件，并暂时删除当前channel
   bool isWriting() const { return events_ & kWriteEvent; }//是否关注写事件
+  bool isReading() const { return events_ & kReadEvent; }//是否关注读事件
 
   // for Poller
   int index() { return index_; }//返回序号
@@ -103,6 +109,7 @@ class Channel : boost::noncopyable
   EventCallback writeCallback_;//当文件描述符产生写事件时，最后调用的写函数，我将它命名为channel的写函数
   EventCallback closeCallback_;//当文件描述符产生关闭事件时，最后调用的关闭函数，我将它命名为channel的关闭函数
   EventCallback errorCallback_;//当文件描述符产生错误事件时，最后调用的错误函数,我将它命名为channel的错误函数
+  EventCallback errorQueueCallback_;//错误队列中有消息时调用，由它自己读错误队列
 };
 
 }
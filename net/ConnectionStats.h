@@ -0,0 +1,86 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+/*一个连接的流量统计，也用来汇总一个loop或者一个TcpServer的所有连接*/
+#ifndef MUDUO_NET_CONNECTIONSTATS_H
+#define MUDUO_NET_CONNECTIONSTATS_H
+
+#include <muduo/base/Timestamp.h>
+#include <muduo/base/Types.h>
+
+#include <algorithm>
+
+namespace muduo
+{
+namespace net
+{
+
+///
+/// Traffic counters of a connection, or the sum over many connections.
+///
+/// Counters are kept by TcpConnection in its loop thread, the tcpi*
+/// fields are sampled from TCP_INFO when a snapshot is taken.
+struct ConnectionStats
+{
+  ConnectionStats()
+    : connections(0),
+      bytesRead(0),
+      bytesWritten(0),
+      reads(0),
+      writes(0),
+      messages(0),
+      peakOutputBytes(0),
+      writeBlockedSeconds(0.0),
+      tcpiRttUs(0),
+      tcpiRttVarUs(0),
+      tcpiCwnd(0),
+      tcpiTotalRetrans(0)
+  { }
+
+  /// Adds @c rhs to the totals, peaks and times take the maximum.
+  /// The tcpi fields are summed, divide by connections for the mean.
+  void add(const ConnectionStats& rhs)
+  {
+    connections += rhs.connections;
+    bytesRead += rhs.bytesRead;
+    bytesWritten += rhs.bytesWritten;
+    reads += rhs.reads;
+    writes += rhs.writes;
+    messages += rhs.messages;
+    peakOutputBytes = std::max(peakOutputBytes, rhs.peakOutputBytes);
+    writeBlockedSeconds += rhs.writeBlockedSeconds;
+    if (lastActivity < rhs.lastActivity)
+    {
+      lastActivity = rhs.lastActivity;
+    }
+    tcpiRttUs += rhs.tcpiRttUs;
+    tcpiRttVarUs += rhs.tcpiRttVarUs;
+    tcpiCwnd += rhs.tcpiCwnd;
+    tcpiTotalRetrans += rhs.tcpiTotalRetrans;
+  }
+
+  int64_t connections;
+  int64_t bytesRead;
+  int64_t bytesWritten;
+  int64_t reads;		// 读到数据的read次数
+  int64_t writes;		// 写出数据的write次数
+  int64_t messages;		// countMessage()的调用次数，协议层每解出一条消息调用一次
+  int64_t peakOutputBytes;	// 待发送数据的峰值
+  double writeBlockedSeconds;	// 有数据等着POLLOUT的累计时间
+  Timestamp lastActivity;
+  int64_t tcpiRttUs;
+  int64_t tcpiRttVarUs;
+  int64_t tcpiCwnd;		// 拥塞窗口，单位是MSS
+  int64_t tcpiTotalRetrans;
+};
+
+}
+}
+
+#endif  // MUDUO_NET_CONNECTIONSTATS_H
@@ -9,7 +9,9 @@
 #include <muduo/net/EventLoop.h>
 
 #include <muduo/base/Logging.h>
+#include <muduo/net/BufferPool.h>
 #include <muduo/net/Channel.h>
+#include <muduo/net/IdleWheel.h>
 #include <muduo/net/Poller.h>
 #include <muduo/net/TimerQueue.h>
 
@@ -71,6 +73,8 @@ EventLoop::EventLoop()//构造函数，初始化所有的私有成员变量
     threadId_(CurrentThread::tid()),
     poller_(Poller::newDefaultPoller(this)),
     timerQueue_(new TimerQueue(this)),
+    bufferPool_(new BufferPool),
+    idleWheel_(new IdleWheel(this)),
     wakeupFd_(createEventfd()),
     wakeupChannel_(new Channel(this, wakeupFd_)),
     currentActiveChannel_(NULL)
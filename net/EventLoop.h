@@ -27,7 +27,9 @@ namespace muduo
 namespace net
 {
 
+class BufferPool;
 class Channel;
+class IdleWheel;
 class Poller;
 class TimerQueue;
 ///
@@ -105,6 +107,14 @@ class EventLoop : boost::noncopyable
 
   bool eventHandling() const { return eventHandling_; }
 
+  /// Buffer storage shared by connections of this loop.
+  /// Must be used in the loop thread.
+  BufferPool* bufferPool() { return get_pointer(bufferPool_); }
+
+  /// Closes idle connections of this loop, see TcpConnection::setIdleTimeout().
+  /// Must be used in the loop thread.
+  IdleWheel* idleWheel() { return get_pointer(idleWheel_); }
+
   static EventLoop* getEventLoopOfCurrentThread();
 
  private:
@@ -124,6 +134,8 @@ class EventLoop : boost::noncopyable
   Timestamp pollReturnTime_;
   boost::scoped_ptr<Poller> poller_;//poller_指针虽然是Poller类，但是初始化时，是初始化的Poller的子类
   boost::scoped_ptr<TimerQueue> timerQueue_;
+  boost::scoped_ptr<BufferPool> bufferPool_;	// 低内存模式下的连接从这里借用缓冲区
+  boost::scoped_ptr<IdleWheel> idleWheel_;		// 本loop中设置了空闲超时的连接
   int wakeupFd_;				// 用于eventfd，通过createEventfd创建出来的
   // unlike in TimerQueue, which is an internal class,
   // we don't expose Channel to client.
@@ -70,3 +70,13 @@ EventLoop* EventLoopThreadPool::getNextLoop()
   return loop;
 }
 
+std::vector<EventLoop*> EventLoopThreadPool::getAllLoops()
+{
+  baseLoop_->assertInLoopThread();
+  if (loops_.empty())
+  {
+    return std::vector<EventLoop*>(1, baseLoop_);
+  }
+  return loops_;
+}
+
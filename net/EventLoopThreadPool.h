@@ -39,6 +39,10 @@ class EventLoopThreadPool : boost::noncopyable
   void start(const ThreadInitCallback& cb = ThreadInitCallback());//这个cb是赋值给EventLoopThread::callback_
   EventLoop* getNextLoop();//按照轮用的机制，拿出一个eventloop出来
 
+  /// All loops handling connections, the base loop if there are no threads.
+  /// Must be called in base loop thread.
+  std::vector<EventLoop*> getAllLoops();
+
  private:
 
   EventLoop* baseLoop_;	// 与Acceptor所属EventLoop相同
@@ -0,0 +1,92 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include <muduo/net/IdleWheel.h>
+
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/TcpConnection.h>
+
+#include <boost/bind.hpp>
+
+#include <math.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int IdleWheel::kNumBuckets;
+
+IdleWheel::IdleWheel(EventLoop* loop)
+  : loop_(loop),
+    buckets_(kNumBuckets),
+    current_(0),
+    started_(false),
+    size_(0)
+{
+}
+
+IdleWheel::~IdleWheel()
+{
+}
+
+void IdleWheel::add(const TcpConnectionPtr& conn)
+{
+  loop_->assertInLoopThread();
+  if (!started_)
+  {
+    started_ = true;
+    // 随EventLoop一起销毁，不用取消
+    loop_->runEvery(1.0, boost::bind(&IdleWheel::onTick, this));
+  }
+  schedule(conn, conn->idleTimeout());
+  ++size_;
+}
+
+// 挂到delay秒之后的格子上，超过一圈的挂到最远的一格，到时再算
+void IdleWheel::schedule(const boost::weak_ptr<TcpConnection>& conn, double delay)
+{
+  int ticks = static_cast<int>(ceil(delay));
+  if (ticks < 1)
+  {
+    ticks = 1;
+  }
+  else if (ticks > kNumBuckets - 1)
+  {
+    ticks = kNumBuckets - 1;
+  }
+  buckets_[(current_ + ticks) % kNumBuckets].push_back(conn);
+}
+
+void IdleWheel::onTick()
+{
+  current_ = (current_ + 1) % kNumBuckets;
+  Bucket due;
+  due.swap(buckets_[current_]);
+  Timestamp now(Timestamp::now());
+  for (Bucket::iterator it = due.begin(); it != due.end(); ++it)
+  {
+    TcpConnectionPtr conn(it->lock());
+    if (!conn || !conn->connected())
+    {
+      --size_;
+      continue;
+    }
+    double idle = timeDifference(now, conn->lastActivity());
+    if (idle >= conn->idleTimeout())
+    {
+      --size_;
+      conn->closeIdle();
+    }
+    else
+    {
+      schedule(*it, conn->idleTimeout() - idle);
+    }
+  }
+  // 留着vector的容量给下一圈用
+  due.clear();
+  due.swap(buckets_[current_]);
+}
@@ -0,0 +1,67 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is an internal header file, you should not include this.
+/*每个EventLoop一个时间轮，每秒转一格。连接只登记一次，收发数据时只更新连接自己的lastActivity，
+ *转到某一格时才检查这一格里的连接：空闲够久的关闭，其余的按剩余时间挂到后面的格子里*/
+#ifndef MUDUO_NET_IDLEWHEEL_H
+#define MUDUO_NET_IDLEWHEEL_H
+
+#include <muduo/net/Callbacks.h>
+
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include <boost/weak_ptr.hpp>
+
+namespace muduo
+{
+namespace net
+{
+
+class EventLoop;
+class TcpConnection;
+
+///
+/// Per-loop timing wheel that closes idle connections.
+///
+/// Refreshing a connection costs nothing here, it only updates its own
+/// lastActivity().  Each tick visits one bucket: connections idle for
+/// their idleTimeout() are closed, the others move to the bucket of their
+/// deadline, so a tick costs O(connections due in that bucket).
+///
+/// Not thread safe, always used in the owner loop's thread.
+class IdleWheel : boost::noncopyable
+{
+ public:
+  static const int kNumBuckets = 64;  // 一格一秒，更长的超时分几圈处理
+
+  explicit IdleWheel(EventLoop* loop);
+  ~IdleWheel();
+
+  /// Watches @c conn until it closes.  Starts the wheel on first use.
+  void add(const TcpConnectionPtr& conn);
+
+  size_t size() const { return size_; }
+
+ private:
+  typedef std::vector<boost::weak_ptr<TcpConnection> > Bucket;
+
+  void onTick();
+  void schedule(const boost::weak_ptr<TcpConnection>& conn, double delay);
+
+  EventLoop* loop_;
+  std::vector<Bucket> buckets_;
+  int current_;
+  bool started_;
+  size_t size_;			// 轮子上的连接数，包括已经关闭还没清出去的
+};
+
+}
+}
+
+#endif  // MUDUO_NET_IDLEWHEEL_H
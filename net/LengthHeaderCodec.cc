@@ -0,0 +1,266 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include <muduo/net/LengthHeaderCodec.h>
+
+#include <muduo/base/Logging.h>
+#include <muduo/net/Buffer.h>
+#include <muduo/net/Endian.h>
+#include <muduo/net/TcpConnection.h>
+
+#include <algorithm>
+
+#include <limits.h>
+#include <string.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const size_t LengthHeaderCodec::kMaxVarintLength;
+
+namespace
+{
+
+// 帧以StringPiece交给用户，长度是int；定长头能表示的长度也有限
+size_t capFrameLength(LengthHeaderCodec::HeaderFormat format, size_t maxFrameLength)
+{
+  size_t cap = static_cast<size_t>(INT_MAX);
+  if (format != LengthHeaderCodec::kVarint && format != LengthHeaderCodec::kInt64)
+  {
+    cap = std::min(cap, static_cast<size_t>((static_cast<uint64_t>(1) << (8*format)) - 1));
+  }
+  return std::min(maxFrameLength, cap);
+}
+
+}
+
+LengthHeaderCodec::LengthHeaderCodec(const FramesCallback& cb,
+                                     HeaderFormat format,
+                                     size_t maxFrameLength)
+  : framesCallback_(cb),
+    errorCallback_(defaultErrorCallback),
+    format_(format),
+    maxFrameLength_(capFrameLength(format, maxFrameLength))
+{
+}
+
+void LengthHeaderCodec::onMessage(const TcpConnectionPtr& conn,
+                                  Buffer* buf,
+                                  Timestamp receiveTime)
+{
+  FrameList frames;
+  size_t consumed = 0;
+  size_t pending = 0;
+  ErrorCode error = decode(buf, &frames, &consumed, &pending);
+  if (!frames.empty())
+  {
+    // 切片指向buf，回调返回之后才能取走
+    framesCallback_(conn, frames, receiveTime);
+    buf->retrieve(consumed);
+  }
+  if (error != kNoError)
+  {
+    errorCallback_(conn, buf, receiveTime, error);
+  }
+  else if (pending > 0)
+  {
+    // 整帧到齐之前不必再回调
+    conn->setExpectedFrameLength(pending);
+  }
+}
+
+LengthHeaderCodec::ErrorCode LengthHeaderCodec::decode(const Buffer* buf,
+                                                       FrameList* frames,
+                                                       size_t* consumed,
+                                                       size_t* pending) const
+{
+  const char* data = buf->peek();
+  const size_t len = buf->readableBytes();
+  size_t offset = 0;
+  ErrorCode error = kNoError;
+  *pending = 0;
+  while (offset < len)
+  {
+    uint64_t frameLength = 0;
+    size_t header = parseHeader(data + offset, len - offset, &frameLength, &error);
+    if (header == 0)
+    {
+      break;
+    }
+    if (frameLength > maxFrameLength_)
+    {
+      error = kFrameTooLong;
+      break;
+    }
+    size_t total = header + static_cast<size_t>(frameLength);
+    if (len - offset < total)
+    {
+      *pending = total;
+      break;
+    }
+    frames->push_back(StringPiece(data + offset + header, static_cast<int>(frameLength)));
+    offset += total;
+  }
+  *consumed = offset;
+  return error;
+}
+
+void LengthHeaderCodec::encode(Buffer* buf) const
+{
+  const size_t len = buf->readableBytes();
+  assert(len <= maxFrameLength_);
+  char header[kMaxVarintLength];
+  size_t n = writeHeader(header, len);
+  if (buf->prependableBytes() >= n)
+  {
+    buf->prepend(header, n);
+  }
+  else
+  {
+    Buffer framed(n + len);
+    framed.append(header, n);
+    framed.append(buf->peek(), len);
+    buf->swap(framed);
+  }
+}
+
+void LengthHeaderCodec::send(const TcpConnectionPtr& conn, const StringPiece& message) const
+{
+  Buffer buf(message.size());
+  buf.append(message);
+  encode(&buf);
+  conn->send(&buf);
+}
+
+size_t LengthHeaderCodec::parseHeader(const char* data,
+                                      size_t len,
+                                      uint64_t* frameLength,
+                                      ErrorCode* error) const
+{
+  switch (format_)
+  {
+    case kInt8:
+      if (len < sizeof(uint8_t))
+        return 0;
+      *frameLength = static_cast<uint8_t>(*data);
+      return sizeof(uint8_t);
+    case kInt16:
+    {
+      if (len < sizeof(uint16_t))
+        return 0;
+      uint16_t be16 = 0;
+      ::memcpy(&be16, data, sizeof be16);
+      *frameLength = sockets::networkToHost16(be16);
+      return sizeof be16;
+    }
+    case kInt32:
+    {
+      if (len < sizeof(uint32_t))
+        return 0;
+      uint32_t be32 = 0;
+      ::memcpy(&be32, data, sizeof be32);
+      *frameLength = sockets::networkToHost32(be32);
+      return sizeof be32;
+    }
+    case kInt64:
+    {
+      if (len < sizeof(uint64_t))
+        return 0;
+      uint64_t be64 = 0;
+      ::memcpy(&be64, data, sizeof be64);
+      *frameLength = sockets::networkToHost64(be64);
+      return sizeof be64;
+    }
+    case kVarint:
+    {
+      uint64_t result = 0;
+      for (size_t i = 0; i < len && i < kMaxVarintLength; ++i)
+      {
+        uint8_t byte = static_cast<uint8_t>(data[i]);
+        result |= static_cast<uint64_t>(byte & 0x7f) << (7*i);
+        if ((byte & 0x80) == 0)
+        {
+          *frameLength = result;
+          return i + 1;
+        }
+      }
+      if (len >= kMaxVarintLength)
+      {
+        *error = kInvalidVarint;
+      }
+      return 0;
+    }
+  }
+  return 0;
+}
+
+size_t LengthHeaderCodec::writeHeader(char* dest, uint64_t frameLength) const
+{
+  switch (format_)
+  {
+    case kInt8:
+      *dest = static_cast<char>(frameLength);
+      return sizeof(uint8_t);
+    case kInt16:
+    {
+      uint16_t be16 = sockets::hostToNetwork16(static_cast<uint16_t>(frameLength));
+      ::memcpy(dest, &be16, sizeof be16);
+      return sizeof be16;
+    }
+    case kInt32:
+    {
+      uint32_t be32 = sockets::hostToNetwork32(static_cast<uint32_t>(frameLength));
+      ::memcpy(dest, &be32, sizeof be32);
+      return sizeof be32;
+    }
+    case kInt64:
+    {
+      uint64_t be64 = sockets::hostToNetwork64(frameLength);
+      ::memcpy(dest, &be64, sizeof be64);
+      return sizeof be64;
+    }
+    case kVarint:
+    {
+      size_t n = 0;
+      while (frameLength >= 0x80)
+      {
+        dest[n++] = static_cast<char>((frameLength & 0x7f) | 0x80);
+        frameLength >>= 7;
+      }
+      dest[n++] = static_cast<char>(frameLength);
+      return n;
+    }
+  }
+  return 0;
+}
+
+const char* LengthHeaderCodec::errorCodeToString(ErrorCode errorCode)
+{
+  switch (errorCode)
+  {
+    case kNoError:
+      return "NoError";
+    case kFrameTooLong:
+      return "FrameTooLong";
+    case kInvalidVarint:
+      return "InvalidVarint";
+  }
+  return "UnknownError";
+}
+
+void LengthHeaderCodec::defaultErrorCallback(const TcpConnectionPtr& conn,
+                                             Buffer* buf,
+                                             Timestamp,
+                                             ErrorCode errorCode)
+{
+  LOG_ERROR << "LengthHeaderCodec::defaultErrorCallback - " << conn->name()
+            << " " << errorCodeToString(errorCode);
+  // 后面的数据已经无法分帧了
+  buf->retrieveAll();
+  conn->forceClose();
+}
@@ -0,0 +1,133 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+/* 长度头分帧：每条消息前面是它的长度（1/2/4/8字节网络字节序，或者varint），
+ * 一次把Buffer里所有完整的消息切出来，作为一批StringPiece交给用户，不拷贝。
+ */
+#ifndef MUDUO_NET_LENGTHHEADERCODEC_H
+#define MUDUO_NET_LENGTHHEADERCODEC_H
+
+#include <muduo/base/StringPiece.h>
+#include <muduo/net/Callbacks.h>
+
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <vector>
+
+namespace muduo
+{
+namespace net
+{
+
+///
+/// Length-prefixed framing.
+///
+/// @code
+/// +--------+---------------+--------+---------------+----
+/// | length |     frame     | length |     frame     | ...
+/// +--------+---------------+--------+---------------+----
+/// @endcode
+///
+/// The length counts the frame only, not the header.  Set onMessage() as
+/// the connection's MessageCallback; every complete frame in the input
+/// buffer is delivered in one FramesCallback, as slices of the buffer that
+/// are valid until the callback returns.  While a frame is incomplete the
+/// codec tells the connection how many bytes it waits for, see
+/// TcpConnection::setExpectedFrameLength().
+///
+/// The codec keeps no per-connection state, one instance may serve every
+/// connection of a server.
+class LengthHeaderCodec : boost::noncopyable
+{
+ public:
+  /// The value is the header size in bytes.
+  enum HeaderFormat
+  {
+    kVarint = 0,  // base 128, low group first, as in protobuf
+    kInt8 = 1,
+    kInt16 = 2,
+    kInt32 = 4,
+    kInt64 = 8
+  };
+
+  enum ErrorCode
+  {
+    kNoError = 0,
+    kFrameTooLong,
+    kInvalidVarint
+  };
+
+  typedef std::vector<StringPiece> FrameList;
+  typedef boost::function<void (const TcpConnectionPtr&,
+                                const FrameList&,
+                                Timestamp)> FramesCallback;
+  typedef boost::function<void (const TcpConnectionPtr&,
+                                Buffer*,
+                                Timestamp,
+                                ErrorCode)> ErrorCallback;
+
+  static const size_t kMaxVarintLength = 10;
+
+  /// @c maxFrameLength is capped at INT_MAX, frames are handed out as
+  /// StringPiece, and at the largest length @c format can encode.
+  explicit LengthHeaderCodec(const FramesCallback& cb,
+                             HeaderFormat format = kInt32,
+                             size_t maxFrameLength = 64*1024*1024);
+
+  /// Default: logs, discards the input and closes the connection.
+  void setErrorCallback(const ErrorCallback& cb)
+  { errorCallback_ = cb; }
+
+  HeaderFormat format() const { return format_; }
+  size_t maxFrameLength() const { return maxFrameLength_; }
+
+  void onMessage(const TcpConnectionPtr& conn,
+                 Buffer* buf,
+                 Timestamp receiveTime);
+
+  /// Slices every complete frame at the front of @c buf into @c frames,
+  /// doesn't retrieve.  @c *consumed is the bytes they span with their
+  /// headers.  @c *pending is the total size of the incomplete frame that
+  /// follows including its header, or 0 if its header is incomplete too.
+  ErrorCode decode(const Buffer* buf,
+                   FrameList* frames,
+                   size_t* consumed,
+                   size_t* pending) const;
+
+  /// Prepends the header for the readable bytes of @c buf in place, using
+  /// Buffer::kCheapPrepend.  Copies only if @c buf has less room in front.
+  void encode(Buffer* buf) const;
+
+  /// Encodes @c message and sends it.  Thread safe.
+  void send(const TcpConnectionPtr& conn, const StringPiece& message) const;
+
+  static const char* errorCodeToString(ErrorCode errorCode);
+
+ private:
+  // 解析data开头的长度头，头不完整时返回0
+  size_t parseHeader(const char* data, size_t len, uint64_t* frameLength, ErrorCode* error) const;
+  // 写长度头，返回头的字节数
+  size_t writeHeader(char* dest, uint64_t frameLength) const;
+
+  static void defaultErrorCallback(const TcpConnectionPtr&,
+                                   Buffer*,
+                                   Timestamp,
+                                   ErrorCode);
+
+  FramesCallback framesCallback_;
+  ErrorCallback errorCallback_;
+  const HeaderFormat format_;
+  const size_t maxFrameLength_;
+};
+
+}
+}
+
+#endif  // MUDUO_NET_LENGTHHEADERCODEC_H
@@ -0,0 +1,66 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+/* Payload是一块只读的、带引用计数的消息，可以同时挂到很多连接的发送队列上，
+ * 各个连接发送时直接从这块内存writev，不再各自拷贝一份。
+ */
+#ifndef MUDUO_NET_PAYLOAD_H
+#define MUDUO_NET_PAYLOAD_H
+
+#include <muduo/base/StringPiece.h>
+#include <muduo/net/Buffer.h>
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+namespace muduo
+{
+namespace net
+{
+
+///
+/// An immutable block of bytes shared by many connections.
+///
+/// Encode a message once, wrap it in a PayloadPtr and send() it to every
+/// subscriber; each connection keeps a reference until its copy is on the
+/// wire.  The content must not change after construction, so a Payload
+/// may be sent from any thread to connections of any loop.
+class Payload : boost::noncopyable
+{
+ public:
+  /// Copies @c data once.
+  explicit Payload(const StringPiece& data)
+    : buffer_(data.size())
+  {
+    buffer_.append(data.data(), data.size());
+  }
+
+  /// Takes over the storage of @c buf, leaving it empty.
+  explicit Payload(Buffer* buf)
+    : buffer_(0)
+  {
+    buffer_.swap(*buf);
+  }
+
+  const char* data() const { return buffer_.peek(); }
+  size_t size() const { return buffer_.readableBytes(); }
+
+  StringPiece toStringPiece() const
+  { return StringPiece(data(), static_cast<int>(size())); }
+
+ private:
+  Buffer buffer_;
+};
+
+typedef boost::shared_ptr<const Payload> PayloadPtr;
+
+}
+}
+
+#endif  // MUDUO_NET_PAYLOAD_H
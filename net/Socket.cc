@@ -58,6 +58,13 @@ void Socket::setTcpNoDelay(bool on)
   // FIXME CHECK
 }
 
+bool Socket::getTcpInfo(struct tcp_info* info) const
+{
+  socklen_t len = sizeof(*info);
+  bzero(info, len);
+  return ::getsockopt(sockfd_, SOL_TCP, TCP_INFO, info, &len) == 0;
+}
+
 void Socket::setReuseAddr(bool on)
 {
   int optval = on ? 1 : 0;
@@ -74,3 +81,8 @@ void Socket::setKeepAlive(bool on)
   // FIXME CHECK
 }
 
+bool Socket::setZeroCopy(bool on)
+{
+  return sockets::setZeroCopy(sockfd_, on);
+}
+
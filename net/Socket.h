@@ -13,6 +13,9 @@
 
 #include <boost/noncopyable.hpp>
 
+// struct tcp_info is in <netinet/tcp.h>
+struct tcp_info;
+
 namespace muduo
 {
 ///
@@ -74,6 +77,15 @@ class Socket : boost::noncopyable
   // TCP keepalive是指定期探测连接是否存在，如果应用层有心跳的话，这个选项不是必需要设置的
   void setKeepAlive(bool on);
 
+  /// Reads TCP_INFO, returns false on error.
+  bool getTcpInfo(struct tcp_info* info) const;
+
+  ///
+  /// Enable/disable SO_ZEROCOPY, returns false if not supported.
+  ///
+  // 打开后才能用MSG_ZEROCOPY发送，完成通知从错误队列读
+  bool setZeroCopy(bool on);
+
  private:
   const int sockfd_;//const成员变量只可以在初始化列表中初始化
 };
@@ -14,19 +14,54 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <linux/errqueue.h>
+#include <netinet/tcp.h>
 #include <stdio.h>  // snprintf
 #include <strings.h>  // bzero
+#include <sys/sendfile.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 using namespace muduo;
 using namespace muduo::net;
 
+// 旧的头文件里没有这些定义
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+#define SO_EE_ORIGIN_ZEROCOPY 5
+#endif
+#ifndef SO_EE_CODE_ZEROCOPY_COPIED
+#define SO_EE_CODE_ZEROCOPY_COPIED 1
+#endif
+
 namespace
 {
 
 typedef struct sockaddr SA;
 
+// glibc的tcp_info只到tcpi_total_retrans，后面的字段按内核的布局补上
+struct TcpInfoExt
+{
+  struct tcp_info base;
+  uint64_t pacingRate;
+  uint64_t maxPacingRate;
+  uint64_t bytesAcked;
+  uint64_t bytesReceived;
+  uint32_t segsOut;
+  uint32_t segsIn;
+  uint32_t notsentBytes;
+  uint32_t minRtt;
+  uint32_t dataSegsIn;
+  uint32_t dataSegsOut;
+  uint64_t deliveryRate;
+};
+
 const SA* sockaddr_cast(const struct sockaddr_in* addr)//将const sockaddr_in*转换成const sockaddr*
 {
   return static_cast<const SA*>(implicit_cast<const void*>(addr));//implicit_cast是自定义的转换符，派生类转换成基类
@@ -164,6 +199,105 @@ ssize_t sockets::write(int sockfd, const void *buf, size_t count)//封装write
   return ::write(sockfd, buf, count);
 }
 
+ssize_t sockets::writev(int sockfd, const struct iovec *iov, int iovcnt)//封装writev函数，多块数据一次写出
+{
+  return ::writev(sockfd, iov, iovcnt);
+}
+
+ssize_t sockets::sendfile(int sockfd, int fd, off_t* offset, size_t count)//封装sendfile函数，文件内容不经过用户空间
+{
+  return ::sendfile(sockfd, fd, offset, count);
+}
+
+ssize_t sockets::splice(int fdIn, int fdOut, size_t count)//封装splice函数，数据在内核中搬运
+{
+  return ::splice(fdIn, NULL, fdOut, NULL, count, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+}
+
+int sockets::createPipe(int fds[2], int size)
+{
+  if (::pipe2(fds, O_NONBLOCK | O_CLOEXEC) < 0)
+  {
+    LOG_SYSERR << "sockets::createPipe";
+    return -1;
+  }
+  // 增大管道失败不要紧，受/proc/sys/fs/pipe-max-size限制
+  ::fcntl(fds[1], F_SETPIPE_SZ, size);
+  return ::fcntl(fds[1], F_GETPIPE_SZ);
+}
+
+bool sockets::setZeroCopy(int sockfd, bool on)
+{
+  int optval = on ? 1 : 0;
+  return ::setsockopt(sockfd, SOL_SOCKET, SO_ZEROCOPY,
+                      &optval, static_cast<socklen_t>(sizeof optval)) == 0;
+}
+
+bool sockets::getTcpRateInfo(int sockfd, TcpRateInfo* info)
+{
+  TcpInfoExt ext;
+  bzero(&ext, sizeof ext);
+  socklen_t len = static_cast<socklen_t>(sizeof ext);
+  if (::getsockopt(sockfd, SOL_TCP, TCP_INFO, &ext, &len) < 0)
+  {
+    return false;
+  }
+  // 老内核返回的len较短，没填的字段保持为0
+  info->rttUs = ext.base.tcpi_rtt;
+  info->sndMss = ext.base.tcpi_snd_mss;
+  info->sndCwnd = ext.base.tcpi_snd_cwnd;
+  info->notsentBytes = ext.notsentBytes;
+  info->deliveryRate = ext.deliveryRate;
+  return true;
+}
+
+bool sockets::setNotSentLowat(int sockfd, int bytes)
+{
+  return ::setsockopt(sockfd, IPPROTO_TCP, TCP_NOTSENT_LOWAT,
+                      &bytes, static_cast<socklen_t>(sizeof bytes)) == 0;
+}
+
+bool sockets::setRcvLowat(int sockfd, int bytes)
+{
+  return ::setsockopt(sockfd, SOL_SOCKET, SO_RCVLOWAT,
+                      &bytes, static_cast<socklen_t>(sizeof bytes)) == 0;
+}
+
+ssize_t sockets::sendZeroCopy(int sockfd, const void *buf, size_t count)
+{
+  return ::send(sockfd, buf, count, MSG_ZEROCOPY);
+}
+
+int sockets::readZeroCopyCompletion(int sockfd, uint32_t* lo, uint32_t* hi, bool* copied)
+{
+  char control[128];
+  struct msghdr msg;
+  bzero(&msg, sizeof msg);
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof control;
+  if (::recvmsg(sockfd, &msg, MSG_ERRQUEUE) < 0)
+  {
+    return -1;
+  }
+  for (struct cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm != NULL; cm = CMSG_NXTHDR(&msg, cm))
+  {
+    if ((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR)
+        || (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR))
+    {
+      const struct sock_extended_err* err =
+          reinterpret_cast<const struct sock_extended_err*>(CMSG_DATA(cm));
+      if (err->ee_errno == 0 && err->ee_origin == SO_EE_ORIGIN_ZEROCOPY)
+      {
+        *lo = err->ee_info;
+        *hi = err->ee_data;
+        *copied = (err->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) != 0;
+        return 1;
+      }
+    }
+  }
+  return 0;
+}
+
 void sockets::close(int sockfd)//封装close函数
 {
   if (::close(sockfd) < 0)
@@ -32,9 +32,43 @@ int  accept(int sockfd, struct sockaddr_in* addr);
 ssize_t read(int sockfd, void *buf, size_t count);
 ssize_t readv(int sockfd, const struct iovec *iov, int iovcnt);
 ssize_t write(int sockfd, const void *buf, size_t count);
+ssize_t writev(int sockfd, const struct iovec *iov, int iovcnt);
+ssize_t sendfile(int sockfd, int fd, off_t* offset, size_t count);
+/// Non-blocking splice(2) between a socket and a pipe.
+ssize_t splice(int fdIn, int fdOut, size_t count);
+/// Creates a non-blocking pipe and tries to grow it to @c size bytes,
+/// returns the resulting capacity or -1 on error.
+int createPipe(int fds[2], int size);
+
+/// MSG_ZEROCOPY, buf must stay untouched until the completion is read.
+bool setZeroCopy(int sockfd, bool on);
+ssize_t sendZeroCopy(int sockfd, const void *buf, size_t count);
+/// Reads one message from the error queue.  Returns 1 and the range
+/// [*lo, *hi] of completed sends for a zero-copy notification, 0 for
+/// other messages, -1 on error (EAGAIN when the queue is empty).
+/// *copied is set if the kernel fell back to copying.
+int readZeroCopyCompletion(int sockfd, uint32_t* lo, uint32_t* hi, bool* copied);
 void close(int sockfd);
 void shutdownWrite(int sockfd);
 
+/// The parts of TCP_INFO that tell how fast a connection drains,
+/// fields the kernel doesn't report are 0.
+struct TcpRateInfo
+{
+  uint32_t rttUs;
+  uint32_t sndMss;
+  uint32_t sndCwnd;
+  uint32_t notsentBytes;	// 在内核中还没发出去的字节数
+  uint64_t deliveryRate;	// bytes per second
+};
+bool getTcpRateInfo(int sockfd, TcpRateInfo* info);
+/// TCP_NOTSENT_LOWAT, the socket is writable only while fewer than
+/// @c bytes are waiting in the kernel unsent.
+bool setNotSentLowat(int sockfd, int bytes);
+/// SO_RCVLOWAT, poll reports the socket readable only once @c bytes
+/// have arrived (or on EOF/error).
+bool setRcvLowat(int sockfd, int bytes);
+
 void toIpPort(char* buf, size_t size,
               const struct sockaddr_in& addr);
 void toIp(char* buf, size_t size,
@@ -8,20 +8,167 @@
 
 #include <muduo/net/TcpConnection.h>
 
+#include <muduo/base/Atomic.h>
 #include <muduo/base/Logging.h>
+#include <muduo/base/ThreadLocal.h>
+#include <muduo/net/BufferPool.h>
 #include <muduo/net/Channel.h>
 #include <muduo/net/EventLoop.h>
+#include <muduo/net/IdleWheel.h>
 #include <muduo/net/Socket.h>
 #include <muduo/net/SocketsOps.h>
 
 #include <boost/bind.hpp>
 
 #include <errno.h>
+#include <netinet/tcp.h>
 #include <stdio.h>
+#include <sys/uio.h>
+#include <unistd.h>
 
 using namespace muduo;
 using namespace muduo::net;
 
+namespace
+{
+
+// 所有连接的输入输出缓冲区中的总字节数
+AtomicInt64 g_bufferedBytes;
+AtomicInt64 g_idleEvictions;
+AtomicInt64 g_peakBufferedBytes;
+AtomicInt64 g_bufferedBytesLimit;
+
+// 超过上限时暂停读，每隔这么久检查一次能否恢复
+const double kMemoryRetryDelay = 0.1;
+
+// 因为内存超限暂停读的连接，每个IO线程一份，共用一个重试定时器
+struct MemoryRetryList
+{
+  MemoryRetryList() : timerArmed(false) { }
+
+  std::vector<boost::weak_ptr<TcpConnection> > connections;
+  bool timerArmed;
+};
+
+ThreadLocal<MemoryRetryList> g_memoryRetryLists;
+
+const size_t kDefaultShrinkThreshold = 1024*1024;
+
+// 自适应高水位标的采样间隔和下限
+const double kAdaptInterval = 0.2;
+const size_t kMinAdaptiveHighWaterMark = 64*1024;
+const int kMinNotSentLowat = 16*1024;
+const int kMaxNotSentLowat = 4*1024*1024;
+
+// SO_RCVLOWAT太大时内核会跟着放大接收缓冲区
+const size_t kMaxRcvLowat = 256*1024;
+
+void updatePeak(int64_t total)
+{
+  int64_t peak = g_peakBufferedBytes.get();
+  while (total > peak)
+  {
+    int64_t prev = g_peakBufferedBytes.compareAndSwap(peak, total);
+    if (prev == peak)
+    {
+      break;
+    }
+    peak = prev;
+  }
+}
+
+bool overBufferedBytesLimit(int64_t total)
+{
+  int64_t limit = g_bufferedBytesLimit.get();
+  return limit > 0 && total > limit;
+}
+
+}
+
+namespace muduo
+{
+namespace net
+{
+namespace detail
+{
+
+// 待发送的文件段，用MSG_ZEROCOPY发送的一块内存，或者多个连接共享的Payload
+struct OutputSegment : boost::noncopyable
+{
+  enum Kind { kFile, kZeroCopy, kPayload };
+
+  OutputSegment(int fdArg, off_t offsetArg, size_t length)
+    : kind(kFile),
+      fd(fdArg),
+      offset(offsetArg),
+      remaining(length),
+      data(0),
+      zeroCopySent(false),
+      lastSendId(0),
+      trailer(0)
+  {
+  }
+
+  // 接管buf的内存
+  explicit OutputSegment(Buffer* buf)
+    : kind(kZeroCopy),
+      fd(-1),
+      offset(0),
+      remaining(buf->readableBytes()),
+      data(0),
+      zeroCopySent(false),
+      lastSendId(0),
+      trailer(0)
+  {
+    data.swap(*buf);
+  }
+
+  // 只持有引用，不拷贝
+  explicit OutputSegment(const PayloadPtr& payloadArg)
+    : kind(kPayload),
+      fd(-1),
+      offset(0),
+      remaining(payloadArg->size()),
+      data(0),
+      zeroCopySent(false),
+      lastSendId(0),
+      payload(payloadArg),
+      trailer(0)
+  {
+  }
+
+  ~OutputSegment()
+  {
+    if (fd >= 0)
+    {
+      sockets::close(fd);
+    }
+  }
+
+  // 还没发送的内存数据
+  const char* unsent() const
+  {
+    if (kind == kPayload)
+    {
+      return payload->data() + (payload->size() - remaining);
+    }
+    return data.peek() + (data.readableBytes() - remaining);
+  }
+
+  Kind kind;
+  int fd;
+  off_t offset;
+  size_t remaining;
+  Buffer data;          // 零拷贝段的数据，发送期间和发完等通知期间都不能动
+  bool zeroCopySent;    // 至少有一次MSG_ZEROCOPY发送成功，发完后要等完成通知
+  uint32_t lastSendId;  // 最后一次MSG_ZEROCOPY发送的序号
+  PayloadPtr payload;
+  Buffer trailer;       // 该段之后send的数据
+};
+}
+}
+}
+
 void muduo::net::defaultConnectionCallback(const TcpConnectionPtr& conn)//默认的连接回调函数，输出连接状态
 {
   LOG_TRACE << conn->localAddress().toIpPort() << " -> "
@@ -45,11 +192,35 @@ TcpConnection::TcpConnection(EventLoop* loop,
   : loop_(CHECK_NOTNULL(loop)),
     name_(nameArg),
     state_(kConnecting),
+    lowMemoryMode_(false),
+    readPaused_(0),
     socket_(new Socket(sockfd)),
     channel_(new Channel(loop, sockfd)),
     localAddr_(localAddr),
     peerAddr_(peerAddr),
-    highWaterMark_(64*1024*1024)
+    rawWriting_(false),
+    writeCoalescing_(false),
+    flushPending_(false),
+    highWaterMark_(64*1024*1024),
+    highWaterMarkLimit_(64*1024*1024),
+    adaptiveDelay_(0.0),
+    notSentLowat_(0),
+    minReadBytes_(0),
+    readBatchDelay_(0.0),
+    expectedFrameLength_(0),
+    inputHeld_(false),
+    readHoldSeq_(0),
+    rcvLowat_(1),
+    lowWaterMark_(0),
+    aboveHighWaterMark_(false),
+    shrinkThreshold_(kDefaultShrinkThreshold),
+    bufferedBytes_(0),
+    queuedBytes_(0),
+    zeroCopyThreshold_(0),
+    nextZeroCopyId_(0),
+    zeroCopyCopied_(0),
+    idleTimeout_(0.0),
+    contextDestructor_(NULL)
 {
   // 通道可读事件到来的时候，回调TcpConnection::handleRead，_1是事件发生时间
   channel_->setReadCallback(
@@ -72,6 +243,127 @@ TcpConnection::~TcpConnection()
 {
   LOG_DEBUG << "TcpConnection::dtor[" <<  name_ << "] at " << this
             << " fd=" << channel_->fd();
+  g_bufferedBytes.add(-bufferedBytes_);
+  destroyContext();
+}
+
+const size_t TcpConnection::kContextSize;
+
+void TcpConnection::destroyContext()
+{
+  if (contextDestructor_)
+  {
+    contextDestructor_(contextStorage_.address());
+    contextDestructor_ = NULL;
+  }
+}
+
+ConnectionStats TcpConnection::stats() const
+{
+  loop_->assertInLoopThread();
+  ConnectionStats stats(stats_);
+  stats.connections = 1;
+  stats.lastActivity = lastActivity_;
+  if (writeBlockedSince_.valid())
+  {
+    stats.writeBlockedSeconds += timeDifference(Timestamp::now(), writeBlockedSince_);
+  }
+  struct tcp_info info;
+  if (state_ != kDisconnected && socket_->getTcpInfo(&info))
+  {
+    stats.tcpiRttUs = info.tcpi_rtt;
+    stats.tcpiRttVarUs = info.tcpi_rttvar;
+    stats.tcpiCwnd = info.tcpi_snd_cwnd;
+    stats.tcpiTotalRetrans = info.tcpi_total_retrans;
+  }
+  return stats;
+}
+
+// 按对端实际的接收速度，让用户态和内核中排队的数据都不超过adaptiveDelay_秒
+void TcpConnection::adaptHighWaterMark()
+{
+  Timestamp now(loop_->pollReturnTime());
+  if (adaptiveDelay_ <= 0
+      || (lastAdaptTime_.valid() && timeDifference(now, lastAdaptTime_) < kAdaptInterval))
+  {
+    return;
+  }
+  lastAdaptTime_ = now;
+  sockets::TcpRateInfo info;
+  if (!sockets::getTcpRateInfo(channel_->fd(), &info))
+  {
+    return;
+  }
+  double rate = static_cast<double>(info.deliveryRate);
+  if (rate <= 0 && info.rttUs > 0)
+  {
+    // 老内核没有delivery rate，用一个RTT发出一个拥塞窗口估算
+    rate = static_cast<double>(info.sndCwnd) * info.sndMss * 1e6 / info.rttUs;
+  }
+  if (rate <= 0)
+  {
+    return;
+  }
+  double budget = rate * adaptiveDelay_;
+  size_t mark = static_cast<size_t>(budget);
+  highWaterMark_ = std::min(std::max(mark, kMinAdaptiveHighWaterMark), highWaterMarkLimit_);
+
+  // 内核里未发送的数据占一半的预算，变化不大时不重复设置
+  int lowat = static_cast<int>(std::min(std::max(budget / 2, static_cast<double>(kMinNotSentLowat)),
+                                        static_cast<double>(kMaxNotSentLowat)));
+  if (notSentLowat_ == 0 || lowat > notSentLowat_ * 5 / 4 || lowat < notSentLowat_ * 3 / 4)
+  {
+    if (sockets::setNotSentLowat(channel_->fd(), lowat))
+    {
+      notSentLowat_ = lowat;
+    }
+  }
+  LOG_TRACE << "TcpConnection::adaptHighWaterMark [" << name_ << "] rate " << rate
+            << " unsent " << info.notsentBytes << " high water mark " << highWaterMark_
+            << " notsent lowat " << notSentLowat_;
+}
+
+void TcpConnection::writeDrained()
+{
+  if (writeBlockedSince_.valid())
+  {
+    stats_.writeBlockedSeconds += timeDifference(loop_->pollReturnTime(), writeBlockedSince_);
+    writeBlockedSince_ = Timestamp::invalid();
+  }
+}
+
+int64_t TcpConnection::totalIdleEvictions()
+{
+  return g_idleEvictions.get();
+}
+
+void TcpConnection::closeIdle()
+{
+  loop_->assertInLoopThread();
+  LOG_INFO << "TcpConnection::closeIdle [" << name_ << "] - idle for "
+           << timeDifference(Timestamp::now(), lastActivity_) << " seconds";
+  g_idleEvictions.increment();
+  forceClose();
+}
+
+int64_t TcpConnection::totalBufferedBytes()
+{
+  return g_bufferedBytes.get();
+}
+
+int64_t TcpConnection::peakBufferedBytes()
+{
+  return g_peakBufferedBytes.get();
+}
+
+void TcpConnection::setBufferedBytesLimit(int64_t limit)
+{
+  g_bufferedBytesLimit.getAndSet(limit);
+}
+
+int64_t TcpConnection::bufferedBytesLimit()
+{
+  return g_bufferedBytesLimit.get();
 }
 
 // 线程安全，可以跨线程调用
@@ -119,7 +411,16 @@ void TcpConnection::send(Buffer* buf)
 {
   if (state_ == kConnected)
   {
-    if (loop_->isInLoopThread())
+    if (zeroCopyThreshold_ > 0 && buf->readableBytes() >= zeroCopyThreshold_)
+    {
+      // 大块数据直接接管buf的内存，不拷贝
+      boost::shared_ptr<detail::OutputSegment> segment(new detail::OutputSegment(buf));
+      loop_->runInLoop(
+          boost::bind(&TcpConnection::sendSegmentInLoop,
+                      this,
+                      segment));
+    }
+    else if (loop_->isInLoopThread())
     {
       sendInLoop(buf->peek(), buf->readableBytes());
       buf->retrieveAll();
@@ -135,6 +436,40 @@ void TcpConnection::send(Buffer* buf)
   }
 }
 
+// 线程安全，可以跨线程调用，各个连接共享同一块payload
+void TcpConnection::send(const PayloadPtr& payload)
+{
+  if (state_ == kConnected && payload->size() > 0)
+  {
+    boost::shared_ptr<detail::OutputSegment> segment(
+        new detail::OutputSegment(payload));
+    loop_->runInLoop(
+        boost::bind(&TcpConnection::sendSegmentInLoop,
+                    this,
+                    segment));
+  }
+}
+
+// 线程安全，可以跨线程调用
+void TcpConnection::sendFile(int fd, off_t offset, size_t length)
+{
+  if (state_ == kConnected && length > 0)
+  {
+    int dupfd = ::dup(fd);
+    if (dupfd < 0)
+    {
+      LOG_SYSERR << "TcpConnection::sendFile";
+      return;
+    }
+    boost::shared_ptr<detail::OutputSegment> segment(
+        new detail::OutputSegment(dupfd, offset, length));
+    loop_->runInLoop(
+        boost::bind(&TcpConnection::sendSegmentInLoop,
+                    this,
+                    segment));
+  }
+}
+
 void TcpConnection::sendInLoop(const StringPiece& message)
 {
   sendInLoop(message.data(), message.size());
@@ -158,11 +493,14 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
   }
   // if no thing in output queue, try writing directly
   // 通道没有关注可写事件并且发送缓冲区没有数据，直接write
-  if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0)
+  // 合并写模式下先攒着，这一轮事件处理完再一起写
+  if (!channel_->isWriting() && pendingOutputBytes() == 0 && !writeCoalescing_)
   {
     nwrote = sockets::write(channel_->fd(), data, len);
     if (nwrote >= 0)
     {
+      lastActivity_ = loop_->pollReturnTime();
+      countWritten(nwrote);
       remaining = len - nwrote;
 	  // 写完了，回调writeCompleteCallback_
       if (remaining == 0 && writeCompleteCallback_)
@@ -189,22 +527,198 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
   if (!error && remaining > 0)
   {
     LOG_TRACE << "I am going to write more data";
-    size_t oldLen = outputBuffer_.readableBytes();
-	// 如果超过highWaterMark_（高水位标），回调highWaterMarkCallback_
-    if (oldLen + remaining >= highWaterMark_
-        && oldLen < highWaterMark_
+    size_t oldLen = pendingOutputBytes();
+    checkHighWaterMark(oldLen, oldLen + remaining);
+    if (outputSegments_.empty())
+    {
+      acquireBuffer(&outputBuffer_);
+      outputBuffer_.append(static_cast<const char*>(data)+nwrote, remaining);//将剩余数据存入应用层发送缓冲区
+    }
+    else
+    {
+      // 前面还有文件段没发完，排在最后一个文件段之后
+      outputSegments_.back()->trailer.append(static_cast<const char*>(data)+nwrote, remaining);
+      queuedBytes_ += remaining;
+    }
+    int64_t before = g_bufferedBytes.get();
+    updateBufferedBytes();
+    // 本次发送使全局缓冲超过上限，也回调highWaterMarkCallback_
+    if (!overBufferedBytesLimit(before)
+        && overBufferedBytesLimit(g_bufferedBytes.get())
         && highWaterMarkCallback_)
     {
-      loop_->queueInLoop(boost::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remaining));
+      loop_->queueInLoop(boost::bind(highWaterMarkCallback_, shared_from_this(), outputBuffer_.readableBytes()));
     }
-    outputBuffer_.append(static_cast<const char*>(data)+nwrote, remaining);//将剩余数据存入应用层发送缓冲区
-    if (!channel_->isWriting())
+    if (writeCoalescing_ && !channel_->isWriting())
+    {
+      if (!flushPending_)
+      {
+        // 在poll之前执行
+        flushPending_ = true;
+        loop_->queueInLoop(boost::bind(&TcpConnection::flushInLoop, shared_from_this()));
+      }
+    }
+    else if (!channel_->isWriting())
     {
       channel_->enableWriting();		// 关注POLLOUT事件
     }
   }
 }
 
+// 合并写模式下，把这一轮攒下的数据一次write出去
+void TcpConnection::flushInLoop()
+{
+  loop_->assertInLoopThread();
+  flushPending_ = false;
+  if (state_ == kDisconnected || channel_->isWriting())
+  {
+    // 已经在等POLLOUT，由handleWrite发送
+    return;
+  }
+  if (outputBuffer_.readableBytes() > 0)
+  {
+    ssize_t n = sockets::write(channel_->fd(),
+                               outputBuffer_.peek(),
+                               outputBuffer_.readableBytes());
+    if (n > 0)
+    {
+      lastActivity_ = loop_->pollReturnTime();
+      outputBuffer_.retrieve(n);
+      updateBufferedBytes();
+      countWritten(n);
+    }
+    else if (n < 0 && errno != EWOULDBLOCK)
+    {
+      LOG_SYSERR << "TcpConnection::flushInLoop";
+      if (errno == EPIPE || errno == ECONNRESET)
+      {
+        return;
+      }
+    }
+  }
+  afterWrite();
+  if (pendingOutputBytes() > 0)
+  {
+    channel_->enableWriting();
+  }
+}
+
+// handleWrite和flushInLoop写出数据之后：降到低水位标时恢复被暂停的读者，全部发完时收尾
+void TcpConnection::afterWrite()
+{
+  if (aboveHighWaterMark_ && pendingOutputBytes() <= lowWaterMark_)
+  {
+    aboveHighWaterMark_ = false;
+    if (lowWaterMarkCallback_)
+    {
+      loop_->queueInLoop(boost::bind(lowWaterMarkCallback_, shared_from_this(), pendingOutputBytes()));
+    }
+    notifyFlowControlReaders(false);
+  }
+  if (pendingOutputBytes() == 0)	 // 发送缓冲区已清空
+  {
+    writeDrained();
+    if (channel_->isWriting() && !rawWriting_)
+    {
+      channel_->disableWriting();		// 停止关注POLLOUT事件，以免出现busy loop
+    }
+    releaseBuffer(&outputBuffer_);
+    shrinkBuffer(&outputBuffer_);
+    if (writeCompleteCallback_)		// 回调writeCompleteCallback_
+    {
+      // 应用层发送缓冲区被清空，就回调用writeCompleteCallback_
+      // 发送给IO线程进行处理
+      loop_->queueInLoop(boost::bind(writeCompleteCallback_, shared_from_this()));
+    }
+    if (state_ == kDisconnecting)	// 发送缓冲区已清空并且连接状态是kDisconnecting, 要关闭连接
+    {
+      shutdownInLoop();		// 关闭写连接
+    }
+  }
+  else
+  {
+    LOG_TRACE << "I am going to write more data";
+  }
+}
+
+void TcpConnection::sendSegmentInLoop(const boost::shared_ptr<detail::OutputSegment>& segment)
+{
+  loop_->assertInLoopThread();
+  bool error = false;
+  if (state_ == kDisconnected)
+  {
+    LOG_WARN << "disconnected, give up writing";
+    return;
+  }
+  // 前面没有待发送的数据，直接发送
+  if (!channel_->isWriting() && pendingOutputBytes() == 0)
+  {
+    ssize_t n = writeSegment(segment.get());
+    countWritten(n);
+    if (state_ == kDisconnected)
+    {
+      return;		// 文件段发不完，writeSegment()已经关闭了连接
+    }
+    if (n < 0 && errno != EWOULDBLOCK)
+    {
+      LOG_SYSERR << "TcpConnection::sendSegmentInLoop";
+      if (errno == EPIPE || errno == ECONNRESET)
+      {
+        error = true;
+      }
+    }
+    if (segment->remaining == 0)
+    {
+      if (segment->zeroCopySent)
+      {
+        pinnedSegments_.push_back(segment);
+      }
+      if (writeCompleteCallback_)
+      {
+        loop_->queueInLoop(boost::bind(writeCompleteCallback_, shared_from_this()));
+      }
+    }
+  }
+
+  if (!error && segment->remaining > 0)
+  {
+    size_t oldLen = pendingOutputBytes();
+    checkHighWaterMark(oldLen, oldLen + segment->remaining);
+    outputSegments_.push_back(segment);
+    queuedBytes_ += segment->remaining;
+    if (!channel_->isWriting())
+    {
+      channel_->enableWriting();
+    }
+  }
+}
+
+void TcpConnection::checkHighWaterMark(size_t oldLen, size_t newLen)
+{
+  adaptHighWaterMark();
+  if (oldLen == 0 && newLen > 0)
+  {
+    // 开始等POLLOUT
+    writeBlockedSince_ = loop_->pollReturnTime();
+  }
+  if (static_cast<int64_t>(newLen) > stats_.peakOutputBytes)
+  {
+    stats_.peakOutputBytes = static_cast<int64_t>(newLen);
+  }
+  // 如果超过highWaterMark_（高水位标），回调highWaterMarkCallback_
+  if (newLen >= highWaterMark_
+      && oldLen < highWaterMark_
+      && highWaterMarkCallback_)
+  {
+    loop_->queueInLoop(boost::bind(highWaterMarkCallback_, shared_from_this(), newLen));
+  }
+  if (newLen >= highWaterMark_ && !aboveHighWaterMark_)
+  {
+    aboveHighWaterMark_ = true;
+    notifyFlowControlReaders(true);
+  }
+}
+
 void TcpConnection::shutdown()//关闭连接
 {
   // FIXME: use compare and swap
@@ -219,13 +733,178 @@ void TcpConnection::shutdown()//关闭连接
 void TcpConnection::shutdownInLoop()//在loop中关闭写半边，还是可以读数据
 {
   loop_->assertInLoopThread();
-  if (!channel_->isWriting())
+  if (!channel_->isWriting() && !flushPending_)
   {
     // we are not writing
     socket_->shutdownWrite();
   }
 }
 
+void TcpConnection::forceClose()
+{
+  // FIXME: use compare and swap
+  if (state_ == kConnected || state_ == kDisconnecting)
+  {
+    setState(kDisconnecting);
+    loop_->queueInLoop(boost::bind(&TcpConnection::forceCloseInLoop, shared_from_this()));
+  }
+}
+
+void TcpConnection::forceCloseInLoop()
+{
+  loop_->assertInLoopThread();
+  if (state_ == kConnected || state_ == kDisconnecting)
+  {
+    // as if we received 0 byte in handleRead();
+    handleClose();
+  }
+}
+
+void TcpConnection::startRead()
+{
+  loop_->runInLoop(boost::bind(&TcpConnection::resumeRead, shared_from_this(), kPausedByUser));
+}
+
+void TcpConnection::stopRead()
+{
+  loop_->runInLoop(boost::bind(&TcpConnection::pauseRead, shared_from_this(), kPausedByUser));
+}
+
+void TcpConnection::setFlowControlPeer(const TcpConnectionPtr& peer)
+{
+  boost::weak_ptr<TcpConnection> reader(shared_from_this());
+  peer->getLoop()->runInLoop(
+      boost::bind(&TcpConnection::addFlowControlReaderInLoop, peer, reader));
+}
+
+void TcpConnection::addFlowControlReaderInLoop(const boost::weak_ptr<TcpConnection>& reader)
+{
+  loop_->assertInLoopThread();
+  flowControlReaders_.push_back(reader);
+  TcpConnectionPtr conn(reader.lock());
+  if (aboveHighWaterMark_ && conn)
+  {
+    conn->getLoop()->runInLoop(boost::bind(&TcpConnection::pauseRead, conn, kPausedByPeer));
+  }
+}
+
+void TcpConnection::notifyFlowControlReaders(bool pause)
+{
+  size_t i = 0;
+  while (i < flowControlReaders_.size())
+  {
+    TcpConnectionPtr conn(flowControlReaders_[i].lock());
+    if (conn)
+    {
+      if (pause)
+      {
+        conn->getLoop()->runInLoop(boost::bind(&TcpConnection::pauseRead, conn, kPausedByPeer));
+      }
+      else
+      {
+        conn->getLoop()->runInLoop(boost::bind(&TcpConnection::resumeRead, conn, kPausedByPeer));
+      }
+      ++i;
+    }
+    else
+    {
+      // 已经析构的连接，从列表中删掉
+      flowControlReaders_[i] = flowControlReaders_.back();
+      flowControlReaders_.pop_back();
+    }
+  }
+}
+
+// 连接断开后不会再降到低水位标，被本连接暂停的读者要在这里放开
+void TcpConnection::releaseFlowControlReaders()
+{
+  if (aboveHighWaterMark_)
+  {
+    aboveHighWaterMark_ = false;
+    notifyFlowControlReaders(false);
+  }
+}
+
+int TcpConnection::fd() const
+{
+  return channel_->fd();
+}
+
+void TcpConnection::setRawIoCallbacks(const RawIoCallback& readable,
+                                      const RawIoCallback& writable,
+                                      const RawIoCallback& closed)
+{
+  loop_->assertInLoopThread();
+  rawReadCallback_ = readable;
+  rawWriteCallback_ = writable;
+  rawCloseCallback_ = closed;
+}
+
+void TcpConnection::setRawReading(bool on)
+{
+  if (on)
+  {
+    resumeRead(kPausedByRelay);
+  }
+  else
+  {
+    pauseRead(kPausedByRelay);
+  }
+}
+
+void TcpConnection::setRawWriting(bool on)
+{
+  loop_->assertInLoopThread();
+  rawWriting_ = on;
+  if (state_ == kDisconnected)
+  {
+    return;   // channel已经disableAll，不能再加回poller
+  }
+  if (on && !channel_->isWriting())
+  {
+    channel_->enableWriting();
+  }
+  else if (!on && channel_->isWriting() && pendingOutputBytes() == 0)
+  {
+    channel_->disableWriting();
+  }
+}
+
+bool TcpConnection::setZeroCopyThreshold(size_t threshold)
+{
+  assert(state_ == kConnecting);
+  if (threshold > 0 && !socket_->setZeroCopy(true))
+  {
+    LOG_SYSERR << "TcpConnection::setZeroCopyThreshold [" << name_ << "]";
+    return false;
+  }
+  zeroCopyThreshold_ = threshold;
+  if (threshold > 0)
+  {
+    channel_->setErrorQueueCallback(
+        boost::bind(&TcpConnection::handleErrorQueue, this));
+  }
+  else
+  {
+    channel_->setErrorQueueCallback(Channel::EventCallback());
+  }
+  return true;
+}
+
+void TcpConnection::setLowMemoryMode(bool on)
+{
+  assert(state_ == kConnecting);
+  lowMemoryMode_ = on;
+  if (lowMemoryMode_)
+  {
+    // not in loop thread yet, so drop the storage instead of pooling it
+    Buffer input(0);
+    inputBuffer_.swap(input);
+    Buffer output(0);
+    outputBuffer_.swap(output);
+  }
+}
+
 void TcpConnection::setTcpNoDelay(bool on)//设置TCP延迟连接
 {
   socket_->setTcpNoDelay(on);
@@ -238,7 +917,19 @@ void TcpConnection::connectEstablished()//这个建立连接是TcpConnection类
   setState(kConnected);
   LOG_TRACE << "[3] usecount=" << shared_from_this().use_count();
   channel_->tie(shared_from_this());
-  channel_->enableReading();	// TcpConnection所对应的通道加入到Poller关注
+  if (readPaused_ == 0)
+  {
+    channel_->enableReading();
+  }	// TcpConnection所对应的通道加入到Poller关注
+  lastActivity_ = Timestamp::now();
+  if (minReadBytes_ > 0)
+  {
+    updateRcvLowat();
+  }
+  if (idleTimeout_ > 0)
+  {
+    loop_->idleWheel()->add(shared_from_this());
+  }
 
   connectionCallback_(shared_from_this());
   LOG_TRACE << "[4] usecount=" << shared_from_this().use_count();
@@ -254,6 +945,7 @@ void TcpConnection::connectDestroyed()//取消连接，从对应的Eventloop上
 
     connectionCallback_(shared_from_this());
   }
+  releaseFlowControlReaders();
   channel_->remove();//将channel从epoll队列中移除
 }
 
@@ -300,14 +992,45 @@ void TcpConnection::handleRead(Timestamp receiveTime)//处理读事件的函数
   }
   */
   loop_->assertInLoopThread();
+  lastActivity_ = receiveTime;
+  if (rawReadCallback_)
+  {
+    // 数据由TcpRelay直接搬运，不经过inputBuffer_
+    rawReadCallback_();
+    return;
+  }
   int savedErrno = 0;
+  acquireBuffer(&inputBuffer_);
   ssize_t n = inputBuffer_.readFd(channel_->fd(), &savedErrno);//直接将数据读到inputBuffer_缓冲区
   if (n > 0)
   {
-    messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+    ++stats_.reads;
+    stats_.bytesRead += n;
+    if (inputBuffer_.readableBytes() < readThreshold())
+    {
+      // 还不够用户解析，先攒着
+      holdInput(receiveTime);
+    }
+    else
+    {
+      deliverInput(receiveTime);
+    }
+    updateBufferedBytes();
+    if (overBufferedBytesLimit(g_bufferedBytes.get()) && !(readPaused_ & kPausedByMemory))
+    {
+      LOG_WARN << "TcpConnection::handleRead [" << name_
+               << "] - buffered bytes over limit, stop reading";
+      pauseRead(kPausedByMemory);
+      waitForMemory();
+    }
   }
   else if (n == 0)
   {
+    if (inputHeld_)
+    {
+      // 对端关闭前发来的数据还没交给用户
+      deliverInput(heldReceiveTime_);
+    }
     handleClose();//如果读到的数据为0，就自动退出
   }
   else
@@ -322,33 +1045,54 @@ void TcpConnection::handleRead(Timestamp receiveTime)//处理读事件的函数
 void TcpConnection::handleWrite()
 {
   loop_->assertInLoopThread();
+  lastActivity_ = loop_->pollReturnTime();
+  adaptHighWaterMark();
   if (channel_->isWriting())//查看是否有写事件需要关注
   {
-    ssize_t n = sockets::write(channel_->fd(),
-                               outputBuffer_.peek(),
-                               outputBuffer_.readableBytes());//写到文件描述符中去
-    if (n > 0)
+    if (rawWriteCallback_ && pendingOutputBytes() == 0)
+    {
+      rawWriteCallback_();
+      return;
+    }
+    ssize_t n = 0;
+    if (!outputSegments_.empty()
+        && outputSegments_.front()->kind == detail::OutputSegment::kPayload)
+    {
+      n = writePayloadSegment();
+    }
+    else if (outputBuffer_.readableBytes() > 0)
     {
-      outputBuffer_.retrieve(n);//处理读写指针
-      if (outputBuffer_.readableBytes() == 0)	 // 发送缓冲区已清空
+      n = sockets::write(channel_->fd(),
+                         outputBuffer_.peek(),
+                         outputBuffer_.readableBytes());//写到文件描述符中去
+      if (n > 0)
       {
-        channel_->disableWriting();		// 停止关注POLLOUT事件，以免出现busy loop
-        if (writeCompleteCallback_)		// 回调writeCompleteCallback_
-        {
-          // 应用层发送缓冲区被清空，就回调用writeCompleteCallback_
-          // 发送给IO线程进行处理
-          loop_->queueInLoop(boost::bind(writeCompleteCallback_, shared_from_this()));
-        }
-        if (state_ == kDisconnecting)	// 发送缓冲区已清空并且连接状态是kDisconnecting, 要关闭连接
-        {
-          shutdownInLoop();		// 关闭写连接
-        }
+        outputBuffer_.retrieve(n);//处理读写指针
+        updateBufferedBytes();
       }
-      else
+    }
+    else
+    {
+      // outputBuffer_已经发完，发送排在后面的段
+      assert(!outputSegments_.empty());
+      detail::OutputSegment* segment = outputSegments_.front().get();
+      size_t before = segment->remaining;
+      n = writeSegment(segment);
+      queuedBytes_ -= before - segment->remaining;
+      if (segment->remaining == 0)
+      {
+        popSegment();
+      }
+      if (state_ == kDisconnected)
       {
-        LOG_TRACE << "I am going to write more data";
+        return;		// 文件段发不完，writeSegment()已经关闭了连接
       }
     }
+    countWritten(n);
+    if (n >= 0)
+    {
+      afterWrite();
+    }
     else
     {
       LOG_SYSERR << "TcpConnection::handleWrite";
@@ -365,6 +1109,316 @@ void TcpConnection::handleWrite()
   }
 }
 
+// 文件段用sendfile发送，内存段用MSG_ZEROCOPY发送，Payload段直接write，返回值同write
+// 文件比预期的短或者sendfile出错时返回0，并且关闭连接
+ssize_t TcpConnection::writeSegment(detail::OutputSegment* segment)
+{
+  ssize_t n = 0;
+  if (segment->kind == detail::OutputSegment::kPayload)
+  {
+    n = sockets::write(channel_->fd(), segment->unsent(), segment->remaining);
+  }
+  else if (segment->kind == detail::OutputSegment::kFile)
+  {
+    n = sockets::sendfile(channel_->fd(), segment->fd,
+                          &segment->offset, segment->remaining);
+    if (n == 0)
+    {
+      // 对端还等着remaining字节，再发别的数据会被当成实体，只能立即关闭连接
+      LOG_ERROR << "TcpConnection::writeSegment [" << name_
+                << "] - file is shorter than expected, " << segment->remaining
+                << " bytes not sent, closing";
+      segment->remaining = 0;
+      forceCloseInLoop();
+    }
+    else if (n < 0 && errno != EAGAIN)
+    {
+      // 读不了的fd（管道、socket）或者读文件出错，段留在队首的话socket一直可写，会忙等
+      LOG_SYSERR << "TcpConnection::writeSegment [" << name_
+                 << "] - sendfile failed, " << segment->remaining
+                 << " bytes not sent, closing";
+      n = 0;
+      segment->remaining = 0;
+      forceCloseInLoop();
+    }
+  }
+  else
+  {
+    const char* data = segment->unsent();
+    n = sockets::sendZeroCopy(channel_->fd(), data, segment->remaining);
+    if (n >= 0)
+    {
+      // 每次成功的MSG_ZEROCOPY发送占一个序号
+      segment->zeroCopySent = true;
+      segment->lastSendId = nextZeroCopyId_++;
+    }
+    else if (errno == ENOBUFS)
+    {
+      // 超过了可锁定内存的上限，这次退回普通拷贝
+      n = sockets::write(channel_->fd(), data, segment->remaining);
+    }
+  }
+  if (n > 0)
+  {
+    segment->remaining -= n;
+  }
+  return n;
+}
+
+// 队首是Payload段时，outputBuffer_、Payload剩下的部分和trailer用一次writev发出去
+ssize_t TcpConnection::writePayloadSegment()
+{
+  detail::OutputSegment* segment = outputSegments_.front().get();
+  assert(segment->kind == detail::OutputSegment::kPayload);
+  struct iovec vec[3];
+  int iovcnt = 0;
+  size_t headLen = outputBuffer_.readableBytes();
+  size_t trailerLen = segment->trailer.readableBytes();
+  if (headLen > 0)
+  {
+    vec[iovcnt].iov_base = const_cast<char*>(outputBuffer_.peek());
+    vec[iovcnt].iov_len = headLen;
+    ++iovcnt;
+  }
+  vec[iovcnt].iov_base = const_cast<char*>(segment->unsent());
+  vec[iovcnt].iov_len = segment->remaining;
+  ++iovcnt;
+  if (trailerLen > 0)
+  {
+    vec[iovcnt].iov_base = const_cast<char*>(segment->trailer.peek());
+    vec[iovcnt].iov_len = trailerLen;
+    ++iovcnt;
+  }
+  ssize_t n = sockets::writev(channel_->fd(), vec, iovcnt);
+  if (n > 0)
+  {
+    // 按顺序把写出去的字节分摊到三段上
+    size_t left = static_cast<size_t>(n);
+    size_t fromHead = std::min(left, headLen);
+    if (fromHead > 0)
+    {
+      outputBuffer_.retrieve(fromHead);
+      updateBufferedBytes();
+      left -= fromHead;
+    }
+    size_t fromPayload = std::min(left, segment->remaining);
+    segment->remaining -= fromPayload;
+    left -= fromPayload;
+    if (left > 0)
+    {
+      segment->trailer.retrieve(left);
+    }
+    queuedBytes_ -= fromPayload + left;
+    if (segment->remaining == 0)
+    {
+      popSegment();
+    }
+  }
+  return n;
+}
+
+// 队首的段发完，零拷贝发送过的段留着等完成通知，它后面的数据移到outputBuffer_中
+// 全部退回普通拷贝的段没有完成通知可等，直接释放
+void TcpConnection::popSegment()
+{
+  assert(outputBuffer_.readableBytes() == 0);
+  boost::shared_ptr<detail::OutputSegment> segment(outputSegments_.front());
+  outputSegments_.pop_front();
+  if (segment->zeroCopySent)
+  {
+    pinnedSegments_.push_back(segment);
+  }
+  size_t trailerLen = segment->trailer.readableBytes();
+  if (trailerLen > 0)
+  {
+    releaseBuffer(&outputBuffer_);
+    outputBuffer_.swap(segment->trailer);
+    queuedBytes_ -= trailerLen;
+    updateBufferedBytes();
+  }
+}
+
+void TcpConnection::acquireBuffer(Buffer* buf)
+{
+  if (lowMemoryMode_)
+  {
+    loop_->bufferPool()->acquire(buf);
+  }
+}
+
+void TcpConnection::releaseBuffer(Buffer* buf)
+{
+  if (lowMemoryMode_)
+  {
+    loop_->bufferPool()->release(buf);
+  }
+}
+
+void TcpConnection::shrinkBuffer(Buffer* buf)
+{
+  if (shrinkThreshold_ > 0
+      && buf->internalCapacity() > shrinkThreshold_
+      && buf->readableBytes() < Buffer::kInitialSize)
+  {
+    LOG_TRACE << "shrink buffer of " << buf->internalCapacity() << " bytes";
+    buf->shrink(Buffer::kInitialSize);
+  }
+}
+
+void TcpConnection::updateBufferedBytes()
+{
+  int64_t bytes = static_cast<int64_t>(inputBuffer_.readableBytes()
+                                       + outputBuffer_.readableBytes());
+  int64_t delta = bytes - bufferedBytes_;
+  if (delta != 0)
+  {
+    bufferedBytes_ = bytes;
+    int64_t total = g_bufferedBytes.addAndGet(delta);
+    if (delta > 0)
+    {
+      updatePeak(total);
+    }
+  }
+}
+
+void TcpConnection::pauseRead(int reason)
+{
+  loop_->assertInLoopThread();
+  if (readPaused_ == 0 && channel_->isReading())
+  {
+    channel_->disableReading();
+  }
+  readPaused_ |= reason;
+}
+
+void TcpConnection::resumeRead(int reason)
+{
+  loop_->assertInLoopThread();
+  readPaused_ &= ~reason;
+  if (readPaused_ == 0
+      && (state_ == kConnected || state_ == kDisconnecting)
+      && !channel_->isReading())
+  {
+    channel_->enableReading();
+  }
+}
+
+void TcpConnection::setReadBatching(size_t minBytes, double maxDelay)
+{
+  minReadBytes_ = minBytes;
+  readBatchDelay_ = maxDelay;
+  if (state_ == kConnected)
+  {
+    loop_->assertInLoopThread();
+    updateRcvLowat();
+  }
+}
+
+void TcpConnection::setExpectedFrameLength(size_t length)
+{
+  loop_->assertInLoopThread();
+  expectedFrameLength_ = length;
+}
+
+void TcpConnection::deliverInput(Timestamp receiveTime)
+{
+  inputHeld_ = false;
+  ++readHoldSeq_;		// 作废还没到期的定时器
+  expectedFrameLength_ = 0;
+  messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+  if (inputBuffer_.readableBytes() == 0)
+  {
+    releaseBuffer(&inputBuffer_);
+  }
+  shrinkBuffer(&inputBuffer_);
+  updateRcvLowat();
+}
+
+void TcpConnection::holdInput(Timestamp receiveTime)
+{
+  if (!inputHeld_)
+  {
+    inputHeld_ = true;
+    heldReceiveTime_ = receiveTime;	// 回调时给出第一块数据到达的时间
+    if (readBatchDelay_ > 0)
+    {
+      loop_->runAfter(readBatchDelay_,
+                      boost::bind(&TcpConnection::readBatchTimeout, shared_from_this(), readHoldSeq_));
+    }
+  }
+  updateRcvLowat();
+}
+
+void TcpConnection::readBatchTimeout(int seq)
+{
+  loop_->assertInLoopThread();
+  if (seq != readHoldSeq_ || !inputHeld_ || state_ == kDisconnected)
+  {
+    return;
+  }
+  if (readPaused_ == 0)
+  {
+    // 不够SO_RCVLOWAT的数据还留在内核里，先取上来，EOF和错误留给handleRead处理
+    int savedErrno = 0;
+    acquireBuffer(&inputBuffer_);
+    ssize_t n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
+    if (n > 0)
+    {
+      ++stats_.reads;
+      stats_.bytesRead += n;
+    }
+  }
+  deliverInput(heldReceiveTime_);
+  updateBufferedBytes();
+}
+
+// 让epoll在凑够readThreshold()之前不报告可读
+void TcpConnection::updateRcvLowat()
+{
+  size_t threshold = readThreshold();
+  size_t readable = inputBuffer_.readableBytes();
+  size_t need = threshold > readable ? threshold - readable : 1;
+  int lowat = static_cast<int>(std::min(need, kMaxRcvLowat));
+  if (lowat != rcvLowat_ && sockets::setRcvLowat(channel_->fd(), lowat))
+  {
+    rcvLowat_ = lowat;
+  }
+}
+
+void TcpConnection::waitForMemory()
+{
+  MemoryRetryList& list = g_memoryRetryLists.value();
+  list.connections.push_back(shared_from_this());
+  if (!list.timerArmed)
+  {
+    list.timerArmed = true;
+    loop_->runAfter(kMemoryRetryDelay, boost::bind(&TcpConnection::retryReadsInLoop, loop_));
+  }
+}
+
+// 本线程所有因为内存超限暂停读的连接一起检查
+void TcpConnection::retryReadsInLoop(EventLoop* loop)
+{
+  loop->assertInLoopThread();
+  MemoryRetryList& list = g_memoryRetryLists.value();
+  if (overBufferedBytesLimit(g_bufferedBytes.get()))
+  {
+    loop->runAfter(kMemoryRetryDelay, boost::bind(&TcpConnection::retryReadsInLoop, loop));
+    return;
+  }
+  list.timerArmed = false;
+  std::vector<boost::weak_ptr<TcpConnection> > connections;
+  connections.swap(list.connections);
+  for (size_t i = 0; i < connections.size(); ++i)
+  {
+    TcpConnectionPtr conn(connections[i].lock());
+    if (conn && (conn->readPaused_ & kPausedByMemory) && conn->state_ != kDisconnected)
+    {
+      conn->resumeRead(kPausedByMemory);
+    }
+  }
+}
+
 void TcpConnection::handleClose()//关闭事件处理，也是epoll如果发生关闭事件的回调函数
 {
   loop_->assertInLoopThread();
@@ -373,8 +1427,14 @@ void TcpConnection::handleClose()//关闭事件处理，也是epoll如果发生
   // we don't close fd, leave it to dtor, so we can find leaks easily.
   setState(kDisconnected);
   channel_->disableAll();
+  releaseFlowControlReaders();
 
   TcpConnectionPtr guardThis(shared_from_this());
+  if (rawCloseCallback_)
+  {
+    // 告诉TcpRelay，让它关闭另一端
+    rawCloseCallback_();
+  }
   connectionCallback_(guardThis);		// 在结束前，最后一次处理一下，这一行，可以不调用
   LOG_TRACE << "[7] usecount=" << guardThis.use_count();
   // must be the last line
@@ -382,6 +1442,40 @@ void TcpConnection::handleClose()//关闭事件处理，也是epoll如果发生
   LOG_TRACE << "[11] usecount=" << guardThis.use_count();
 }
 
+// 读出MSG_ZEROCOPY的完成通知，释放已完成的零拷贝段
+void TcpConnection::handleErrorQueue()
+{
+  loop_->assertInLoopThread();
+  uint32_t lo = 0;
+  uint32_t hi = 0;
+  bool copied = false;
+  int ret = 0;
+  bool gotCompletion = false;
+  while ((ret = sockets::readZeroCopyCompletion(channel_->fd(), &lo, &hi, &copied)) >= 0)
+  {
+    if (ret == 0)
+    {
+      continue;
+    }
+    gotCompletion = true;
+    // 通知可能乱序，前面的发送都完成了才能放掉后面的段
+    zeroCopyCompletions_.complete(lo, hi);
+    if (copied)
+    {
+      zeroCopyCopied_ += hi - lo + 1;
+    }
+  }
+  while (!pinnedSegments_.empty()
+         && zeroCopyCompletions_.done(pinnedSegments_.front()->lastSendId))
+  {
+    pinnedSegments_.pop_front();
+  }
+  if (!gotCompletion)
+  {
+    handleError();
+  }
+}
+
 void TcpConnection::handleError()//处理错误的函数，也是epoll如果发生错误事件的回调函数
 {
   int err = sockets::getSocketError(channel_->fd());
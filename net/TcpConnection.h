@@ -18,13 +18,26 @@
 #include <muduo/base/Types.h>
 #include <muduo/net/Callbacks.h>
 #include <muduo/net/Buffer.h>
+#include <muduo/net/ConnectionStats.h>
 #include <muduo/net/InetAddress.h>
+#include <muduo/net/Payload.h>
+#include <muduo/net/ZeroCopyCompletions.h>
 
+#include <boost/aligned_storage.hpp>
 #include <boost/any.hpp>
 #include <boost/enable_shared_from_this.hpp>
 #include <boost/noncopyable.hpp>
 #include <boost/scoped_ptr.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/static_assert.hpp>
+#include <boost/weak_ptr.hpp>
+
+#include <deque>
+#include <new>
+#include <vector>
+
+#include <assert.h>
+#include <sys/types.h>
 
 namespace muduo
 {
@@ -35,6 +48,11 @@ class Channel;
 class EventLoop;
 class Socket;
 
+namespace detail
+{
+struct OutputSegment;
+}
+
 ///
 /// TCP connection, for both client and server usage.
 ///
@@ -64,9 +82,34 @@ class TcpConnection : boost::noncopyable,
   void send(const StringPiece& message);
   // void send(Buffer&& message); // C++11
   void send(Buffer* message);  // this one will swap data
+  /// Queues a shared payload without copying it, the connection holds a
+  /// reference until the bytes are written.  Send the same PayloadPtr to
+  /// many connections, in any loop, to broadcast a message.
+  /// Thread safe.
+  void send(const PayloadPtr& payload);
+  /// Sends @c length bytes of file @c fd from @c offset with sendfile(2),
+  /// in order with data sent before and after.  The fd is dup()ed,
+  /// caller may close it once this returns.
+  /// Thread safe.
+  void sendFile(int fd, off_t offset, size_t length);
   void shutdown(); // NOT thread safe, no simultaneous calling
+  /// Closes the connection without waiting for the output buffer to drain.
+  /// Thread safe.
+  void forceClose();
   void setTcpNoDelay(bool on);
 
+  /// Resumes/stops reading from the socket.
+  /// Thread safe.
+  void startRead();
+  void stopRead();
+  bool isReading() const { return readPaused_ == 0; } // NOT thread safe, may race with startRead()/stopRead()
+
+  /// Flow control for proxies: stops reading from this connection while
+  /// @c peer has crossed its high water mark, resumes when @c peer drains
+  /// to its low water mark.  The connections may live in different loops.
+  /// Thread safe.
+  void setFlowControlPeer(const TcpConnectionPtr& peer);
+
   void setContext(const boost::any& context)
   { context_ = context; }
 
@@ -76,6 +119,37 @@ class TcpConnection : boost::noncopyable,
   boost::any* getMutableContext()//得到可以改变的context_
   { return &context_; }
 
+  /// Typed context stored inside the connection, for protocol state that
+  /// lives as long as the connection.  Unlike setContext() it costs no
+  /// heap allocation per connection and no checked cast per message.
+  /// emplaceContext<T>() default constructs a T in place, replacing any
+  /// previous one; context<T>() must name the same T.
+  /// sizeof(T) must not exceed kContextSize.
+  /// NOT thread safe, use in loop thread.
+  static const size_t kContextSize = 256;
+
+  template<typename T>
+  T* emplaceContext()
+  {
+    BOOST_STATIC_ASSERT(sizeof(T) <= kContextSize);
+    destroyContext();
+    T* context = new (contextStorage_.address()) T;
+    contextDestructor_ = &destroyInPlace<T>;
+    return context;
+  }
+
+  template<typename T>
+  T* context()
+  {
+    assert(contextDestructor_ == &destroyInPlace<T>);
+    return static_cast<T*>(contextStorage_.address());
+  }
+
+  bool hasContext() const
+  { return contextDestructor_ != NULL; }
+
+  void destroyContext();
+
   void setConnectionCallback(const ConnectionCallback& cb)
   { connectionCallback_ = cb; }//在handleClose，connectEstablished，connectDestroyed中调用，个人理解这个连接回调函数主要起到
   //显示作用，就是在和连接描述符建立连接或者关闭连接前，显示连接状态的，表明还在连接中
@@ -87,15 +161,148 @@ class TcpConnection : boost::noncopyable,
   { writeCompleteCallback_ = cb; }//在handleWrite和sendInLoop写函数中，写完调用的
 
   void setHighWaterMarkCallback(const HighWaterMarkCallback& cb, size_t highWaterMark)
-  { highWaterMarkCallback_ = cb; highWaterMark_ = highWaterMark; }//都在sendInLoop中调用了
+  { highWaterMarkCallback_ = cb; highWaterMark_ = highWaterMark; highWaterMarkLimit_ = highWaterMark; }//都在sendInLoop中调用了
+
+  /// Adaptive mode: while sending, samples TCP_INFO every few hundred
+  /// milliseconds and sizes the high water mark and TCP_NOTSENT_LOWAT to
+  /// what the peer drains in @c targetDelay seconds.  The mark given to
+  /// setHighWaterMarkCallback() becomes the upper bound.
+  /// 0 turns it off (the default).
+  /// Must be called before connectEstablished().
+  void setAdaptiveHighWaterMark(double targetDelay)
+  { adaptiveDelay_ = targetDelay; }
+
+  /// Current high water mark, changes over time in adaptive mode.
+  /// NOT thread safe.
+  size_t highWaterMark() const
+  { return highWaterMark_; }
+
+  /// Called once the output buffer drains to @c lowWaterMark bytes
+  /// after having crossed the high water mark.
+  void setLowWaterMarkCallback(const LowWaterMarkCallback& cb, size_t lowWaterMark)
+  { lowWaterMarkCallback_ = cb; lowWaterMark_ = lowWaterMark; }//在handleWrite中调用
 
   Buffer* inputBuffer()
   { return &inputBuffer_; }
 
+  /// Low-memory mode for large numbers of mostly idle connections.
+  /// Buffers hold no storage while empty, and borrow it from
+  /// the loop's BufferPool only while data is in flight.
+  /// Must be called before connectEstablished().
+  void setLowMemoryMode(bool on);
+
+  bool lowMemoryMode() const
+  { return lowMemoryMode_; }
+
+  /// Corked mode: send() in the loop thread only appends to the output
+  /// buffer, and everything sent during one pass of the loop goes out with
+  /// a single write() just before the loop polls again.
+  /// Must be called in loop thread, or before connectEstablished().
+  void setWriteCoalescing(bool on)
+  { writeCoalescing_ = on; }
+
+  bool writeCoalescing() const
+  { return writeCoalescing_; }
+
+  /// Opt-in MSG_ZEROCOPY: send(Buffer*) of at least @c threshold bytes
+  /// takes over the buffer's storage and hands it to the kernel without
+  /// copying, the storage is pinned until the completion notification
+  /// arrives on the socket error queue.  0 turns it off (the default).
+  /// Returns false if the kernel lacks SO_ZEROCOPY.
+  /// Must be called before connectEstablished().
+  bool setZeroCopyThreshold(size_t threshold);
+
+  size_t zeroCopyThreshold() const
+  { return zeroCopyThreshold_; }
+
+  /// Number of zero-copy sends for which the kernel fell back to copying,
+  /// as on loopback.  NOT thread safe.
+  int64_t zeroCopyCopiedCount() const
+  { return zeroCopyCopied_; }
+
+  /// Read batching for peers that trickle small segments: messageCallback
+  /// is invoked once inputBuffer holds @c minBytes, or @c maxDelay seconds
+  /// after the first unreported byte arrived.  SO_RCVLOWAT is set so that
+  /// poll doesn't wake us for less.  0 turns it off (the default).
+  /// Must be called in loop thread, or before connectEstablished().
+  void setReadBatching(size_t minBytes, double maxDelay);
+
+  /// Hint from a codec, typically given in messageCallback after parsing
+  /// a header: don't call back until inputBuffer holds @c length bytes.
+  /// Cleared before each messageCallback.  The maxDelay of
+  /// setReadBatching() applies, if set; EOF delivers what has arrived.
+  /// Must be called in loop thread.
+  void setExpectedFrameLength(size_t length);
+
+  /// Closes the connection after @c seconds without reading or writing,
+  /// see IdleWheel.  0 turns it off (the default).
+  /// Must be called before connectEstablished().
+  void setIdleTimeout(double seconds)
+  { idleTimeout_ = seconds; }
+
+  double idleTimeout() const
+  { return idleTimeout_; }
+
+  /// Time of the last read or write on the socket.
+  /// NOT thread safe.
+  Timestamp lastActivity() const
+  { return lastActivity_; }
+
+  /// Traffic counters with a fresh TCP_INFO sample.
+  /// Must be called in loop thread, see TcpServer::getConnectionStats().
+  ConnectionStats stats() const;
+
+  /// Protocol layers call this once per decoded message,
+  /// HttpServer does so per request.
+  /// Must be called in loop thread.
+  void countMessage()
+  { ++stats_.messages; }
+
+  /// Connections closed for being idle, in all loops.
+  /// Thread safe.
+  static int64_t totalIdleEvictions();
+
+  /// Empty buffers larger than @c bytes give their storage back,
+  /// 0 turns it off.  Default is 1MiB.
+  void setBufferShrinkThreshold(size_t bytes)
+  { shrinkThreshold_ = bytes; }
+
+  /// Bytes held in input and output buffers of all connections.
+  /// Thread safe.
+  static int64_t totalBufferedBytes();
+  static int64_t peakBufferedBytes();
+
+  /// Caps totalBufferedBytes(), 0 means no limit (the default).
+  /// Over the limit, connections stop reading until usage drops,
+  /// and a send() crossing it fires the high water mark callback.
+  /// Thread safe.
+  static void setBufferedBytesLimit(int64_t limit);
+  static int64_t bufferedBytesLimit();
+
   /// Internal use only.
   void setCloseCallback(const CloseCallback& cb)
   { closeCallback_ = cb; }//在handleClose函数中调用
 
+  /// Internal use only, for TcpRelay.
+  /// While set, readiness of the socket is handed to these callbacks
+  /// instead of going through inputBuffer_ and outputBuffer_.
+  /// The writable callback is invoked only after outputBuffer_ drained.
+  /// The closed callback is invoked when the connection goes down for any
+  /// reason, before the connection callback.
+  /// Must be called in loop thread.
+  typedef boost::function<void()> RawIoCallback;
+  void setRawIoCallbacks(const RawIoCallback& readable,
+                         const RawIoCallback& writable,
+                         const RawIoCallback& closed);
+  void setRawReading(bool on);
+  void setRawWriting(bool on);
+  bool rawWritable() const
+  { return pendingOutputBytes() == 0; }
+  int fd() const;
+
+  /// Internal use only, for IdleWheel.
+  void closeIdle();
+
   // called when TcpServer accepts a new connection
   void connectEstablished();   // should be called only once
   // called when TcpServer has removed me from its map
@@ -109,12 +316,59 @@ class TcpConnection : boost::noncopyable,
   void handleError();////绑定channel_的错误函数
   void sendInLoop(const StringPiece& message);
   void sendInLoop(const void* message, size_t len);
+  void sendSegmentInLoop(const boost::shared_ptr<detail::OutputSegment>& segment);
+  ssize_t writeSegment(detail::OutputSegment* segment);
+  ssize_t writePayloadSegment();
+  void popSegment();
+  void handleErrorQueue();
+  size_t pendingOutputBytes() const
+  { return outputBuffer_.readableBytes() + queuedBytes_; }
+  void checkHighWaterMark(size_t oldLen, size_t newLen);
   void shutdownInLoop();
+  void flushInLoop();
+  void afterWrite();
+  void forceCloseInLoop();
   void setState(StateE s) { state_ = s; }//设置状态位
+  void acquireBuffer(Buffer* buf);
+  void releaseBuffer(Buffer* buf);
+  void shrinkBuffer(Buffer* buf);
+  void updateBufferedBytes();
+  // 暂停读的原因，可以同时有多个
+  enum ReadPauseReason { kPausedByMemory = 1, kPausedByUser = 2, kPausedByPeer = 4, kPausedByRelay = 8 };
+  void pauseRead(int reason);
+  void resumeRead(int reason);
+  void waitForMemory();
+  static void retryReadsInLoop(EventLoop* loop);
+  void addFlowControlReaderInLoop(const boost::weak_ptr<TcpConnection>& reader);
+  void notifyFlowControlReaders(bool pause);
+  void releaseFlowControlReaders();
+  void countWritten(ssize_t n)
+  {
+    if (n > 0)
+    {
+      ++stats_.writes;
+      stats_.bytesWritten += n;
+    }
+  }
+  void writeDrained();
+  void adaptHighWaterMark();
+  size_t readThreshold() const
+  { return std::max(minReadBytes_, expectedFrameLength_); }
+  void deliverInput(Timestamp receiveTime);
+  void holdInput(Timestamp receiveTime);
+  void readBatchTimeout(int seq);
+  void updateRcvLowat();
+
+  template<typename T>
+  static void destroyInPlace(void* p)
+  { static_cast<T*>(p)->~T(); }
+  typedef void (*ContextDestructor)(void*);
 
   EventLoop* loop_;			// 所属EventLoop
   string name_;				// 连接名
   StateE state_;  // FIXME: use atomic variable
+  bool lowMemoryMode_;
+  int readPaused_;      // bits of ReadPauseReason
   // we don't expose those classes to client.
   //连接状态
   boost::scoped_ptr<Socket> socket_;
@@ -128,11 +382,50 @@ class TcpConnection : boost::noncopyable,
   WriteCompleteCallback writeCompleteCallback_;		// 数据发送完毕回调函数，即所有的用户数据都已拷贝到内核缓冲区时回调该函数
 													// outputBuffer_被清空也会回调该函数，可以理解为低水位标回调函数
   HighWaterMarkCallback highWaterMarkCallback_;	    // 高水位标回调函数
+  LowWaterMarkCallback lowWaterMarkCallback_;	    // 低水位标回调函数
   CloseCallback closeCallback_;
+  RawIoCallback rawReadCallback_;
+  RawIoCallback rawWriteCallback_;
+  RawIoCallback rawCloseCallback_;
+  bool rawWriting_;
+  bool writeCoalescing_;
+  bool flushPending_;			// 已经安排了flushInLoop
   size_t highWaterMark_;		// 高水位标
+  size_t highWaterMarkLimit_;	// 用户设置的高水位标，自适应模式下的上限
+  double adaptiveDelay_;		// 自适应模式的目标排队时延，0表示不自适应
+  Timestamp lastAdaptTime_;
+  int notSentLowat_;			// 当前的TCP_NOTSENT_LOWAT，0表示没设置
+  size_t minReadBytes_;			// 攒够这么多再回调messageCallback_
+  double readBatchDelay_;		// 最多攒这么久
+  size_t expectedFrameLength_;	// codec给出的提示，每次回调前清零
+  bool inputHeld_;				// inputBuffer_中有还没回调给用户的数据
+  int readHoldSeq_;				// 每次回调加一，用来作废过期的定时器
+  Timestamp heldReceiveTime_;	// 攒着的第一块数据的到达时间
+  int rcvLowat_;				// 当前的SO_RCVLOWAT
+  size_t lowWaterMark_;			// 低水位标
+  bool aboveHighWaterMark_;		// 超过高水位标后，降到低水位标之前为true
+  // 本连接输出缓冲超过高水位标时，要暂停读的那些连接
+  std::vector<boost::weak_ptr<TcpConnection> > flowControlReaders_;
+  size_t shrinkThreshold_;
+  int64_t bufferedBytes_;		// 已计入全局统计的缓冲字节数
   Buffer inputBuffer_;			// 应用层接收缓冲区
   Buffer outputBuffer_;			// 应用层发送缓冲区
+  // 排在outputBuffer_之后的文件段、零拷贝段或Payload段，每段之后再send的数据放在该段的trailer里
+  std::deque<boost::shared_ptr<detail::OutputSegment> > outputSegments_;
+  size_t queuedBytes_;			// outputSegments_中尚未发送的字节数
+  size_t zeroCopyThreshold_;
+  // 已经交给内核、还在等完成通知的零拷贝段
+  std::deque<boost::shared_ptr<detail::OutputSegment> > pinnedSegments_;
+  uint32_t nextZeroCopyId_;		// 下一次MSG_ZEROCOPY发送的序号，内核从0开始编号
+  ZeroCopyCompletions zeroCopyCompletions_;
+  int64_t zeroCopyCopied_;
+  double idleTimeout_;			// 空闲多少秒后关闭，0表示不关闭
+  Timestamp lastActivity_;		// 最后一次收发数据的时间
+  ConnectionStats stats_;
+  Timestamp writeBlockedSince_;	// 待发送数据从无到有的时间，发完后置为无效
   boost::any context_;			// 绑定一个未知类型的上下文对象，一般用来放HttpContext类的
+  boost::aligned_storage<kContextSize> contextStorage_;	// emplaceContext()构造的对象就放在这里
+  ContextDestructor contextDestructor_;	// 为NULL表示没有typed context
 };
 
 typedef boost::shared_ptr<TcpConnection> TcpConnectionPtr;
@@ -0,0 +1,223 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include <muduo/net/TcpRelay.h>
+
+#include <muduo/base/Logging.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/SocketsOps.h>
+
+#include <boost/bind.hpp>
+
+#include <errno.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+// 每个方向管道的大小，受/proc/sys/fs/pipe-max-size限制
+const int kPipeSize = 256*1024;
+
+}
+
+TcpRelay::Direction::Direction()
+  : capacity(0),
+    inPipe(0),
+    readPaused(false),
+    srcEof(false),
+    dstShutdown(false),
+    bytes(0)
+{
+  pipefd[0] = -1;
+  pipefd[1] = -1;
+}
+
+TcpRelayPtr TcpRelay::start(const TcpConnectionPtr& a, const TcpConnectionPtr& b)
+{
+  assert(a->getLoop() == b->getLoop());
+  TcpRelayPtr relay(new TcpRelay(a, b));
+  a->getLoop()->runInLoop(boost::bind(&TcpRelay::startInLoop, relay));
+  return relay;
+}
+
+TcpRelay::TcpRelay(const TcpConnectionPtr& a, const TcpConnectionPtr& b)
+  : loop_(a->getLoop())
+{
+  dirs_[0].src = a;
+  dirs_[0].dst = b;
+  dirs_[1].src = b;
+  dirs_[1].dst = a;
+}
+
+TcpRelay::~TcpRelay()
+{
+  for (int i = 0; i < 2; ++i)
+  {
+    if (dirs_[i].pipefd[0] >= 0)
+    {
+      sockets::close(dirs_[i].pipefd[0]);
+      sockets::close(dirs_[i].pipefd[1]);
+    }
+  }
+}
+
+void TcpRelay::startInLoop()
+{
+  loop_->assertInLoopThread();
+  TcpConnectionPtr conns[2] = { dirs_[0].src.lock(), dirs_[1].src.lock() };
+  if (!conns[0] || !conns[1] || !conns[0]->connected() || !conns[1]->connected())
+  {
+    LOG_WARN << "TcpRelay::startInLoop - connection is down";
+    closeBoth();
+    return;
+  }
+  for (int i = 0; i < 2; ++i)
+  {
+    int capacity = sockets::createPipe(dirs_[i].pipefd, kPipeSize);
+    if (capacity <= 0)
+    {
+      closeBoth();
+      return;
+    }
+    dirs_[i].capacity = static_cast<size_t>(capacity);
+  }
+  for (int i = 0; i < 2; ++i)
+  {
+    // 已经读到inputBuffer中的数据先按普通方式发出去
+    Buffer* input = conns[i]->inputBuffer();
+    if (input->readableBytes() > 0)
+    {
+      conns[1-i]->send(input);
+    }
+    conns[i]->setRawIoCallbacks(
+        boost::bind(&TcpRelay::onReadable, shared_from_this(), i),
+        boost::bind(&TcpRelay::onWritable, shared_from_this(), i),
+        boost::bind(&TcpRelay::closeBoth, shared_from_this()));
+  }
+}
+
+// 连接src可读，把数据搬到dirs_[src]的管道中
+void TcpRelay::onReadable(int src)
+{
+  Direction* dir = &dirs_[src];
+  TcpConnectionPtr conn(dir->src.lock());
+  if (!conn)
+  {
+    return;
+  }
+  bool full = dir->inPipe >= dir->capacity;
+  if (!full)
+  {
+    ssize_t n = sockets::splice(conn->fd(), dir->pipefd[1], dir->capacity - dir->inPipe);
+    if (n > 0)
+    {
+      dir->inPipe += n;
+      dir->bytes += n;
+    }
+    else if (n == 0)
+    {
+      // 对端关闭了写，管道排空后关闭另一端的写
+      dir->srcEof = true;
+      conn->setRawReading(false);
+    }
+    else if (errno == EAGAIN)
+    {
+      // 管道里还有数据时，管道的槽位可能已经用完
+      full = dir->inPipe > 0;
+    }
+    else
+    {
+      LOG_SYSERR << "TcpRelay::onReadable [" << conn->name() << "]";
+      closeBoth();
+      return;
+    }
+  }
+  if (full && !dir->readPaused)
+  {
+    dir->readPaused = true;
+    conn->setRawReading(false);
+  }
+  flush(dir);
+}
+
+// 连接dst可写，它是另一个方向的目的端
+void TcpRelay::onWritable(int dst)
+{
+  flush(&dirs_[1-dst]);
+}
+
+// 把管道中的数据搬到dst，搬不动时关注dst的可写事件
+void TcpRelay::flush(Direction* dir)
+{
+  TcpConnectionPtr dst(dir->dst.lock());
+  if (!dst)
+  {
+    closeBoth();
+    return;
+  }
+  if (!dst->rawWritable())
+  {
+    // outputBuffer中还有数据，等它发完
+    dst->setRawWriting(true);
+    return;
+  }
+  bool progress = false;
+  while (dir->inPipe > 0)
+  {
+    ssize_t n = sockets::splice(dir->pipefd[0], dst->fd(), dir->inPipe);
+    if (n > 0)
+    {
+      dir->inPipe -= n;
+      progress = true;
+    }
+    else if (n < 0 && errno == EAGAIN)
+    {
+      break;
+    }
+    else
+    {
+      LOG_SYSERR << "TcpRelay::flush [" << dst->name() << "]";
+      closeBoth();
+      return;
+    }
+  }
+  dst->setRawWriting(dir->inPipe > 0);
+
+  if (progress && dir->readPaused && !dir->srcEof)
+  {
+    TcpConnectionPtr src(dir->src.lock());
+    if (src)
+    {
+      dir->readPaused = false;
+      src->setRawReading(true);
+    }
+  }
+  if (dir->inPipe == 0 && dir->srcEof && !dir->dstShutdown)
+  {
+    dir->dstShutdown = true;
+    dst->shutdown();
+    if (dirs_[0].dstShutdown && dirs_[1].dstShutdown)
+    {
+      closeBoth();
+    }
+  }
+}
+
+void TcpRelay::closeBoth()
+{
+  for (int i = 0; i < 2; ++i)
+  {
+    TcpConnectionPtr conn(dirs_[i].src.lock());
+    if (conn)
+    {
+      conn->forceClose();
+    }
+  }
+}
@@ -0,0 +1,86 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+/* TcpRelay把两个TcpConnection对接起来，每个方向用一个管道，
+ * 用splice把数据从一个套接字搬到管道，再从管道搬到另一个套接字，数据不进入用户空间。
+ */
+#ifndef MUDUO_NET_TCPRELAY_H
+#define MUDUO_NET_TCPRELAY_H
+
+#include <muduo/net/TcpConnection.h>
+
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+
+namespace muduo
+{
+namespace net
+{
+
+class TcpRelay;
+typedef boost::shared_ptr<TcpRelay> TcpRelayPtr;
+
+///
+/// Relays bytes between two connections of the same loop with splice(2).
+///
+/// Each direction has its own pipe; reading stops while the pipe is full
+/// and resumes once the other side has taken data, so a slow peer
+/// backpressures the fast one.  EOF on one side shuts down writing on the
+/// other after the pipe has drained; once both directions are done both
+/// connections are closed.  If either connection goes down, by an error,
+/// RST or forceClose(), the other is closed too.
+/// The relay is owned by the two connections.
+class TcpRelay : boost::noncopyable,
+                 public boost::enable_shared_from_this<TcpRelay>
+{
+ public:
+  /// Starts relaying, bytes already in the input buffers are sent first.
+  /// Thread safe.
+  static TcpRelayPtr start(const TcpConnectionPtr& a, const TcpConnectionPtr& b);
+
+  ~TcpRelay();
+
+  /// Bytes relayed from a to b, and from b to a.  NOT thread safe.
+  int64_t bytesAtoB() const { return dirs_[0].bytes; }
+  int64_t bytesBtoA() const { return dirs_[1].bytes; }
+
+ private:
+  // 一个方向：从src读，经管道写到dst
+  struct Direction
+  {
+    Direction();
+
+    boost::weak_ptr<TcpConnection> src;
+    boost::weak_ptr<TcpConnection> dst;
+    int pipefd[2];
+    size_t capacity;    // 管道容量
+    size_t inPipe;      // 管道中的字节数
+    bool readPaused;    // 管道满了，暂停读src
+    bool srcEof;
+    bool dstShutdown;
+    int64_t bytes;
+  };
+
+  TcpRelay(const TcpConnectionPtr& a, const TcpConnectionPtr& b);
+  void startInLoop();
+  void onReadable(int src);
+  void onWritable(int dst);
+  void flush(Direction* dir);
+  void closeBoth();
+
+  EventLoop* loop_;
+  Direction dirs_[2];   // dirs_[0]: a->b, dirs_[1]: b->a
+};
+
+}
+}
+
+#endif  // MUDUO_NET_TCPRELAY_H
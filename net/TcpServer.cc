@@ -8,6 +8,7 @@
 
 #include <muduo/net/TcpServer.h>
 
+#include <muduo/base/CountDownLatch.h>
 #include <muduo/base/Logging.h>
 #include <muduo/net/Acceptor.h>
 #include <muduo/net/EventLoop.h>
@@ -21,6 +22,35 @@
 using namespace muduo;
 using namespace muduo::net;
 
+namespace
+{
+
+void runAndCountDown(const boost::function<void()>& func, CountDownLatch* latch)
+{
+  func();
+  latch->countDown();
+}
+
+// 在loop线程中取属于这个loop的连接的统计
+void collectStats(EventLoop* loop,
+                  const std::vector<TcpConnectionPtr>* conns,
+                  TcpServer::ConnectionStatsList* result,
+                  ConnectionStats* sum)
+{
+  for (size_t i = 0; i < conns->size(); ++i)
+  {
+    const TcpConnectionPtr& conn = (*conns)[i];
+    if (conn->getLoop() == loop)
+    {
+      ConnectionStats stats(conn->stats());
+      sum->add(stats);
+      (*result)[i] = std::make_pair(conn, stats);
+    }
+  }
+}
+
+}
+
 TcpServer::TcpServer(EventLoop* loop,
                      const InetAddress& listenAddr,
                      const string& nameArg)
@@ -32,6 +62,13 @@ TcpServer::TcpServer(EventLoop* loop,
     connectionCallback_(defaultConnectionCallback),
     messageCallback_(defaultMessageCallback),
     started_(false),
+    lowMemoryMode_(false),
+    writeCoalescing_(false),
+    zeroCopyThreshold_(0),
+    idleTimeout_(0.0),
+    adaptiveDelay_(0.0),
+    minReadBytes_(0),
+    readBatchDelay_(0.0),
     nextConnId_(1)
 {
   // Acceptor::handleRead函数中会回调用TcpServer::newConnection
@@ -116,6 +153,15 @@ void TcpServer::newConnection(int sockfd, const InetAddress& peerAddr)//建立
   conn->setConnectionCallback(connectionCallback_);
   conn->setMessageCallback(messageCallback_);
   conn->setWriteCompleteCallback(writeCompleteCallback_);//无论是否非空，都可以先设置，在使用之前会有判断
+  conn->setLowMemoryMode(lowMemoryMode_);
+  conn->setWriteCoalescing(writeCoalescing_);
+  conn->setIdleTimeout(idleTimeout_);
+  conn->setAdaptiveHighWaterMark(adaptiveDelay_);
+  conn->setReadBatching(minReadBytes_, readBatchDelay_);
+  if (zeroCopyThreshold_ > 0)
+  {
+    conn->setZeroCopyThreshold(zeroCopyThreshold_);
+  }
 
   conn->setCloseCallback(
       boost::bind(&TcpServer::removeConnection, this, _1));
@@ -177,3 +223,41 @@ void TcpServer::  removeConnectionInLoop(const TcpConnectionPtr& conn)//就是
 
   
 }
+
+void TcpServer::listConnectionsInLoop(std::vector<TcpConnectionPtr>* conns,
+                                      std::vector<EventLoop*>* loops)
+{
+  loop_->assertInLoopThread();
+  for (ConnectionMap::const_iterator it = connections_.begin();
+       it != connections_.end(); ++it)
+  {
+    conns->push_back(it->second);
+  }
+  *loops = threadPool_->getAllLoops();
+}
+
+void TcpServer::getConnectionStats(ConnectionStatsList* conns,
+                                   std::vector<ConnectionStats>* perLoop)
+{
+  std::vector<TcpConnectionPtr> list;
+  std::vector<EventLoop*> loops;
+  {
+    CountDownLatch latch(1);
+    loop_->runInLoop(boost::bind(runAndCountDown,
+        boost::function<void()>(boost::bind(&TcpServer::listConnectionsInLoop, this, &list, &loops)),
+        &latch));
+    latch.wait();
+  }
+
+  // 每个loop只填自己那些连接对应的位置，互不干扰
+  conns->assign(list.size(), ConnectionStatsList::value_type());
+  perLoop->assign(loops.size(), ConnectionStats());
+  CountDownLatch latch(static_cast<int>(loops.size()));
+  for (size_t i = 0; i < loops.size(); ++i)
+  {
+    loops[i]->runInLoop(boost::bind(runAndCountDown,
+        boost::function<void()>(boost::bind(collectStats, loops[i], &list, conns, &(*perLoop)[i])),
+        &latch));
+  }
+  latch.wait();
+}
@@ -22,6 +22,8 @@
 #include <muduo/net/TcpConnection.h>
 
 #include <map>
+#include <utility>
+#include <vector>
 #include <boost/noncopyable.hpp>
 #include <boost/scoped_ptr.hpp>
 
@@ -42,6 +44,7 @@ class TcpServer : boost::noncopyable
 {
  public:
   typedef boost::function<void(EventLoop*)> ThreadInitCallback;
+  typedef std::vector<std::pair<TcpConnectionPtr, ConnectionStats> > ConnectionStatsList;
 
   //TcpServer(EventLoop* loop, const InetAddress& listenAddr);
   TcpServer(EventLoop* loop,
@@ -90,6 +93,50 @@ class TcpServer : boost::noncopyable
   void setWriteCompleteCallback(const WriteCompleteCallback& cb)
   { writeCompleteCallback_ = cb; }
 
+  /// Puts new connections in low-memory mode,
+  /// see TcpConnection::setLowMemoryMode().
+  /// Not thread safe.
+  void setLowMemoryMode(bool on)
+  { lowMemoryMode_ = on; }
+
+  /// Puts new connections in corked mode,
+  /// see TcpConnection::setWriteCoalescing().
+  /// Not thread safe.
+  void setWriteCoalescing(bool on)
+  { writeCoalescing_ = on; }
+
+  /// Enables MSG_ZEROCOPY on new connections,
+  /// see TcpConnection::setZeroCopyThreshold().
+  /// Not thread safe.
+  void setZeroCopyThreshold(size_t threshold)
+  { zeroCopyThreshold_ = threshold; }
+
+  /// Puts new connections in adaptive high water mark mode,
+  /// see TcpConnection::setAdaptiveHighWaterMark().
+  /// Not thread safe.
+  void setAdaptiveHighWaterMark(double targetDelay)
+  { adaptiveDelay_ = targetDelay; }
+
+  /// Batches reads of new connections,
+  /// see TcpConnection::setReadBatching().
+  /// Not thread safe.
+  void setReadBatching(size_t minBytes, double maxDelay)
+  { minReadBytes_ = minBytes; readBatchDelay_ = maxDelay; }
+
+  /// Closes connections idle for @c seconds,
+  /// see TcpConnection::setIdleTimeout().
+  /// Not thread safe.
+  void setIdleTimeout(double seconds)
+  { idleTimeout_ = seconds; }
+
+  /// Snapshots TcpConnection::stats() of every connection in its own loop,
+  /// and sums them per loop.  Blocks until all loops have answered, so
+  /// don't call it from an IO thread of this server other than the base
+  /// loop's; the Inspector's thread is fine.
+  /// Thread safe.
+  void getConnectionStats(ConnectionStatsList* conns,
+                          std::vector<ConnectionStats>* perLoop);
+
 
  private:
   /// Not thread safe, but in loop
@@ -99,6 +146,9 @@ class TcpServer : boost::noncopyable
   void removeConnection(const TcpConnectionPtr& conn);
   /// Not thread safe, but in loop，在上面这个函数removeConnection中调用
   void removeConnectionInLoop(const TcpConnectionPtr& conn);
+  /// Not thread safe, but in loop
+  void listConnectionsInLoop(std::vector<TcpConnectionPtr>* conns,
+                             std::vector<EventLoop*>* loops);
 
   typedef std::map<string, TcpConnectionPtr> ConnectionMap;
 
@@ -112,6 +162,13 @@ class TcpServer : boost::noncopyable
   WriteCompleteCallback writeCompleteCallback_;		// 数据发送完毕，会回调此函数
   ThreadInitCallback threadInitCallback_;	// IO线程池中的线程在进入事件循环前，会回调用此函数
   bool started_;
+  bool lowMemoryMode_;
+  bool writeCoalescing_;
+  size_t zeroCopyThreshold_;
+  double idleTimeout_;
+  double adaptiveDelay_;
+  size_t minReadBytes_;
+  double readBatchDelay_;
   // always in loop thread
   int nextConnId_;				// 下一个连接ID,每次增加一个就加1
   ConnectionMap connections_;	// 连接列表
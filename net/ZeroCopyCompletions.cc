@@ -0,0 +1,36 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include <muduo/net/ZeroCopyCompletions.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+void ZeroCopyCompletions::complete(uint32_t lo, uint32_t hi)
+{
+  ranges_.push_back(std::make_pair(lo, hi));
+  // 只有从next_开始连续的区间能往前推，其余的留着等前面的完成
+  size_t i = 0;
+  while (i < ranges_.size())
+  {
+    if (static_cast<int32_t>(ranges_[i].first - next_) <= 0)
+    {
+      if (static_cast<int32_t>(ranges_[i].second + 1 - next_) > 0)
+      {
+        next_ = ranges_[i].second + 1;
+      }
+      ranges_[i] = ranges_.back();
+      ranges_.pop_back();
+      i = 0;	// next_变了，留着的区间要重新看
+    }
+    else
+    {
+      ++i;
+    }
+  }
+}
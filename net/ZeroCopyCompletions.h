@@ -0,0 +1,66 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+/*记录一个socket的MSG_ZEROCOPY发送哪些已经完成。内核按区间通知，
+ *一般按顺序，但重传等情况下会乱序，只有前面的都完成了才算完成*/
+#ifndef MUDUO_NET_ZEROCOPYCOMPLETIONS_H
+#define MUDUO_NET_ZEROCOPYCOMPLETIONS_H
+
+#include <muduo/base/copyable.h>
+
+#include <utility>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace muduo
+{
+namespace net
+{
+
+///
+/// Completion tracking for the MSG_ZEROCOPY sends of one socket.
+///
+/// The kernel numbers zero-copy sends from 0 and reports completions as
+/// ranges [lo, hi] of these IDs.  Ranges usually arrive in order, but not
+/// always, e.g. around retransmits.  A send counts as done only when it
+/// and every earlier send have completed.  IDs are 32 bits and wrap around.
+class ZeroCopyCompletions : public muduo::copyable
+{
+ public:
+  ZeroCopyCompletions()
+    : next_(0)
+  {
+  }
+
+  /// Sends @c lo to @c hi inclusive have completed.
+  void complete(uint32_t lo, uint32_t hi);
+
+  /// Send @c id and every one before it have completed.
+  bool done(uint32_t id) const
+  { return static_cast<int32_t>(next_ - id) > 0; }
+
+  /// Every send with an ID below this one has completed.
+  uint32_t completed() const
+  { return next_; }
+
+  /// Ranges that completed ahead of an earlier send.
+  size_t pendingRanges() const
+  { return ranges_.size(); }
+
+ private:
+  uint32_t next_;		// 序号小于它的发送都已完成
+  std::vector<std::pair<uint32_t, uint32_t> > ranges_;	// 前面还有没完成的区间，一般是空的
+};
+
+}
+}
+
+#endif  // MUDUO_NET_ZEROCOPYCOMPLETIONS_H
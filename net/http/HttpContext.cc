@@ -0,0 +1,459 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+
+#include <muduo/net/http/HttpContext.h>
+
+#include <muduo/net/Buffer.h>
+#include <muduo/net/ByteScan.h>
+
+#include <algorithm>
+
+#include <assert.h>
+#include <string.h>
+#include <strings.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+//解析请求行的报头，主要获得请求方法，请求URL和请求方法1.1还是1.0
+//一般请求行相应格式如下：
+//GET http://localhost:8000/home.html HTTP/1.1
+bool HttpContext::processRequestLine(const char* begin, const char* end)//begin和end指向请求信息的头部和尾部
+{
+  bool succeed = false;
+  const char* start = begin;
+  const char* space = scan::find(start, end, ' ');//找到第一个空格处
+  if (space != end && request_.setMethod(start, space))		// 解析请求方法
+  {
+    start = space+1;
+    space = scan::find(start, end, ' ');//找到第二个空格处
+    if (space != end)
+    {
+      request_.setPath(start, space);	// 解析PATH
+      start = space+1;
+      succeed = end-start == 8 && std::equal(start, end-1, "HTTP/1.");
+      if (succeed)
+      {
+        if (*(end-1) == '1')
+        {
+          request_.setVersion(HttpRequest::kHttp11);		// HTTP/1.1
+        }
+        else if (*(end-1) == '0')
+        {
+          request_.setVersion(HttpRequest::kHttp10);		// HTTP/1.0
+        }
+        else
+        {
+          succeed = false;
+        }
+      }
+    }
+  }
+  return succeed;
+}
+
+namespace
+{
+
+// chunk长度行最长多少，足够放下16位十六进制数和常见的扩展
+const size_t kMaxChunkSizeLine = 1024;
+
+bool equalsIgnoreCase(const StringPiece& s, const char* lower)
+{
+  const size_t len = ::strlen(lower);
+  return static_cast<size_t>(s.size()) == len && ::strncasecmp(s.data(), lower, len) == 0;
+}
+
+}
+
+bool HttpContext::fail(int status)
+{
+  errorStatus_ = status;
+  return false;
+}
+
+// 请求头解析完，根据Transfer-Encoding和Content-Length决定怎样接收body
+bool HttpContext::processHeaders()
+{
+  bodyStart_ = parsed_;
+  bodyEnd_ = parsed_;
+  StringPiece encoding = request_.getHeader("Transfer-Encoding");
+  if (!encoding.empty())
+  {
+    // 两个都有时以chunked为准，其他编码不支持
+    if (!equalsIgnoreCase(encoding, "chunked"))
+    {
+      return fail(400);
+    }
+    state_ = kExpectChunkSize;
+    return true;
+  }
+
+  StringPiece length = request_.getHeader("Content-Length");
+  if (length.empty())
+  {
+    state_ = kGotAll;
+    return true;
+  }
+  size_t bytes = 0;
+  for (int i = 0; i < length.size(); ++i)
+  {
+    const char c = length[i];
+    if (c < '0' || c > '9')
+    {
+      return fail(400);
+    }
+    bytes = bytes * 10 + (c - '0');
+    if (bytes > maxBodySize_)
+    {
+      return fail(413);
+    }
+  }
+  remaining_ = bytes;
+  streaming_ = streamThreshold_ > 0 && bytes > streamThreshold_;
+  state_ = bytes > 0 ? kExpectBody : kGotAll;
+  return true;
+}
+
+// chunk长度行：十六进制长度，后面可能有;开头的扩展
+bool HttpContext::processChunkSize(const char* begin, const char* end)
+{
+  const char* stop = scan::findFirstOf(begin, end, "; \t", 3);
+  if (stop == NULL)
+  {
+    stop = end;
+  }
+  if (begin == stop || stop - begin > 16)
+  {
+    return fail(400);
+  }
+  size_t size = 0;
+  for (const char* p = begin; p < stop; ++p)
+  {
+    int digit = 0;
+    if (*p >= '0' && *p <= '9')
+      digit = *p - '0';
+    else if (*p >= 'a' && *p <= 'f')
+      digit = *p - 'a' + 10;
+    else if (*p >= 'A' && *p <= 'F')
+      digit = *p - 'A' + 10;
+    else
+      return fail(400);
+    size = size * 16 + digit;
+    if (bodyTotal_ + size > maxBodySize_)
+    {
+      return fail(413);
+    }
+  }
+  remaining_ = size;
+  state_ = size > 0 ? kExpectChunkData : kExpectTrailers;
+  return true;
+}
+
+// 收下最多len字节的body，chunk数据往前挪到上一段body后面，解码后的body是连续的
+bool HttpContext::receiveBody(Buffer* buf, size_t len)
+{
+  const size_t n = std::min(len, remaining_);
+  if (bodyEnd_ != parsed_)
+  {
+    char* data = buf->beginWrite() - buf->readableBytes();
+    ::memmove(data + bodyEnd_, data + parsed_, n);
+  }
+  bodyEnd_ += n;
+  parsed_ += n;
+  scanned_ = parsed_;
+  bodyTotal_ += n;
+  remaining_ -= n;
+  if (!streaming_ && streamThreshold_ > 0 && bodyEnd_ - bodyStart_ > streamThreshold_)
+  {
+    streaming_ = true;
+  }
+  return remaining_ == 0;
+}
+
+// return false if any error
+//解析http请求包
+//http数据包有以下几个部分组成
+//请求行
+//请求报头
+//请求体，按Content-Length或者chunked编码接收
+bool HttpContext::parseRequest(Buffer* buf, Timestamp receiveTime)
+{
+  // Buffer可能在两次调用之间搬动过数据，所以每次重新设置起点
+  const char* base = buf->peek();
+  request_.setBase(base);
+  bool ok = true;
+  bool hasMore = true;
+  while (ok && hasMore)
+  {
+    const size_t readable = buf->readableBytes();
+    if (expectRequestLine() || expectHeaders()
+        || state_ == kExpectChunkSize || state_ == kExpectTrailers)
+    {
+      // 请求行加报头、每个chunk长度行、trailer各有长度限制，都是到当前行末尾为止
+      size_t maxLine = maxHeaderSize_;
+      int tooLong = 431;
+      if (state_ == kExpectChunkSize)
+      {
+        maxLine = parsed_ + kMaxChunkSizeLine;
+        tooLong = 400;
+      }
+      else if (state_ == kExpectTrailers)
+      {
+        maxLine = parsed_ + maxHeaderSize_;
+      }
+      // 上次没找到\r\n的部分不再重找，退一个字节以防\r是上次的最后一个字节
+      const char* crlf = buf->findCRLF(base + scanned_);
+      if (!crlf)
+      {
+        scanned_ = std::max(parsed_, readable > 0 ? readable - 1 : 0);
+        ok = readable <= maxLine || fail(tooLong);
+        hasMore = false;
+        continue;
+      }
+      if (static_cast<size_t>(crlf - base) + 2 > maxLine)
+      {
+        ok = fail(tooLong);
+        continue;
+      }
+      const char* line = base + parsed_;
+      if (scan::find(line, crlf, '\n') != crlf)
+      {
+        // 行中间的裸\n，别的实现可能当成换行，留在path或者值里会被误认成另一个请求
+        ok = fail(400);
+        continue;
+      }
+      if (expectRequestLine())	// 处于解析请求行状态
+      {
+        ok = processRequestLine(line, crlf) || fail(400);	// 解析请求行
+        if (ok)
+        {
+          request_.setReceiveTime(receiveTime);		// 设置请求时间
+          state_ = kExpectHeaders;
+        }
+      }
+      else if (expectHeaders())		// 解析请求报头，请求报头的格式“报头名称：报头数据”
+      {
+        const char* colon = scan::find(line, crlf, ':');		//冒号所在位置
+        if (colon != crlf)
+        {
+          request_.addHeader(line, colon, crlf);
+        }
+        else if (line == crlf)//空行，报头解析就结束了
+        {
+          parsed_ = crlf + 2 - base;
+          ok = processHeaders();
+        }
+        else
+        {
+          ok = fail(400);
+        }
+      }
+      else if (state_ == kExpectChunkSize)
+      {
+        ok = processChunkSize(line, crlf);
+      }
+      else if (line == crlf)	// trailer都忽略，空行后请求结束
+      {
+        state_ = kGotAll;
+      }
+      if (ok)
+      {
+        parsed_ = crlf + 2 - base;		// 跳过这一行，包括\r\n
+        scanned_ = parsed_;
+      }
+    }
+    else if (state_ == kExpectBody || state_ == kExpectChunkData)
+    {
+      if (receiveBody(buf, readable - parsed_))
+      {
+        state_ = state_ == kExpectBody ? kGotAll : kExpectChunkEnd;
+      }
+      else
+      {
+        hasMore = false;
+      }
+    }
+    else if (state_ == kExpectChunkEnd)
+    {
+      if (readable - parsed_ < 2)
+      {
+        hasMore = false;
+      }
+      else if (base[parsed_] == '\r' && base[parsed_ + 1] == '\n')
+      {
+        parsed_ += 2;
+        scanned_ = parsed_;
+        state_ = kExpectChunkSize;
+      }
+      else
+      {
+        ok = fail(400);
+      }
+    }
+    else
+    {
+      // kGotAll: 等调用者取走这个请求再reset
+      hasMore = false;
+    }
+    // chunk头和trailer不算在body的长度里，单独限制，否则很小的chunk加上
+    // 很长的扩展能让连接收下比maxBodySize_多得多的数据
+    if (ok && bodyStart_ > 0
+        && chunkOverhead_ + (parsed_ - bodyEnd_) > maxHeaderSize_ + bodyTotal_)
+    {
+      ok = fail(400);
+    }
+  }
+  if (ok && bodyStart_ > 0 && bodyEnd_ < parsed_)
+  {
+    // 解析过的chunk头和trailer不再需要，不留到整个请求结束
+    chunkOverhead_ += parsed_ - bodyEnd_;
+    dropParsed(buf, bodyEnd_);
+  }
+  if (ok && bodyStart_ > 0)
+  {
+    request_.setBody(base + bodyStart_, base + (streaming_ ? bodyStart_ : bodyEnd_));
+    request_.setBodyStreamed(streaming_);
+  }
+  return ok;
+}
+
+StringPiece HttpContext::bodyPiece(const Buffer* buf) const
+{
+  assert(streaming_);
+  return StringPiece(buf->peek() + bodyStart_, static_cast<int>(bodyEnd_ - bodyStart_));
+}
+
+// 把还没解析的部分挪到body开始的地方，Buffer里只留请求行和报头
+void HttpContext::discardBodyPiece(Buffer* buf)
+{
+  assert(streaming_);
+  dropParsed(buf, bodyStart_);
+  bodyEnd_ = bodyStart_;
+}
+
+// 去掉[from, parsed_)，后面还没解析的部分挪上来
+void HttpContext::dropParsed(Buffer* buf, size_t from)
+{
+  const size_t shift = parsed_ - from;
+  const size_t tail = buf->readableBytes() - parsed_;
+  char* data = buf->beginWrite() - buf->readableBytes();
+  ::memmove(data + from, data + parsed_, tail);
+  buf->unwrite(shift);
+  parsed_ -= shift;
+  scanned_ -= shift;
+}
+
+bool HttpContext::finishResponse(int64_t id, Buffer* response, bool close, Buffer* output,
+                                 const HttpStreamPtr& stream, const Body* body)
+{
+  assert(responsesSent_ <= id && id < responsesStarted_);
+  if (closing_)
+  {
+    return true;
+  }
+  if (close && (closeAfter_ < 0 || id < closeAfter_))
+  {
+    closeAfter_ = id;
+  }
+  if (id != responsesSent_)
+  {
+    assert(response != NULL);
+    PendingResponse& pending = pending_[id];
+    pending.data.swap(*response);
+    pending.stream = stream;
+    if (body != NULL)
+    {
+      pending.hasBody = true;
+      pending.body = *body;
+    }
+    return false;
+  }
+
+  if (response != NULL)
+  {
+    output->append(response->peek(), response->readableBytes());
+  }
+  if (body != NULL)
+  {
+    PendingResponse& pending = pending_[id];
+    pending.hasBody = true;
+    pending.body = *body;
+    bodyWaiting_ = true;
+    return false;
+  }
+  if (stream)
+  {
+    setStream(stream);
+    return false;
+  }
+  return advance(output);
+}
+
+bool HttpContext::finishStream(Buffer* output)
+{
+  assert(stream_);
+  stream_.reset();
+  return advance(output);
+}
+
+bool HttpContext::takeBody(Body* body)
+{
+  if (!bodyWaiting_)
+  {
+    return false;
+  }
+  std::map<int64_t, PendingResponse>::iterator it = pending_.begin();
+  assert(it != pending_.end() && it->first == responsesSent_ && it->second.hasBody);
+  *body = it->second.body;
+  pending_.erase(it);
+  bodyWaiting_ = false;
+  return true;
+}
+
+void HttpContext::setStream(const HttpStreamPtr& stream)
+{
+  stream_ = stream;
+  streamStarted_ = false;
+}
+
+// responsesSent_这个应答已经完整地写到output了，把排在后面、已经完成的应答也接上
+bool HttpContext::advance(Buffer* output)
+{
+  while (responsesSent_ != closeAfter_)
+  {
+    ++responsesSent_;
+    std::map<int64_t, PendingResponse>::iterator it = pending_.begin();
+    if (it == pending_.end() || it->first != responsesSent_)
+    {
+      break;
+    }
+    output->append(it->second.data.peek(), it->second.data.readableBytes());
+    HttpStreamPtr stream;
+    stream.swap(it->second.stream);
+    if (it->second.hasBody)
+    {
+      // 实体不拷贝到output里，先让HttpServer把前面的发出去，见takeBody()
+      bodyWaiting_ = true;
+      return false;
+    }
+    pending_.erase(it);
+    if (stream)
+    {
+      setStream(stream);
+      return false;
+    }
+  }
+  if (responsesSent_ == closeAfter_)
+  {
+    closing_ = true;
+    pending_.clear();
+  }
+  return closing_;
+}
@@ -7,13 +7,20 @@
 // Author: Shuo Chen (chenshuo at chenshuo dot com)
 //
 // This is an internal header file, you should not include this.
-/*存储状态机的类，并且有一个HttpRequest作为成员变量，HttpRequestParseState存储的是解析这个HttpRequest到哪一个状态了*/
+/*存储状态机的类，并且有一个HttpRequest作为成员变量，HttpRequestParseState存储的是解析这个HttpRequest到哪一个状态了
+ *解析时不从Buffer中取走数据，只记录偏移，整个请求处理完后再一次取走*/
 #ifndef MUDUO_NET_HTTP_HTTPCONTEXT_H
 #define MUDUO_NET_HTTP_HTTPCONTEXT_H
 
 #include <muduo/base/copyable.h>
+#include <muduo/base/StringPiece.h>
 
+#include <muduo/net/Buffer.h>
+#include <muduo/net/Payload.h>
 #include <muduo/net/http/HttpRequest.h>
+#include <muduo/net/http/HttpStream.h>
+
+#include <map>
 
 namespace muduo
 {
@@ -27,17 +34,83 @@ class HttpContext : public muduo::copyable
   {
     kExpectRequestLine,//当前正处于解析请求行的步骤
     kExpectHeaders,//当前正处于解析请求头部的步骤
-    kExpectBody,//当前正处于解析请求实体的步骤
+    kExpectBody,//当前正处于解析请求实体的步骤，Content-Length
+    kExpectChunkSize,//chunked编码，等待chunk长度行
+    kExpectChunkData,//chunked编码，等待chunk数据
+    kExpectChunkEnd,//chunked编码，等待chunk数据后面的\r\n
+    kExpectTrailers,//chunked编码，最后一个chunk之后的trailer，直到空行
     kGotAll,//解析完毕状态
   };
 
+  static const size_t kDefaultMaxHeaderSize = 64*1024;
+  static const size_t kDefaultMaxBodySize = 1024*1024;
+
   HttpContext()
-    : state_(kExpectRequestLine)//初始状态，期望收到请求行
+    : state_(kExpectRequestLine),//初始状态，期望收到请求行
+      closing_(false),
+      streamStarted_(true),
+      bodyWaiting_(false),
+      parsed_(0),
+      scanned_(0),
+      bodyStart_(0),
+      bodyEnd_(0),
+      bodyTotal_(0),
+      chunkOverhead_(0),
+      remaining_(0),
+      streaming_(false),
+      errorStatus_(0),
+      maxHeaderSize_(kDefaultMaxHeaderSize),
+      maxBodySize_(kDefaultMaxBodySize),
+      streamThreshold_(0),
+      responsesStarted_(0),
+      responsesSent_(0),
+      closeAfter_(-1)
   {
   }
 
   // default copy-ctor, dtor and assignment are fine
 
+  /// Requests with a longer request line plus headers fail with 431.
+  void setMaxHeaderSize(size_t bytes)
+  { maxHeaderSize_ = bytes; }
+
+  /// Requests with a longer body fail with 413, streamed or not.
+  void setMaxBodySize(size_t bytes)
+  { maxBodySize_ = bytes; }
+
+  /// Bodies longer than @c bytes are streamed, see hasBodyPiece().
+  /// 0 (the default) keeps every body whole in request().body().
+  void setStreamThreshold(size_t bytes)
+  { streamThreshold_ = bytes; }
+
+  /// Parses what has arrived of the request at the front of @c buf,
+  /// continuing where the last call stopped.  Doesn't retrieve, the request
+  /// refers to the buffer; retrieve requestLength() bytes once done with it.
+  /// Chunked bodies are decoded in place, the chunk framing parsed so far
+  /// is removed from @c buf before returning.  The framing and trailers
+  /// may take at most the max header size more than the body.
+  /// Returns false if the request is malformed, see errorStatus().
+  bool parseRequest(Buffer* buf, Timestamp receiveTime);
+
+  /// Bytes parsed so far and still in the buffer, the whole request once
+  /// gotAll().
+  size_t requestLength() const
+  { return parsed_; }
+
+  /// HTTP status for the failure of parseRequest(): 400, 413 or 431.
+  int errorStatus() const
+  { return errorStatus_; }
+
+  /// A streamed body has data to hand over.  Take bodyPiece(), then call
+  /// discardBodyPiece() before parsing again.
+  bool hasBodyPiece() const
+  { return streaming_ && bodyEnd_ > bodyStart_; }
+
+  StringPiece bodyPiece(const Buffer* buf) const;
+
+  /// Drops the body piece from @c buf, keeping the request line and headers.
+  void discardBodyPiece(Buffer* buf);
+
   bool expectRequestLine() const
   { return state_ == kExpectRequestLine; }
 
@@ -45,7 +118,7 @@ class HttpContext : public muduo::copyable
   { return state_ == kExpectHeaders; }
 
   bool expectBody() const
-  { return state_ == kExpectBody; }
+  { return state_ == kExpectBody || (state_ >= kExpectChunkSize && state_ <= kExpectTrailers); }
 
   bool gotAll() const
   { return state_ == kGotAll; }
@@ -53,17 +126,86 @@ class HttpContext : public muduo::copyable
   void receiveRequestLine()
   { state_ = kExpectHeaders; }
 
-  void receiveHeaders()
-  { state_ = kGotAll; }  // FIXME
-
-  // 重置HttpContext状态
+  // 重置HttpContext状态，准备解析下一个请求，保留request_中header列表的容量。
+  // 应答的顺序是整个连接的，不重置
   void reset()
   {
     state_ = kExpectRequestLine;
-    HttpRequest dummy;
-    request_.swap(dummy);
+    parsed_ = 0;
+    scanned_ = 0;
+    bodyStart_ = 0;
+    bodyEnd_ = 0;
+    bodyTotal_ = 0;
+    chunkOverhead_ = 0;
+    remaining_ = 0;
+    streaming_ = false;
+    errorStatus_ = 0;
+    request_.reset();
   }
 
+  /// A body sent by reference after the bytes before it, a shared payload
+  /// or a range of a file, instead of being copied into the output.
+  struct Body
+  {
+    Body() : fd(-1), offset(0), length(0) { }
+
+    PayloadPtr payload;
+    int fd;
+    off_t offset;
+    size_t length;
+    boost::shared_ptr<void> owner;	// 保证fd在发送前不被关闭
+  };
+
+  /// Numbers the response to a request, in the order requests arrive.
+  int64_t startResponse()
+  { return responsesStarted_++; }
+
+  /// All earlier responses are in the output, @c id can go straight after them.
+  bool isNextResponse(int64_t id) const
+  { return id == responsesSent_; }
+
+  /// Response @c id is ready, in @c response or, if NULL, already appended to
+  /// @c output.  Moves it and any queued responses now in order to @c output,
+  /// queueing it if earlier ones are still missing.  A response with a
+  /// @c stream body holds back the ones after it until finishStream().
+  /// A queued response with a @c body, which follows @c response, holds
+  /// them back until takeBody() and finishBody().
+  /// Returns true once a response that closes the connection is complete in
+  /// @c output, later ones are dropped.
+  bool finishResponse(int64_t id, Buffer* response, bool close, Buffer* output,
+                      const HttpStreamPtr& stream = HttpStreamPtr(),
+                      const Body* body = NULL);
+
+  /// The streamed body of the current response has ended.
+  bool finishStream(Buffer* output);
+
+  /// The body to send right after the output, once its response is next.
+  bool takeBody(Body* body);
+
+  /// The body from takeBody() has been sent, continues like finishResponse().
+  bool finishBody(Buffer* output)
+  { return advance(output); }
+
+  /// The stream whose headers have just gone to the output, once.
+  HttpStreamPtr startStream()
+  {
+    HttpStreamPtr stream;
+    if (!streamStarted_)
+    {
+      stream = stream_;
+      streamStarted_ = true;
+    }
+    return stream;
+  }
+
+  /// The stream being sent, if any.
+  const HttpStreamPtr& activeStream() const
+  { return stream_; }
+
+  /// A closing response has been sent, further requests are ignored.
+  bool closing() const
+  { return closing_; }
+
   const HttpRequest& request() const
   { return request_; }
 
@@ -71,8 +213,50 @@ class HttpContext : public muduo::copyable
   { return request_; }
 
  private:
+  bool processRequestLine(const char* begin, const char* end);
+  bool processHeaders();
+  bool processChunkSize(const char* begin, const char* end);
+  bool receiveBody(Buffer* buf, size_t len);
+  void dropParsed(Buffer* buf, size_t from);
+  bool fail(int status);
+  void setStream(const HttpStreamPtr& stream);
+  bool advance(Buffer* output);
+
   HttpRequestParseState state_;		// 请求解析状态
+  // 放在state_后面的空隙里，HttpContext要放得进TcpConnection::kContextSize
+  bool closing_;
+  bool streamStarted_;
+  bool bodyWaiting_;				// pending_里responsesSent_的实体等着发送，它之后的都要等着
   HttpRequest request_;				// http请求
+  size_t parsed_;					// 已解析的总长度，下一行从这里开始
+  size_t scanned_;					// 已经找过\r\n的位置，下次从这里接着找
+  // 下面都是相对请求开头的偏移：body在[bodyStart_, bodyEnd_)，
+  // chunked编码时数据往前挪，和parsed_之间会空出chunk头的位置
+  size_t bodyStart_;
+  size_t bodyEnd_;
+  size_t bodyTotal_;				// 已收到的body总长度，包括已经流式交出去的
+  size_t chunkOverhead_;			// 已经从Buffer里去掉的chunk头、\r\n和trailer的字节数
+  size_t remaining_;				// 当前Content-Length或chunk还差的字节数
+  bool streaming_;					// body太大，分段交给用户
+  int errorStatus_;
+  size_t maxHeaderSize_;
+  size_t maxBodySize_;
+  size_t streamThreshold_;
+  // 流水线：请求按到达顺序编号，应答按编号顺序发出，先完成的在pending_里等着
+  int64_t responsesStarted_;
+  int64_t responsesSent_;
+  int64_t closeAfter_;				// 这个编号的应答发出后关闭连接，-1表示没有
+  HttpStreamPtr stream_;			// 正在流式发送实体的应答，它之后的都要等着
+  struct PendingResponse
+  {
+    PendingResponse() : hasBody(false) { }
+
+    Buffer data;
+    HttpStreamPtr stream;
+    bool hasBody;					// data后面还有body，不拷贝
+    Body body;
+  };
+  std::map<int64_t, PendingResponse> pending_;
 };
 
 }
@@ -0,0 +1,451 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+
+#include <muduo/net/http/HttpFileServer.h>
+
+#include <muduo/base/Timestamp.h>
+#include <muduo/net/Buffer.h>
+#include <muduo/net/Payload.h>
+#include <muduo/net/http/HttpRequest.h>
+#include <muduo/net/http/HttpResponse.h>
+
+#include <algorithm>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+struct HttpFileServer::File : boost::noncopyable
+{
+  File(int fd_, const string& path_, const struct stat& st)
+    : fd(fd_), path(path_), ino(st.st_ino), size(st.st_size), mtime(st.st_mtime)
+  {
+  }
+
+  ~File()
+  {
+    ::close(fd);
+  }
+
+  bool changed(const struct stat& st) const
+  { return st.st_ino != ino || st.st_size != size || st.st_mtime != mtime; }
+
+  const int fd;
+  const string path;			// 实际打开的文件，目录对应它下面的index.html
+  const ino_t ino;
+  const off_t size;
+  const time_t mtime;
+  string etag;
+  string lastModified;
+  PayloadPtr headers;			// Content-Type、Last-Modified、ETag等，每个应答共用
+  Timestamp checked;			// 上次确认文件没变的时间，由mutex_保护
+};
+
+namespace
+{
+
+const char* contentType(const string& path)
+{
+  static const struct
+  {
+    const char* extension;
+    const char* type;
+  } kTypes[] =
+  {
+    { ".html", "text/html; charset=utf-8" },
+    { ".htm", "text/html; charset=utf-8" },
+    { ".css", "text/css" },
+    { ".js", "application/javascript" },
+    { ".json", "application/json" },
+    { ".txt", "text/plain; charset=utf-8" },
+    { ".xml", "application/xml" },
+    { ".png", "image/png" },
+    { ".jpg", "image/jpeg" },
+    { ".jpeg", "image/jpeg" },
+    { ".gif", "image/gif" },
+    { ".svg", "image/svg+xml" },
+    { ".ico", "image/x-icon" },
+    { ".pdf", "application/pdf" },
+    { ".wasm", "application/wasm" },
+    { ".woff2", "font/woff2" },
+  };
+  for (size_t i = 0; i < sizeof kTypes / sizeof kTypes[0]; ++i)
+  {
+    const size_t len = ::strlen(kTypes[i].extension);
+    if (path.size() > len
+        && ::strcasecmp(path.c_str() + path.size() - len, kTypes[i].extension) == 0)
+    {
+      return kTypes[i].type;
+    }
+  }
+  return "application/octet-stream";
+}
+
+int hexValue(char c)
+{
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// 解码%XX，拒绝..、空段和\0，不能跑到根目录外面去
+bool decodePath(const StringPiece& path, string* out)
+{
+  out->clear();
+  for (int i = 0; i < path.size(); ++i)
+  {
+    char c = path[i];
+    if (c == '%')
+    {
+      int high = i + 2 < path.size() ? hexValue(path[i+1]) : -1;
+      int low = high >= 0 ? hexValue(path[i+2]) : -1;
+      if (low < 0)
+      {
+        return false;
+      }
+      c = static_cast<char>(high * 16 + low);
+      i += 2;
+    }
+    if (c == '\0')
+    {
+      return false;
+    }
+    out->push_back(c);
+  }
+
+  size_t start = 0;
+  while (start <= out->size())
+  {
+    size_t slash = out->find('/', start);
+    if (slash == string::npos)
+    {
+      slash = out->size();
+    }
+    const size_t len = slash - start;
+    if ((len == 2 && out->compare(start, 2, "..") == 0)
+        || (len == 1 && (*out)[start] == '.'))
+    {
+      return false;
+    }
+    start = slash + 1;
+  }
+  return true;
+}
+
+// If-None-Match可能是逗号分隔的多个ETag，或者*
+bool etagMatches(const StringPiece& header, const string& etag)
+{
+  if (header == "*")
+  {
+    return true;
+  }
+  const char* end = header.data() + header.size();
+  return std::search(header.data(), end, etag.begin(), etag.end()) != end;
+}
+
+bool parseNumber(const char* begin, const char* end, off_t* value)
+{
+  if (begin == end || end - begin > 18)
+  {
+    return false;
+  }
+  off_t n = 0;
+  for (const char* p = begin; p < end; ++p)
+  {
+    if (*p < '0' || *p > '9')
+    {
+      return false;
+    }
+    n = n * 10 + (*p - '0');
+  }
+  *value = n;
+  return true;
+}
+
+enum RangeResult
+{
+  kNoRange,			// 没有Range或者不支持，发整个文件
+  kRange,
+  kUnsatisfiable,
+};
+
+// 只支持单个区间：bytes=a-b、bytes=a-、bytes=-n
+RangeResult parseRange(const StringPiece& header, off_t size, off_t* first, off_t* last)
+{
+  const StringPiece kBytes("bytes=");
+  if (!header.starts_with(kBytes))
+  {
+    return kNoRange;
+  }
+  const char* begin = header.data() + kBytes.size();
+  const char* end = header.data() + header.size();
+  if (std::find(begin, end, ',') != end)
+  {
+    return kNoRange;
+  }
+  const char* dash = std::find(begin, end, '-');
+  if (dash == end)
+  {
+    return kNoRange;
+  }
+
+  off_t a = 0;
+  off_t b = 0;
+  if (begin == dash)
+  {
+    if (!parseNumber(dash + 1, end, &b))
+    {
+      return kNoRange;
+    }
+    if (b == 0 || size == 0)
+    {
+      return kUnsatisfiable;
+    }
+    *first = size - std::min(b, size);
+    *last = size - 1;
+    return kRange;
+  }
+  if (!parseNumber(begin, dash, &a))
+  {
+    return kNoRange;
+  }
+  if (dash + 1 == end)
+  {
+    b = size - 1;
+  }
+  else if (!parseNumber(dash + 1, end, &b) || b < a)
+  {
+    return kNoRange;
+  }
+  if (a >= size)
+  {
+    return kUnsatisfiable;
+  }
+  *first = a;
+  *last = std::min(b, size - 1);
+  return kRange;
+}
+
+void formatHttpDate(time_t t, string* out)
+{
+  struct tm tm;
+  ::gmtime_r(&t, &tm);
+  char buf[64];
+  size_t len = ::strftime(buf, sizeof buf, "%a, %d %b %Y %H:%M:%S GMT", &tm);
+  out->assign(buf, len);
+}
+
+}
+
+HttpFileServer::HttpFileServer(const string& root, const string& urlPrefix)
+  : root_(root),
+    prefix_(urlPrefix),
+    maxFiles_(1024),
+    revalidateInterval_(1.0)
+{
+}
+
+HttpFileServer::~HttpFileServer()
+{
+}
+
+size_t HttpFileServer::cachedFiles() const
+{
+  MutexLockGuard lock(mutex_);
+  return cache_.size();
+}
+
+HttpFileServer::FilePtr HttpFileServer::open(const string& path)
+{
+  string fullPath(root_ + "/" + path);
+  int fd = ::open(fullPath.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+  {
+    return FilePtr();
+  }
+  struct stat st;
+  if (::fstat(fd, &st) == 0 && S_ISDIR(st.st_mode))
+  {
+    ::close(fd);
+    fullPath += "/index.html";
+    fd = ::open(fullPath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+      return FilePtr();
+    }
+  }
+  if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+  {
+    ::close(fd);
+    return FilePtr();
+  }
+
+  FilePtr file(new File(fd, fullPath, st));
+  char buf[64];
+  snprintf(buf, sizeof buf, "\"%lx-%lx\"",
+           static_cast<unsigned long>(st.st_mtime), static_cast<unsigned long>(st.st_size));
+  file->etag = buf;
+  formatHttpDate(st.st_mtime, &file->lastModified);
+
+  Buffer headers;
+  headers.append("Content-Type: ");
+  headers.append(contentType(fullPath));
+  headers.append("\r\nLast-Modified: ");
+  headers.append(file->lastModified);
+  headers.append("\r\nETag: ");
+  headers.append(file->etag);
+  headers.append("\r\nAccept-Ranges: bytes\r\n");
+  file->headers.reset(new Payload(&headers));
+  file->checked = Timestamp::now();
+  return file;
+}
+
+void HttpFileServer::insert(const string& path, const FilePtr& file)
+{
+  MutexLockGuard lock(mutex_);
+  std::map<string, Entry>::iterator it = cache_.find(path);
+  if (it != cache_.end())
+  {
+    lru_.erase(it->second.lru);
+    cache_.erase(it);
+  }
+  if (!file)
+  {
+    return;
+  }
+  lru_.push_front(path);
+  Entry& entry = cache_[path];
+  entry.file = file;
+  entry.lru = lru_.begin();
+  // 淘汰的文件在最后一个引用它的应答发完后关闭
+  while (cache_.size() > maxFiles_)
+  {
+    cache_.erase(lru_.back());
+    lru_.pop_back();
+  }
+}
+
+HttpFileServer::FilePtr HttpFileServer::find(const string& path)
+{
+  const Timestamp now(Timestamp::now());
+  FilePtr stale;
+  {
+    MutexLockGuard lock(mutex_);
+    std::map<string, Entry>::iterator it = cache_.find(path);
+    if (it != cache_.end())
+    {
+      lru_.splice(lru_.begin(), lru_, it->second.lru);
+      const FilePtr& file = it->second.file;
+      if (timeDifference(now, file->checked) < revalidateInterval_)
+      {
+        return file;
+      }
+      // 其他线程这段时间里不用再检查
+      file->checked = now;
+      stale = file;
+    }
+  }
+
+  struct stat st;
+  if (stale && ::stat(stale->path.c_str(), &st) == 0 && !stale->changed(st))
+  {
+    return stale;
+  }
+  FilePtr file(open(path));
+  insert(path, file);
+  return file;
+}
+
+bool HttpFileServer::handle(const HttpRequest& req, HttpResponse* resp)
+{
+  if (req.method() != HttpRequest::kGet && req.method() != HttpRequest::kHead)
+  {
+    return false;
+  }
+  StringPiece path(req.path());
+  const char* query = std::find(path.data(), path.data() + path.size(), '?');
+  path = StringPiece(path.data(), static_cast<int>(query - path.data()));
+  if (!path.starts_with(prefix_))
+  {
+    return false;
+  }
+  path.remove_prefix(static_cast<int>(prefix_.size()));
+
+  string relative;
+  FilePtr file;
+  if (decodePath(path, &relative))
+  {
+    file = find(relative);
+  }
+  if (!file)
+  {
+    resp->setStatusCode(HttpResponse::k404NotFound);
+    return true;
+  }
+
+  resp->setRawHeaders(file->headers);
+  StringPiece ifNoneMatch(req.getHeader("If-None-Match"));
+  if (!ifNoneMatch.empty() ? etagMatches(ifNoneMatch, file->etag)
+                           : req.getHeader("If-Modified-Since") == file->lastModified)
+  {
+    resp->setStatusCode(HttpResponse::k304NotModified);
+    return true;
+  }
+
+  off_t first = 0;
+  off_t last = file->size - 1;
+  RangeResult range = kNoRange;
+  StringPiece ifRange(req.getHeader("If-Range"));
+  if (ifRange.empty() || ifRange == file->etag || ifRange == file->lastModified)
+  {
+    range = parseRange(req.getHeader("Range"), file->size, &first, &last);
+  }
+
+  char buf[64];
+  if (range == kUnsatisfiable)
+  {
+    resp->setStatusCode(HttpResponse::k416RangeNotSatisfiable);
+    snprintf(buf, sizeof buf, "bytes */%ld", static_cast<long>(file->size));
+    resp->addHeader("Content-Range", buf);
+    return true;
+  }
+  if (range == kRange)
+  {
+    resp->setStatusCode(HttpResponse::k206PartialContent);
+    snprintf(buf, sizeof buf, "bytes %ld-%ld/%ld", static_cast<long>(first),
+             static_cast<long>(last), static_cast<long>(file->size));
+    resp->addHeader("Content-Range", buf);
+  }
+  else
+  {
+    resp->setStatusCode(HttpResponse::k200Ok);
+  }
+  // 应答持有file，发送前fd不会因为淘汰被关掉
+  if (last >= first)
+  {
+    resp->setBodyFile(file->fd, first, static_cast<size_t>(last - first + 1), file);
+  }
+  return true;
+}
+
+void HttpFileServer::onRequest(const HttpRequest& req, HttpResponse* resp)
+{
+  if (!handle(req, resp))
+  {
+    resp->setStatusCode(HttpResponse::k404NotFound);
+  }
+}
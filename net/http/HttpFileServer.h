@@ -0,0 +1,95 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+/*提供静态文件：缓存打开的fd和stat结果，用sendfile发送实体，
+ *支持ETag/Last-Modified条件请求和Range请求*/
+#ifndef MUDUO_NET_HTTP_HTTPFILESERVER_H
+#define MUDUO_NET_HTTP_HTTPFILESERVER_H
+
+#include <muduo/base/Mutex.h>
+#include <muduo/base/Types.h>
+
+#include <list>
+#include <map>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+namespace muduo
+{
+namespace net
+{
+
+class HttpRequest;
+class HttpResponse;
+
+///
+/// Serves the files under a directory.
+///
+/// Open files are cached with their stat results and preformatted headers,
+/// a hit costs no syscall until the bodies go out with sendfile(2).
+/// Cached entries are stat()ed again at most once per revalidate interval,
+/// and reopened if the file changed.  Thread safe.
+///
+/// Usage:
+///   HttpFileServer files("/var/www", "/static/");
+///   server.setHttpCallback(boost::bind(&HttpFileServer::onRequest, &files, _1, _2));
+class HttpFileServer : boost::noncopyable
+{
+ public:
+  /// Maps "<urlPrefix>a/b.html" to "<root>/a/b.html".
+  HttpFileServer(const string& root, const string& urlPrefix = "/");
+  ~HttpFileServer();
+
+  /// Open files kept, least recently used ones are closed first.
+  /// Default 1024.
+  void setMaxCachedFiles(size_t n)
+  { maxFiles_ = n; }
+
+  /// Cached files are checked for changes at most this often, default 1s.
+  void setRevalidateInterval(double seconds)
+  { revalidateInterval_ = seconds; }
+
+  /// Answers GET and HEAD for paths under the prefix, including 304, 206,
+  /// 404 and 416.  Returns false, leaving @c resp alone, for other paths or
+  /// methods, so handlers can be chained.
+  bool handle(const HttpRequest& req, HttpResponse* resp);
+
+  /// As an HttpCallback, 404 for what handle() doesn't take.
+  void onRequest(const HttpRequest& req, HttpResponse* resp);
+
+  size_t cachedFiles() const;
+
+ private:
+  struct File;
+  typedef boost::shared_ptr<File> FilePtr;
+
+  FilePtr find(const string& path);
+  FilePtr open(const string& path);
+  void insert(const string& path, const FilePtr& file);
+
+  const string root_;
+  const string prefix_;
+  size_t maxFiles_;
+  double revalidateInterval_;
+
+  mutable MutexLock mutex_;
+  // 按最近使用排序的路径，最近的在前面
+  std::list<string> lru_;
+  struct Entry
+  {
+    FilePtr file;
+    std::list<string>::iterator lru;
+  };
+  std::map<string, Entry> cache_;
+};
+
+}
+}
+
+#endif  // MUDUO_NET_HTTP_HTTPFILESERVER_H
@@ -12,18 +12,28 @@
 #define MUDUO_NET_HTTP_HTTPREQUEST_H
 
 #include <muduo/base/copyable.h>
+#include <muduo/base/StringPiece.h>
 #include <muduo/base/Timestamp.h>
 #include <muduo/base/Types.h>
 
-#include <map>
+#include <vector>
 #include <assert.h>
-#include <stdio.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
 
 namespace muduo
 {
 namespace net
 {
 
+/// A parsed request, as views into the buffer it was parsed from.
+///
+/// Path and headers are kept as offsets from the start of the request,
+/// so they survive the buffer moving its data while the request is still
+/// arriving.  The StringPieces returned are valid while that buffer still
+/// holds the request, i.e. during HttpServer's HttpCallback.
 class HttpRequest : public muduo::copyable
 {
  public:
@@ -38,10 +48,16 @@ class HttpRequest : public muduo::copyable
 
   HttpRequest()
     : method_(kInvalid),
-      version_(kUnknown)
+      version_(kUnknown),
+      base_(NULL),
+      bodyStreamed_(false)
   {
   }
 
+  /// Where the request starts, offsets are relative to it.
+  void setBase(const char* base)
+  { base_ = base; }
+
   void setVersion(Version v)
   {
     version_ = v;
@@ -53,24 +69,25 @@ class HttpRequest : public muduo::copyable
   bool setMethod(const char* start, const char* end)//start和end指向url的请求方法的头部和尾部，根据url给method_设置值
   {
     assert(method_ == kInvalid);
-    string m(start, end);//得到请求方法
-    if (m == "GET")
+    // 按长度比较，不构造临时string
+    const size_t len = end - start;
+    if (len == 3 && memcmp(start, "GET", 3) == 0)
     {
       method_ = kGet;
     }
-    else if (m == "POST")
+    else if (len == 4 && memcmp(start, "POST", 4) == 0)
     {
       method_ = kPost;
     }
-    else if (m == "HEAD")
+    else if (len == 4 && memcmp(start, "HEAD", 4) == 0)
     {
       method_ = kHead;
     }
-    else if (m == "PUT")
+    else if (len == 3 && memcmp(start, "PUT", 3) == 0)
     {
       method_ = kPut;
     }
-    else if (m == "DELETE")
+    else if (len == 6 && memcmp(start, "DELETE", 6) == 0)
     {
       method_ = kDelete;
     }
@@ -112,11 +129,11 @@ class HttpRequest : public muduo::copyable
 
   void setPath(const char* start, const char* end)//设置请求路径
   {
-    path_.assign(start, end);
+    path_ = span(start, end);
   }
 
-  const string& path() const//
-  { return path_; }
+  StringPiece path() const
+  { return toStringPiece(path_); }
 
   void setReceiveTime(Timestamp t)//设置接收时间
   { receiveTime_ = t; }
@@ -126,50 +143,122 @@ class HttpRequest : public muduo::copyable
 
   void addHeader(const char* start, const char* colon, const char* end)
   {
-    string field(start, colon);		// header，报头名称
+    Header header;
+    header.field = span(start, colon);		// header，报头名称
     ++colon;
     // 去除左空格
     while (colon < end && isspace(*colon))
     {
       ++colon;
     }
-    string value(colon, end);		// header值，报头数据
     // 去除右空格
-    while (!value.empty() && isspace(value[value.size()-1]))
+    while (end > colon && isspace(end[-1]))
     {
-      value.resize(value.size()-1);
+      --end;
     }
-    headers_[field] = value;
+    header.value = span(colon, end);		// header值，报头数据
+    headers_.push_back(header);
   }
 
-  string getHeader(const string& field) const
+  /// Case-insensitive, returns an empty piece if absent.
+  StringPiece getHeader(const StringPiece& field) const
   {
-    string result;
-    std::map<string, string>::const_iterator it = headers_.find(field);
-    if (it != headers_.end())
+    for (size_t i = 0; i < headers_.size(); ++i)
     {
-      result = it->second;
+      const Span& f = headers_[i].field;
+      if (static_cast<int>(f.length) == field.size()
+          && ::strncasecmp(base_ + f.offset, field.data(), f.length) == 0)
+      {
+        return toStringPiece(headers_[i].value);
+      }
     }
-    return result;
+    return StringPiece();
   }
 
-  const std::map<string, string>& headers() const
-  { return headers_; }
+  /// Headers in the order received.
+  size_t numHeaders() const
+  { return headers_.size(); }
+
+  StringPiece headerField(size_t i) const
+  { return toStringPiece(headers_[i].field); }
+
+  StringPiece headerValue(size_t i) const
+  { return toStringPiece(headers_[i].value); }
+
+  void setBody(const char* start, const char* end)
+  { body_ = span(start, end); }
+
+  /// The whole body, de-chunked.  Empty if it was streamed, see bodyStreamed().
+  StringPiece body() const
+  { return toStringPiece(body_); }
+
+  void setBodyStreamed(bool on)
+  { bodyStreamed_ = on; }
+
+  /// The body was too large and went to HttpServer's BodyCallback in pieces.
+  bool bodyStreamed() const
+  { return bodyStreamed_; }
+
+  /// Clears for the next request, keeping the capacity of the header list.
+  void reset()
+  {
+    method_ = kInvalid;
+    version_ = kUnknown;
+    base_ = NULL;
+    path_ = Span();
+    receiveTime_ = Timestamp();
+    headers_.clear();
+    body_ = Span();
+    bodyStreamed_ = false;
+  }
 
   void swap(HttpRequest& that)
   {
     std::swap(method_, that.method_);
-    path_.swap(that.path_);
+    std::swap(version_, that.version_);
+    std::swap(base_, that.base_);
+    std::swap(path_, that.path_);
     receiveTime_.swap(that.receiveTime_);
     headers_.swap(that.headers_);
+    std::swap(body_, that.body_);
+    std::swap(bodyStreamed_, that.bodyStreamed_);
   }
 
  private:
+  // 相对于base_的一段
+  struct Span
+  {
+    Span() : offset(0), length(0) { }
+    uint32_t offset;
+    uint32_t length;
+  };
+
+  struct Header
+  {
+    Span field;
+    Span value;
+  };
+
+  Span span(const char* start, const char* end) const
+  {
+    assert(base_ != NULL && base_ <= start && start <= end);
+    Span s;
+    s.offset = static_cast<uint32_t>(start - base_);
+    s.length = static_cast<uint32_t>(end - start);
+    return s;
+  }
+
+  StringPiece toStringPiece(const Span& s) const
+  { return StringPiece(base_ + s.offset, static_cast<int>(s.length)); }
+
   Method method_;		// 请求方法
   Version version_;		// 协议版本1.0/1.1
-  string path_;			// 请求路径
+  const char* base_;	// 请求在Buffer中的起始位置
+  Span path_;			// 请求路径
   Timestamp receiveTime_;	// 请求时间
-  std::map<string, string> headers_;	// header列表
+  std::vector<Header> headers_;	// header列表，按收到的顺序
+  Span body_;			// 请求实体，chunked编码的已经解码
+  bool bodyStreamed_;	// 请求实体已经分段交给用户
 };
 
 }
@@ -0,0 +1,52 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+
+#include <muduo/net/http/HttpResponder.h>
+
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/TcpConnection.h>
+
+#include <boost/bind.hpp>
+
+using namespace muduo;
+using namespace muduo::net;
+
+HttpResponder::HttpResponder(const TcpConnectionPtr& conn,
+                             int64_t id,
+                             const HttpRequest& request,
+                             const StringPiece& raw,
+                             bool close,
+                             const DoneCallback& cb)
+  : conn_(conn),
+    id_(id),
+    raw_(raw.data(), raw.size()),
+    request_(request),
+    response_(close),
+    doneCallback_(cb)
+{
+  request_.setBase(raw_.data());	// 各字段都是相对起点的偏移，换到拷贝上就行
+}
+
+void HttpResponder::done()
+{
+  assert(doneCallback_);
+  DoneCallback cb;
+  cb.swap(doneCallback_);
+  TcpConnectionPtr conn(conn_.lock());
+  if (conn)
+  {
+    // 回到连接所在的IO线程发送。在IO线程中调用时也排到后面，
+    // 让onMessage先把攒着的前面的应答发出去
+    conn->getLoop()->queueInLoop(boost::bind(cb, shared_from_this()));
+  }
+  else
+  {
+    cb(shared_from_this());
+  }
+}
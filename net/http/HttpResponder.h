@@ -0,0 +1,80 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+/*异步处理一个http请求：持有请求的一份拷贝和要填写的应答，在任意线程调用done()发出应答*/
+#ifndef MUDUO_NET_HTTP_HTTPRESPONDER_H
+#define MUDUO_NET_HTTP_HTTPRESPONDER_H
+
+#include <muduo/base/Types.h>
+#include <muduo/net/Callbacks.h>
+#include <muduo/net/http/HttpRequest.h>
+#include <muduo/net/http/HttpResponse.h>
+
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/weak_ptr.hpp>
+
+namespace muduo
+{
+namespace net
+{
+
+class HttpResponder;
+typedef boost::shared_ptr<HttpResponder> HttpResponderPtr;
+
+///
+/// One request being handled asynchronously.
+///
+/// Owns a copy of the request, so it outlives the input buffer.  Fill in
+/// response() from any thread, then call done() exactly once; responses on a
+/// connection still go out in the order of their requests.
+class HttpResponder : boost::noncopyable,
+                      public boost::enable_shared_from_this<HttpResponder>
+{
+ public:
+  typedef boost::function<void (const HttpResponderPtr&)> DoneCallback;
+
+  /// Copies @c raw, the bytes @c request refers to.
+  HttpResponder(const TcpConnectionPtr& conn,
+                int64_t id,
+                const HttpRequest& request,
+                const StringPiece& raw,
+                bool close,
+                const DoneCallback& cb);
+
+  const HttpRequest& request() const
+  { return request_; }
+
+  HttpResponse* response()
+  { return &response_; }
+
+  /// Sends the response.  Thread safe.
+  void done();
+
+  int64_t id() const
+  { return id_; }
+
+  /// Empty once the connection is gone.
+  TcpConnectionPtr connection() const
+  { return conn_.lock(); }
+
+ private:
+  boost::weak_ptr<TcpConnection> conn_;
+  const int64_t id_;		// 在连接上的应答编号，见HttpContext::startResponse()
+  string raw_;				// 请求的原始数据，request_指向这里
+  HttpRequest request_;
+  HttpResponse response_;
+  DoneCallback doneCallback_;
+};
+
+}
+}
+
+#endif  // MUDUO_NET_HTTP_HTTPRESPONDER_H
@@ -10,43 +10,199 @@
 #include <muduo/net/http/HttpResponse.h>
 #include <muduo/net/Buffer.h>
 
-#include <stdio.h>
+#include <algorithm>
+
+#include <assert.h>
+#include <string.h>
+#include <time.h>
 
 using namespace muduo;
 using namespace muduo::net;
 
-void HttpResponse::appendToBuffer(Buffer* output) const//组织响应数据报，并发送到缓存中
+namespace
+{
+
+// 本线程缓存的"Date: ...\r\n"，由updateDate()每秒刷新
+__thread char t_dateHeader[64];
+__thread size_t t_dateHeaderLength;
+
+#define LITERAL(s) StringPiece(s, static_cast<int>(sizeof(s) - 1))
+
+// 常用状态码预先格式化好的状态行和默认的状态信息
+struct StatusLine
+{
+  int code;
+  const char* message;
+  StringPiece line;
+};
+
+const StatusLine kStatusLines[] =
+{
+  { 200, "OK", LITERAL("HTTP/1.1 200 OK\r\n") },
+  { 204, "No Content", LITERAL("HTTP/1.1 204 No Content\r\n") },
+  { 206, "Partial Content", LITERAL("HTTP/1.1 206 Partial Content\r\n") },
+  { 301, "Moved Permanently", LITERAL("HTTP/1.1 301 Moved Permanently\r\n") },
+  { 302, "Found", LITERAL("HTTP/1.1 302 Found\r\n") },
+  { 304, "Not Modified", LITERAL("HTTP/1.1 304 Not Modified\r\n") },
+  { 400, "Bad Request", LITERAL("HTTP/1.1 400 Bad Request\r\n") },
+  { 403, "Forbidden", LITERAL("HTTP/1.1 403 Forbidden\r\n") },
+  { 404, "Not Found", LITERAL("HTTP/1.1 404 Not Found\r\n") },
+  { 405, "Method Not Allowed", LITERAL("HTTP/1.1 405 Method Not Allowed\r\n") },
+  { 413, "Payload Too Large", LITERAL("HTTP/1.1 413 Payload Too Large\r\n") },
+  { 416, "Range Not Satisfiable", LITERAL("HTTP/1.1 416 Range Not Satisfiable\r\n") },
+  { 431, "Request Header Fields Too Large",
+    LITERAL("HTTP/1.1 431 Request Header Fields Too Large\r\n") },
+  { 500, "Internal Server Error", LITERAL("HTTP/1.1 500 Internal Server Error\r\n") },
+  { 503, "Service Unavailable", LITERAL("HTTP/1.1 503 Service Unavailable\r\n") },
+};
+
+const StatusLine* findStatusLine(int code)
+{
+  for (size_t i = 0; i < sizeof kStatusLines / sizeof kStatusLines[0]; ++i)
+  {
+    if (kStatusLines[i].code == code)
+    {
+      return &kStatusLines[i];
+    }
+  }
+  return NULL;
+}
+
+// 十进制格式化，不用snprintf，返回长度
+size_t formatDecimal(char buf[], uint64_t value)
+{
+  char* p = buf;
+  do
+  {
+    *p++ = static_cast<char>('0' + value % 10);
+    value /= 10;
+  } while (value != 0);
+  std::reverse(buf, p);
+  return p - buf;
+}
+
+}
+
+void HttpResponse::addHeader(const StringPiece& key, const StringPiece& value)
+{
+  for (size_t i = 0; i < headers_.size(); ++i)
+  {
+    if (key == headers_[i].first)
+    {
+      headers_[i].second.assign(value.data(), value.size());
+      return;
+    }
+  }
+  headers_.push_back(Header(key.as_string(), value.as_string()));
+}
+
+StringPiece HttpResponse::getHeader(const StringPiece& key) const
+{
+  for (size_t i = 0; i < headers_.size(); ++i)
+  {
+    if (key == headers_[i].first)
+    {
+      return headers_[i].second;
+    }
+  }
+  return StringPiece();
+}
+
+size_t HttpResponse::bodySize() const
+{
+  if (payload_)
+  {
+    return payload_->size();
+  }
+  return fd_ >= 0 ? fileLength_ : body_.size();
+}
+
+void HttpResponse::appendHeadersToBuffer(Buffer* output) const//组织响应数据报的头部，并发送到缓存中
 {
   char buf[32];
-  // 添加响应头
-  snprintf(buf, sizeof buf, "HTTP/1.1 %d ", statusCode_);
-  output->append(buf);
-  output->append(statusMessage_);
-  output->append("\r\n");
+  // 添加响应头，常用的状态码直接用格式化好的状态行
+  const StatusLine* status = findStatusLine(statusCode_);
+  if (status && (statusMessage_.empty() || statusMessage_ == status->message))
+  {
+    output->append(status->line);
+  }
+  else
+  {
+    output->append("HTTP/1.1 ", 9);
+    output->append(buf, formatDecimal(buf, statusCode_));
+    output->append(" ", 1);
+    output->append(statusMessage_);
+    output->append("\r\n", 2);
+  }
 
-  if (closeConnection_)
+  if (producer_ && !closeConnection_)
+  {
+    output->append(LITERAL("Transfer-Encoding: chunked\r\nConnection: Keep-Alive\r\n"));
+  }
+  else if (closeConnection_)
   {
     // 如果是短连接，不需要告诉浏览器Content-Length，浏览器也能正确处理
-    output->append("Connection: close\r\n");
+    output->append(LITERAL("Connection: close\r\n"));
+  }
+  else if (statusCode_ == k204NoContent || statusCode_ == k304NotModified)
+  {
+    // 这两个没有实体，也不能带Content-Length: 0
+    output->append(LITERAL("Connection: Keep-Alive\r\n"));
   }
   else
   {
-    snprintf(buf, sizeof buf, "Content-Length: %zd\r\n", body_.size());	// 实体长度
-    output->append(buf);
-    output->append("Connection: Keep-Alive\r\n");
+    output->append(LITERAL("Content-Length: "));	// 实体长度
+    output->append(buf, formatDecimal(buf, bodySize()));
+    output->append(LITERAL("\r\nConnection: Keep-Alive\r\n"));
   }
+  output->append(t_dateHeader, t_dateHeaderLength);
+  appendHeaderLinesToBuffer(output);
+  output->append("\r\n", 2);	// header与body之间的空行
+}
 
+void HttpResponse::appendHeaderLinesToBuffer(Buffer* output) const
+{
   // header列表
-  for (std::map<string, string>::const_iterator it = headers_.begin();
-       it != headers_.end();
-       ++it)
+  for (size_t i = 0; i < headers_.size(); ++i)
   {
-    output->append(it->first);
-    output->append(": ");
-    output->append(it->second);
-    output->append("\r\n");
+    output->append(headers_[i].first);
+    output->append(": ", 2);
+    output->append(headers_[i].second);
+    output->append("\r\n", 2);
   }
 
-  output->append("\r\n");	// header与body之间的空行
-  output->append(body_);
+  if (rawHeaders_)
+  {
+    output->append(rawHeaders_->data(), rawHeaders_->size());
+  }
+}
+
+void HttpResponse::appendToBuffer(Buffer* output) const//组织响应数据报，并发送到缓存中
+{
+  // 文件实体由HttpServer在header之后sendFile，不读进来
+  assert(fd_ < 0);
+  appendHeadersToBuffer(output);
+  if (producer_)
+  {
+    // 实体之后由HttpStream发送
+  }
+  else if (payload_)
+  {
+    output->append(payload_->data(), payload_->size());
+  }
+  else
+  {
+    output->append(body_);
+  }
+}
+
+void HttpResponse::updateDate(time_t now)
+{
+  struct tm tm;
+  ::gmtime_r(&now, &tm);
+  memcpy(t_dateHeader, "Date: ", 6);
+  size_t len = strftime(t_dateHeader + 6, sizeof t_dateHeader - 8,
+                        "%a, %d %b %Y %H:%M:%S GMT", &tm);
+  memcpy(t_dateHeader + 6 + len, "\r\n", 2);
+  t_dateHeaderLength = len + 8;
 }
@@ -12,9 +12,14 @@
 #define MUDUO_NET_HTTP_HTTPRESPONSE_H
 
 #include <muduo/base/copyable.h>
+#include <muduo/base/StringPiece.h>
 #include <muduo/base/Types.h>
+#include <muduo/net/Payload.h>
+#include <muduo/net/http/HttpStream.h>
 
-#include <map>
+#include <utility>
+#include <vector>
+#include <sys/types.h>
 
 namespace muduo
 {
@@ -29,23 +34,44 @@ class HttpResponse : public muduo::copyable
   {
     kUnknown,
     k200Ok = 200,		// 成功
+    k204NoContent = 204,
+    k206PartialContent = 206,
     k301MovedPermanently = 301,		// 301重定向，请求的页面永久性移至另一个地址
+    k302Found = 302,
+    k304NotModified = 304,
     k400BadRequest = 400,			// 错误的请求，语法格式有错，服务器无法处理此请求
+    k403Forbidden = 403,
     k404NotFound = 404,		// 请求的网页不存在
+    k405MethodNotAllowed = 405,
+    k413PayloadTooLarge = 413,
+    k416RangeNotSatisfiable = 416,
+    k431RequestHeaderFieldsTooLarge = 431,
+    k500InternalServerError = 500,
+    k503ServiceUnavailable = 503,
   };
 
   explicit HttpResponse(bool close)
     : statusCode_(kUnknown),
-      closeConnection_(close)
+      closeConnection_(close),
+      fd_(-1),
+      fileOffset_(0),
+      fileLength_(0)
   {
   }
 
   void setStatusCode(HttpStatusCode code)
   { statusCode_ = code; }
 
+  HttpStatusCode statusCode() const
+  { return statusCode_; }
+
+  /// Optional for the codes above, their standard status lines are preformatted.
   void setStatusMessage(const string& message)
   { statusMessage_ = message; }
 
+  const string& statusMessage() const
+  { return statusMessage_; }
+
   void setCloseConnection(bool on)
   { closeConnection_ = on; }
 
@@ -53,25 +79,108 @@ class HttpResponse : public muduo::copyable
   { return closeConnection_; }
 
   // 设置文档媒体类型（MIME）
-  void setContentType(const string& contentType)
+  void setContentType(const StringPiece& contentType)
   { addHeader("Content-Type", contentType); }
 
-  // FIXME: replace string with StringPiece
-  void addHeader(const string& key, const string& value)
-  { headers_[key] = value; }
+  /// Replaces the value if @c key was added before.
+  /// Headers go out in the order first added.
+  void addHeader(const StringPiece& key, const StringPiece& value);
+
+  /// Value added with addHeader(), empty if none.
+  StringPiece getHeader(const StringPiece& key) const;
+
+  /// Header lines formatted once and shared by many responses, each ending
+  /// in "\r\n".  Sent after those added with addHeader().
+  void setRawHeaders(const PayloadPtr& headers)
+  { rawHeaders_ = headers; }
 
   void setBody(const string& body)
   { body_ = body; }
 
+  const string& body() const
+  { return body_; }
+
+  /// Sends @c payload as the body without copying it, see TcpConnection::send().
+  void setBody(const PayloadPtr& payload)
+  { payload_ = payload; }
+
+  /// Sends @c length bytes of @c fd from @c offset as the body with
+  /// sendfile(2).  A response queued behind earlier pipelined ones keeps
+  /// @c fd until its turn, @c fd must stay open as long as the response or
+  /// its queued copy holds @c owner.  Without an owner, keep it open for
+  /// the life of the server.
+  void setBodyFile(int fd, off_t offset, size_t length,
+                   const boost::shared_ptr<void>& owner = boost::shared_ptr<void>())
+  {
+    fd_ = fd;
+    fileOffset_ = offset;
+    fileLength_ = length;
+    fileOwner_ = owner;
+  }
+
+  /// Streams the body, see HttpStream.  Sent chunked on a keep-alive
+  /// HTTP/1.1 connection, otherwise ended by closing the connection.
+  void setBodyStream(const HttpStream::ProduceCallback& producer)
+  { producer_ = producer; }
+
+  bool hasBodyStream() const
+  { return static_cast<bool>(producer_); }
+
+  const HttpStream::ProduceCallback& bodyStream() const
+  { return producer_; }
+
+  size_t bodySize() const;
+
+  /// Body is a payload or file, not in the output buffer.
+  bool hasExternalBody() const
+  { return payload_ || fd_ >= 0; }
+
+  const PayloadPtr& payload() const
+  { return payload_; }
+
+  int bodyFile() const
+  { return fd_; }
+
+  off_t bodyFileOffset() const
+  { return fileOffset_; }
+
+  const boost::shared_ptr<void>& bodyFileOwner() const
+  { return fileOwner_; }
+
+  /// Status line and headers, followed by the body if it is a string.
+  /// A streamed body comes later.
+  void appendHeadersToBuffer(Buffer* output) const;
+
+  /// Lines of addHeader() and setRawHeaders() only, without the status
+  /// line, Connection, Content-Length, Date and the blank line.
+  void appendHeaderLinesToBuffer(Buffer* output) const;
+
+  /// The whole response, copying a string or payload body into @c output.
+  /// For in-memory bodies only, a file body goes out with sendFile()
+  /// after appendHeadersToBuffer().
   void appendToBuffer(Buffer* output) const;	// 将HttpResponse添加到Buffer
 
+  /// Refreshes the "Date:" header of responses serialized in this thread.
+  /// HttpServer calls it every second in each of its loops; threads that
+  /// never call it send no Date.
+  static void updateDate(time_t now);
+
  private:
-  std::map<string, string> headers_;	// header列表
+  typedef std::pair<string, string> Header;
+
+  std::vector<Header> headers_;			// header列表，按加入的顺序，个数少，线性查找比map快
   HttpStatusCode statusCode_;			// 状态响应码
   // FIXME: add http version
   string statusMessage_;				// 状态响应码对应的文本信息
   bool closeConnection_;				// 是否关闭连接
   string body_;							// 实体
+  PayloadPtr payload_;					// 共享的实体，不拷贝
+  int fd_;								// 用sendfile发送的文件实体，-1表示没有
+  off_t fileOffset_;
+  size_t fileLength_;
+  boost::shared_ptr<void> fileOwner_;	// 保证fd_在发送前不被关闭
+  HttpStream::ProduceCallback producer_;	// 流式发送的实体
+  PayloadPtr rawHeaders_;				// 预先格式化好的header
 };
 
 }
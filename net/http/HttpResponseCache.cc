@@ -0,0 +1,301 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+
+#include <muduo/net/http/HttpResponseCache.h>
+
+#include <muduo/net/Buffer.h>
+#include <muduo/net/http/HttpRequest.h>
+#include <muduo/net/http/HttpResponse.h>
+
+#include <boost/scoped_ptr.hpp>
+
+#include <assert.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+bool contains(const StringPiece& s, const char* word)
+{
+  return s.as_string().find(word) != string::npos;
+}
+
+// 每一段前面加上长度，path和header的值里有什么字节都拼不出别人的key
+void appendKeyPart(string* key, const StringPiece& part)
+{
+  uint32_t length = static_cast<uint32_t>(part.size());
+  key->append(reinterpret_cast<const char*>(&length), sizeof length);
+  key->append(part.data(), part.size());
+}
+
+}
+
+// 每个线程一份，只有本线程访问，不加锁
+struct HttpResponseCache::Shard : boost::noncopyable
+{
+  struct Entry
+  {
+    ResponsePtr response;
+    std::list<string>::iterator lru;
+    size_t bytes;
+  };
+
+  Shard() : bytes(0) { }
+
+  ResponsePtr find(const string& k, Timestamp now)
+  {
+    std::map<string, Entry>::iterator it = entries.find(k);
+    if (it == entries.end())
+    {
+      return ResponsePtr();
+    }
+    if (it->second.response->expiration < now)
+    {
+      erase(it);
+      return ResponsePtr();
+    }
+    lru.splice(lru.begin(), lru, it->second.lru);
+    return it->second.response;
+  }
+
+  void insert(const string& k, const ResponsePtr& response, size_t maxBytes)
+  {
+    std::map<string, Entry>::iterator it = entries.find(k);
+    if (it != entries.end())
+    {
+      erase(it);
+    }
+    // key在lru和entries里各存一份
+    const size_t size = response->bytes + 2 * k.size();
+    if (size > maxBytes)
+    {
+      return;
+    }
+    while (bytes + size > maxBytes)
+    {
+      erase(entries.find(lru.back()));
+    }
+    lru.push_front(k);
+    Entry& entry = entries[k];
+    entry.response = response;
+    entry.lru = lru.begin();
+    entry.bytes = size;
+    bytes += size;
+  }
+
+  void erase(std::map<string, Entry>::iterator it)
+  {
+    bytes -= it->second.bytes;
+    lru.erase(it->second.lru);
+    entries.erase(it);
+  }
+
+  // 按最近使用排序的key，最近的在前面
+  std::list<string> lru;
+  std::map<string, Entry> entries;
+  size_t bytes;
+  string key;		// 拼key用，容量够了以后不再分配内存
+};
+
+HttpResponseCache::HttpResponseCache(const HttpCallback& cb)
+  : callback_(cb),
+    timeToLive_(1.0),
+    maxBytes_(16*1024*1024)
+{
+}
+
+HttpResponseCache::~HttpResponseCache()
+{
+}
+
+// 正在生成一个key的应答。析构时把key从filling_里拿掉，处理函数抛了异常
+// 也不会让挂起的请求一直等下去
+class HttpResponseCache::Filler : boost::noncopyable
+{
+ public:
+  Filler(HttpResponseCache* cache, const string& key)
+    : cache_(cache), key_(key), finished_(false)
+  {
+  }
+
+  ~Filler()
+  {
+    if (!finished_)
+    {
+      takeWaiters();
+    }
+    // 没答复完的，处理函数抛了异常
+    for (size_t i = 0; i < waiters_.size(); ++i)
+    {
+      waiters_[i]->response()->setStatusCode(HttpResponse::k500InternalServerError);
+      waiters_[i]->response()->setBody(string());
+      waiters_[i]->done();
+    }
+  }
+
+  // 生成完了，答复挂起的请求，response为空表示不能缓存
+  void finish(const ResponsePtr& response)
+  {
+    takeWaiters();
+    while (!waiters_.empty())
+    {
+      const HttpResponderPtr& waiter = waiters_.back();
+      if (response)
+      {
+        setResponse(*response, waiter->response());
+      }
+      else
+      {
+        cache_->callback_(waiter->request(), waiter->response());
+      }
+      HttpResponderPtr done(waiter);
+      waiters_.pop_back();
+      done->done();
+    }
+  }
+
+ private:
+  void takeWaiters()
+  {
+    MutexLockGuard lock(cache_->mutex_);
+    std::map<string, std::vector<HttpResponderPtr> >::iterator it = cache_->filling_.find(key_);
+    assert(it != cache_->filling_.end());
+    waiters_.swap(it->second);
+    cache_->filling_.erase(it);
+    finished_ = true;
+  }
+
+  HttpResponseCache* cache_;
+  const string key_;
+  bool finished_;
+  std::vector<HttpResponderPtr> waiters_;
+};
+
+// "/path?query\n<header>\n<header>..."，只有GET的应答进缓存，HEAD也查这里
+void HttpResponseCache::makeKey(const HttpRequest& req, string* key) const
+{
+  key->clear();
+  appendKeyPart(key, req.path());
+  for (size_t i = 0; i < keyHeaders_.size(); ++i)
+  {
+    appendKeyPart(key, req.getHeader(keyHeaders_[i]));
+  }
+}
+
+void HttpResponseCache::onRequest(const HttpRequest& req, HttpResponse* resp)
+{
+  bool answered = serve(req, resp, HttpResponderPtr());
+  assert(answered);
+  (void)answered;
+}
+
+void HttpResponseCache::onAsyncRequest(const HttpResponderPtr& responder)
+{
+  if (serve(responder->request(), responder->response(), responder))
+  {
+    responder->done();
+  }
+}
+
+// 填好resp返回true。别的线程正在生成同一个key时，有responder就把它挂起，
+// 由那个线程答复，返回false；没有就自己调用处理函数，不等那个线程
+bool HttpResponseCache::serve(const HttpRequest& req,
+                              HttpResponse* resp,
+                              const HttpResponderPtr& responder)
+{
+  if (req.method() != HttpRequest::kGet && req.method() != HttpRequest::kHead)
+  {
+    callback_(req, resp);
+    return true;
+  }
+
+  Shard& shard = shards_.value();
+  makeKey(req, &shard.key);
+  ResponsePtr response = shard.find(shard.key, Timestamp::now());
+  if (response)
+  {
+    setResponse(*response, resp);
+    return true;
+  }
+  if (req.method() != HttpRequest::kGet)
+  {
+    // HEAD的应答可能不带实体，不能拿来答复GET
+    callback_(req, resp);
+    return true;
+  }
+
+  bool filling = false;
+  {
+    MutexLockGuard lock(mutex_);
+    std::map<string, std::vector<HttpResponderPtr> >::iterator it = filling_.find(shard.key);
+    if (it == filling_.end())
+    {
+      filling_[shard.key];
+      filling = true;
+    }
+    else if (responder)
+    {
+      it->second.push_back(responder);
+      return false;
+    }
+  }
+
+  // 处理函数里可能又用到本线程的分片，key要单独保存一份
+  const string key(shard.key);
+  boost::scoped_ptr<Filler> filler(filling ? new Filler(this, key) : NULL);
+  callback_(req, resp);
+  response = capture(*resp);
+  if (response)
+  {
+    shard.insert(key, response, maxBytes_);
+  }
+  if (filler)
+  {
+    filler->finish(response);
+  }
+  return true;
+}
+
+void HttpResponseCache::setResponse(const Response& response, HttpResponse* resp)
+{
+  resp->setStatusCode(static_cast<HttpResponse::HttpStatusCode>(response.status));
+  if (!response.statusMessage.empty())
+  {
+    resp->setStatusMessage(response.statusMessage);
+  }
+  resp->setRawHeaders(response.headers);
+  resp->setBody(response.body);
+}
+
+HttpResponseCache::ResponsePtr HttpResponseCache::capture(const HttpResponse& resp) const
+{
+  StringPiece cacheControl(resp.getHeader("Cache-Control"));
+  if (resp.statusCode() != HttpResponse::k200Ok
+      || resp.hasBodyStream()
+      || resp.bodyFile() >= 0
+      || !resp.getHeader("Set-Cookie").empty()
+      || contains(cacheControl, "no-store")
+      || contains(cacheControl, "private"))
+  {
+    return ResponsePtr();
+  }
+
+  boost::shared_ptr<Response> response(new Response);
+  response->status = resp.statusCode();
+  response->statusMessage = resp.statusMessage();
+  Buffer headers;
+  resp.appendHeaderLinesToBuffer(&headers);
+  response->headers.reset(new Payload(&headers));
+  response->body = resp.payload() ? resp.payload() : PayloadPtr(new Payload(resp.body()));
+  response->expiration = addTime(Timestamp::now(), timeToLive_);
+  response->bytes = response->headers->size() + response->body->size();
+  return response;
+}
@@ -0,0 +1,126 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+/*缓存处理函数生成的应答：header和实体序列化后作为共享的Payload保存，
+ *按线程分片，命中时不加锁；异步使用时同时未命中的请求只调用一次处理函数*/
+#ifndef MUDUO_NET_HTTP_HTTPRESPONSECACHE_H
+#define MUDUO_NET_HTTP_HTTPRESPONSECACHE_H
+
+#include <muduo/base/Mutex.h>
+#include <muduo/base/ThreadLocal.h>
+#include <muduo/base/Timestamp.h>
+#include <muduo/base/Types.h>
+#include <muduo/net/Payload.h>
+#include <muduo/net/http/HttpResponder.h>
+
+#include <list>
+#include <map>
+#include <vector>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+namespace muduo
+{
+namespace net
+{
+
+class HttpRequest;
+class HttpResponse;
+
+///
+/// Caches the responses of an HttpCallback in memory.
+///
+/// Entries are keyed by the path, query included, and the values of the
+/// key headers.  Only responses to GET are stored, HEAD is answered from
+/// them but a miss goes to the handler.  Only 200 responses with an
+/// in-memory body are stored, unless they carry Set-Cookie or
+/// "Cache-Control: no-store" or "private".  Other methods go straight to
+/// the handler.
+///
+/// A stored response is its header lines and body as two immutable
+/// Payloads shared by every hit, the server adds the status line,
+/// Connection, Content-Length and Date.
+///
+/// Each thread calling onRequest(), i.e. each loop or worker, has its own
+/// shard, a hit takes no lock.  Nothing blocks on another thread: through
+/// onAsyncRequest(), a request missing a key that another thread is
+/// already producing is parked and answered by that thread when the handler
+/// returns, so the handler runs once.  Through onRequest() such a request
+/// calls the handler itself.  Thread safe.
+///
+/// Usage:
+///   HttpResponseCache cache(onRequest);
+///   cache.addKeyHeader("Accept-Encoding");
+///   server.setAsyncHttpCallback(boost::bind(&HttpResponseCache::onAsyncRequest, &cache, _1));
+class HttpResponseCache : boost::noncopyable
+{
+ public:
+  typedef boost::function<void (const HttpRequest&,
+                                HttpResponse*)> HttpCallback;
+
+  explicit HttpResponseCache(const HttpCallback& cb);
+  ~HttpResponseCache();
+
+  /// How long a response is served from the cache, default 1s.
+  void setTimeToLive(double seconds)
+  { timeToLive_ = seconds; }
+
+  /// Bytes kept by each shard, least recently used entries go first.
+  /// Default 16 MiB.
+  void setMaxBytes(size_t bytes)
+  { maxBytes_ = bytes; }
+
+  /// Responses differ by this request header.  Not thread safe, call
+  /// before the server starts.
+  void addKeyHeader(const string& field)
+  { keyHeaders_.push_back(field); }
+
+  /// As an HttpCallback.
+  void onRequest(const HttpRequest& req, HttpResponse* resp);
+
+  /// As an AsyncHttpCallback, calls the handler in this thread, or parks
+  /// @c responder until the thread producing the same key is done.
+  void onAsyncRequest(const HttpResponderPtr& responder);
+
+ private:
+  struct Response
+  {
+    int status;
+    string statusMessage;
+    PayloadPtr headers;
+    PayloadPtr body;
+    Timestamp expiration;
+    size_t bytes;
+  };
+  typedef boost::shared_ptr<const Response> ResponsePtr;
+
+  struct Shard;
+  class Filler;
+
+  static void setResponse(const Response& response, HttpResponse* resp);
+  void makeKey(const HttpRequest& req, string* key) const;
+  bool serve(const HttpRequest& req, HttpResponse* resp, const HttpResponderPtr& responder);
+  ResponsePtr capture(const HttpResponse& resp) const;
+
+  const HttpCallback callback_;
+  double timeToLive_;
+  size_t maxBytes_;
+  std::vector<string> keyHeaders_;
+  ThreadLocal<Shard> shards_;
+
+  MutexLock mutex_;
+  // 正在生成的key，和挂起等它的请求
+  std::map<string, std::vector<HttpResponderPtr> > filling_;
+};
+
+}
+}
+
+#endif  // MUDUO_NET_HTTP_HTTPRESPONSECACHE_H
@@ -0,0 +1,334 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+
+#include <muduo/net/http/HttpRouter.h>
+
+#include <muduo/net/http/HttpResponse.h>
+
+#include <algorithm>
+
+#include <assert.h>
+#include <string.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+const char* const kMethodNames[] = { "", "GET", "POST", "HEAD", "PUT", "DELETE" };
+
+const char* findChar(const char* begin, const char* end, char c)
+{
+  const void* p = ::memchr(begin, c, end - begin);
+  return p ? static_cast<const char*>(p) : end;
+}
+
+}
+
+StringPiece HttpRouter::Params::get(const StringPiece& name) const
+{
+  for (int i = 0; i < size_; ++i)
+  {
+    if (names_[i] == name)
+    {
+      return values_[i];
+    }
+  }
+  return StringPiece();
+}
+
+HttpRouter::Node::Node(NodeType t, const string& p)
+  : type(t),
+    text(p),
+    paramChild(-1),
+    wildcardChild(-1)
+{
+  std::fill(handlers, handlers + kNumMethods, -1);
+}
+
+HttpRouter::HttpRouter()
+{
+  nodes_.push_back(Node(kStatic, string()));
+}
+
+bool HttpRouter::add(HttpRequest::Method method,
+                     const StringPiece& pattern,
+                     const Handler& handler)
+{
+  if (method == HttpRequest::kInvalid || pattern.empty() || pattern[0] != '/')
+  {
+    return false;
+  }
+
+  // 先检查格式：参数和通配段都要从一段的开头开始，通配段只能在最后
+  const char* begin = pattern.data();
+  const char* end = begin + pattern.size();
+  int variables = 0;
+  for (const char* p = begin; p < end; ++p)
+  {
+    if (*p == ':' || *p == '*')
+    {
+      const char* nameEnd = findChar(p + 1, end, '/');
+      if (p[-1] != '/' || nameEnd == p + 1 || (*p == '*' && nameEnd != end)
+          || findChar(p + 1, nameEnd, ':') != nameEnd
+          || findChar(p + 1, nameEnd, '*') != nameEnd
+          || ++variables > kMaxParams)
+      {
+        return false;
+      }
+      p = nameEnd;
+    }
+  }
+
+  int node = 0;
+  const char* p = begin;
+  while (p < end && node >= 0)
+  {
+    const char* special = std::min(findChar(p, end, ':'), findChar(p, end, '*'));
+    if (special != p)
+    {
+      node = addStatic(node, StringPiece(p, static_cast<int>(special - p)));
+      p = special;
+    }
+    else
+    {
+      const char* nameEnd = findChar(p + 1, end, '/');
+      node = addVariable(node, *p == ':' ? kParam : kWildcard,
+                         StringPiece(p + 1, static_cast<int>(nameEnd - p - 1)));
+      p = nameEnd;
+    }
+  }
+  if (node < 0)
+  {
+    return false;
+  }
+
+  int& index = nodes_[node].handlers[method];
+  if (index < 0)
+  {
+    index = static_cast<int>(handlers_.size());
+    handlers_.push_back(handler);
+  }
+  else
+  {
+    handlers_[index] = handler;
+  }
+  return true;
+}
+
+// 沿着静态子节点走完text，必要时把已有节点从公共前缀处拆开
+int HttpRouter::addStatic(int node, StringPiece text)
+{
+  while (!text.empty())
+  {
+    const string& indices = nodes_[node].indices;
+    size_t i = indices.find(text[0]);
+    if (i == string::npos)
+    {
+      int child = static_cast<int>(nodes_.size());
+      nodes_[node].indices += text[0];
+      nodes_[node].children.push_back(child);
+      nodes_.push_back(Node(kStatic, text.as_string()));
+      return child;
+    }
+
+    int child = nodes_[node].children[i];
+    const string& prefix = nodes_[child].text;
+    size_t common = 0;
+    while (common < prefix.size() && common < static_cast<size_t>(text.size())
+           && prefix[common] == text[static_cast<int>(common)])
+    {
+      ++common;
+    }
+    if (common < prefix.size())
+    {
+      split(child, common);
+    }
+    text.remove_prefix(static_cast<int>(common));
+    node = child;
+  }
+  return node;
+}
+
+int HttpRouter::addVariable(int node, NodeType type, const StringPiece& name)
+{
+  int child = type == kParam ? nodes_[node].paramChild : nodes_[node].wildcardChild;
+  if (child >= 0)
+  {
+    // 同一位置的参数只能有一个名字
+    return name == nodes_[child].text ? child : -1;
+  }
+  child = static_cast<int>(nodes_.size());
+  if (type == kParam)
+  {
+    nodes_[node].paramChild = child;
+  }
+  else
+  {
+    nodes_[node].wildcardChild = child;
+  }
+  nodes_.push_back(Node(type, name.as_string()));
+  return child;
+}
+
+// node只保留前length个字符，剩下的部分连同原来的子节点和处理函数移到新的子节点
+void HttpRouter::split(int node, size_t length)
+{
+  Node tail(nodes_[node]);
+  tail.text.erase(0, length);
+
+  Node& head = nodes_[node];
+  head.text.resize(length);
+  head.indices.assign(1, tail.text[0]);
+  head.children.assign(1, static_cast<int>(nodes_.size()));
+  head.paramChild = -1;
+  head.wildcardChild = -1;
+  std::fill(head.handlers, head.handlers + kNumMethods, -1);
+  nodes_.push_back(tail);
+}
+
+int HttpRouter::handlerOf(int node, HttpRequest::Method method) const
+{
+  const int* handlers = nodes_[node].handlers;
+  if (method == HttpRequest::kInvalid)
+  {
+    // 任意方法
+    return *std::max_element(handlers, handlers + kNumMethods);
+  }
+  int index = handlers[method];
+  if (index < 0 && method == HttpRequest::kHead)
+  {
+    index = handlers[HttpRequest::kGet];
+  }
+  return index;
+}
+
+// node匹配[begin, end)的开头，返回最终匹配到的节点，失败时params不变
+int HttpRouter::match(int node, const char* begin, const char* end,
+                      HttpRequest::Method method, Params* params) const
+{
+  const Node& n = nodes_[node];
+  if (n.type == kStatic)
+  {
+    const size_t len = n.text.size();
+    if (static_cast<size_t>(end - begin) < len || ::memcmp(begin, n.text.data(), len) != 0)
+    {
+      return -1;
+    }
+    begin += len;
+  }
+  else
+  {
+    const char* stop = n.type == kParam ? findChar(begin, end, '/') : end;
+    if (n.type == kParam && stop == begin)
+    {
+      return -1;
+    }
+    assert(params->size_ < kMaxParams);
+    params->names_[params->size_] = n.text;
+    params->values_[params->size_] = StringPiece(begin, static_cast<int>(stop - begin));
+    ++params->size_;
+    begin = stop;
+  }
+
+  if (begin == end && handlerOf(node, method) >= 0)
+  {
+    return node;
+  }
+  int result = matchChildren(node, begin, end, method, params);
+  if (result < 0 && n.type != kStatic)
+  {
+    --params->size_;
+  }
+  return result;
+}
+
+// 静态的优先，其次是参数，最后是通配段
+int HttpRouter::matchChildren(int node, const char* begin, const char* end,
+                              HttpRequest::Method method, Params* params) const
+{
+  const Node& n = nodes_[node];
+  int result = -1;
+  if (begin < end)
+  {
+    size_t i = n.indices.find(*begin);
+    if (i != string::npos)
+    {
+      result = match(n.children[i], begin, end, method, params);
+    }
+    if (result < 0 && n.paramChild >= 0)
+    {
+      result = match(n.paramChild, begin, end, method, params);
+    }
+  }
+  if (result < 0 && n.wildcardChild >= 0)
+  {
+    result = match(n.wildcardChild, begin, end, method, params);
+  }
+  return result;
+}
+
+const HttpRouter::Handler* HttpRouter::find(HttpRequest::Method method,
+                                            const StringPiece& path,
+                                            Params* params) const
+{
+  params->size_ = 0;
+  if (method == HttpRequest::kInvalid)
+  {
+    return NULL;
+  }
+  int node = match(0, path.data(), path.data() + path.size(), method, params);
+  return node >= 0 ? &handlers_[handlerOf(node, method)] : NULL;
+}
+
+bool HttpRouter::route(const HttpRequest& req, HttpResponse* resp) const
+{
+  StringPiece path(req.path());
+  const char* query = findChar(path.data(), path.data() + path.size(), '?');
+  path = StringPiece(path.data(), static_cast<int>(query - path.data()));
+
+  Params params;
+  const Handler* handler = find(req.method(), path, &params);
+  if (handler)
+  {
+    (*handler)(req, params, resp);
+    return true;
+  }
+
+  // 路径对得上但方法不对，回答405并列出允许的方法
+  int node = match(0, path.data(), path.data() + path.size(), HttpRequest::kInvalid, &params);
+  if (node < 0)
+  {
+    return false;
+  }
+  string allow;
+  for (int m = HttpRequest::kGet; m < kNumMethods; ++m)
+  {
+    if (handlerOf(node, static_cast<HttpRequest::Method>(m)) >= 0)
+    {
+      if (!allow.empty())
+      {
+        allow += ", ";
+      }
+      allow += kMethodNames[m];
+    }
+  }
+  resp->setStatusCode(HttpResponse::k405MethodNotAllowed);
+  resp->addHeader("Allow", allow);
+  return true;
+}
+
+void HttpRouter::onRequest(const HttpRequest& req, HttpResponse* resp) const
+{
+  if (!route(req, resp))
+  {
+    resp->setStatusCode(HttpResponse::k404NotFound);
+  }
+}
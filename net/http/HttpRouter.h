@@ -0,0 +1,147 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+/*按路径把请求分发给处理函数：压缩的基数树，支持按方法分发、
+ *路径参数(:name)和通配段(*name)，匹配时不分配内存*/
+#ifndef MUDUO_NET_HTTP_HTTPROUTER_H
+#define MUDUO_NET_HTTP_HTTPROUTER_H
+
+#include <muduo/base/copyable.h>
+#include <muduo/base/StringPiece.h>
+#include <muduo/base/Types.h>
+#include <muduo/net/http/HttpRequest.h>
+
+#include <vector>
+#include <boost/function.hpp>
+
+namespace muduo
+{
+namespace net
+{
+
+class HttpResponse;
+
+///
+/// Routes requests by method and path.
+///
+/// Patterns are made of static text, parameters and a trailing wildcard:
+///   /users/:id/posts     ":id" matches one non-empty segment
+///   /static/*file        "*file" matches the rest of the path, maybe empty
+/// Static text wins over a parameter, which wins over a wildcard.
+/// The query string is ignored.  A HEAD request falls back to the GET handler.
+///
+/// Routes are kept in a compressed radix tree, matching walks the path once
+/// and fills Params on the stack, without touching the heap.
+/// Not thread safe, add all routes before the server starts, or swap in a
+/// modified copy.
+///
+/// Usage:
+///   HttpRouter router;
+///   router.add(HttpRequest::kGet, "/users/:id", onUser);
+///   server.setHttpCallback(boost::bind(&HttpRouter::onRequest, &router, _1, _2));
+class HttpRouter : public muduo::copyable
+{
+ public:
+  /// Most parameters and wildcards in one pattern.
+  static const int kMaxParams = 8;
+
+  /// Values captured by a match, they point into the request path and the
+  /// router, and are valid as long as both are.
+  class Params
+  {
+   public:
+    Params() : size_(0) { }
+
+    int size() const
+    { return size_; }
+
+    StringPiece name(int i) const
+    { return names_[i]; }
+
+    StringPiece value(int i) const
+    { return values_[i]; }
+
+    /// Value of parameter @c name, empty if there's none.
+    StringPiece get(const StringPiece& name) const;
+
+   private:
+    friend class HttpRouter;
+
+    StringPiece names_[kMaxParams];
+    StringPiece values_[kMaxParams];
+    int size_;
+  };
+
+  typedef boost::function<void (const HttpRequest&,
+                                const Params&,
+                                HttpResponse*)> Handler;
+
+  HttpRouter();
+
+  /// Registers @c handler for @c method on @c pattern, replacing the one
+  /// already there.  Returns false if the pattern is malformed, or names
+  /// a parameter differently from an existing route at the same place.
+  bool add(HttpRequest::Method method, const StringPiece& pattern, const Handler& handler);
+
+  /// Handler for @c method on @c path, or NULL.  Fills @c params.
+  const Handler* find(HttpRequest::Method method,
+                      const StringPiece& path,
+                      Params* params) const;
+
+  /// Calls the matching handler.  Answers 405 if the path matches but
+  /// the method doesn't.  Returns false, leaving @c resp alone, if no route
+  /// matches the path, so handlers can be chained.
+  bool route(const HttpRequest& req, HttpResponse* resp) const;
+
+  /// As an HttpCallback, 404 for what route() doesn't take.
+  void onRequest(const HttpRequest& req, HttpResponse* resp) const;
+
+  size_t routes() const
+  { return handlers_.size(); }
+
+ private:
+  static const int kNumMethods = HttpRequest::kDelete + 1;
+
+  enum NodeType
+  {
+    kStatic,
+    kParam,
+    kWildcard
+  };
+
+  struct Node
+  {
+    Node(NodeType t, const string& p);
+
+    NodeType type;
+    string text;		// kStatic是这段路径，其他是参数名
+    string indices;		// 各个静态子节点的第一个字符
+    std::vector<int> children;	// 静态子节点，和indices一一对应
+    int paramChild;
+    int wildcardChild;
+    int handlers[kNumMethods];	// handlers_的下标，-1表示没有
+  };
+
+  int addStatic(int node, StringPiece text);
+  int addVariable(int node, NodeType type, const StringPiece& name);
+  void split(int node, size_t length);
+  int match(int node, const char* begin, const char* end,
+            HttpRequest::Method method, Params* params) const;
+  int matchChildren(int node, const char* begin, const char* end,
+                    HttpRequest::Method method, Params* params) const;
+  int handlerOf(int node, HttpRequest::Method method) const;
+
+  std::vector<Node> nodes_;	// nodes_[0]是根，子节点用下标引用，可以直接拷贝
+  std::vector<Handler> handlers_;
+};
+
+}
+}
+
+#endif  // MUDUO_NET_HTTP_HTTPROUTER_H
@@ -10,12 +10,16 @@
 #include <muduo/net/http/HttpServer.h>
 
 #include <muduo/base/Logging.h>
+#include <muduo/base/ThreadPool.h>
+#include <muduo/net/EventLoop.h>
 #include <muduo/net/http/HttpContext.h>
 #include <muduo/net/http/HttpRequest.h>
 #include <muduo/net/http/HttpResponse.h>
 
 #include <boost/bind.hpp>
 
+#include <time.h>
+
 using namespace muduo;
 using namespace muduo::net;
 
@@ -26,116 +30,29 @@ namespace net
 namespace detail
 {
 
-// FIXME: move to HttpContext class
-//解析请求行的报头，主要获得请求方法，请求URL和请求方法1.1还是1.0
-//一般请求行相应格式如下：
-//GET http://localhost:8000/home.html HTTP/1.1
-bool processRequestLine(const char* begin, const char* end, HttpContext* context)//begin和end指向请求信息的头部和尾部
+void defaultHttpCallback(const HttpRequest&, HttpResponse* resp)
 {
-  bool succeed = false;
-  const char* start = begin;
-  const char* space = std::find(start, end, ' ');//找到第一个空格处
-  HttpRequest& request = context->request();//把解析出来的内容填入context->request_中
-  if (space != end && request.setMethod(start, space))		// 解析请求方法
-  {
-    start = space+1;
-    space = std::find(start, end, ' ');//找到第二个空格处
-    if (space != end)
-    {
-      request.setPath(start, space);	// 解析PATH
-      start = space+1;
-      succeed = end-start == 8 && std::equal(start, end-1, "HTTP/1.");
-      if (succeed)
-      {
-        if (*(end-1) == '1')
-        {
-          request.setVersion(HttpRequest::kHttp11);		// HTTP/1.1
-        }
-        else if (*(end-1) == '0')
-        {
-          request.setVersion(HttpRequest::kHttp10);		// HTTP/1.0
-        }
-        else
-        {
-          succeed = false;
-        }
-      }
-    }
-  }
-  return succeed;
+  resp->setStatusCode(HttpResponse::k404NotFound);
+  resp->setStatusMessage("Not Found");
+  resp->setCloseConnection(true);
 }
 
-// FIXME: move to HttpContext class
-// return false if any error
-//解析http请求包
-//http数据包有以下几个部分组成
-//请求行
-//请求报头
-//请求体（一般是post方法才会有，这个server不支持有body的）
-bool parseRequest(Buffer* buf, HttpContext* context, Timestamp receiveTime)
+void updateDate()
 {
-  bool ok = true;
-  bool hasMore = true;
-  while (hasMore)
-  {
-    if (context->expectRequestLine())	// 处于解析请求行状态
-    {
-      const char* crlf = buf->findCRLF();//找到终止符
-      if (crlf)
-      {
-        ok = processRequestLine(buf->peek(), crlf, context);	// 解析请求行
-        if (ok)
-        {
-          context->request().setReceiveTime(receiveTime);		// 设置请求时间
-          buf->retrieveUntil(crlf + 2);		// 将请求行从buf中取出，包括\r\n
-          context->receiveRequestLine();	// 将HttpContext状态改为kExpectHeaders
-        }
-        else
-        {
-          hasMore = false;
-        }
-      }
-      else
-      {
-        hasMore = false;
-      }
-    }
-    else if (context->expectHeaders())		// 解析请求报头，请求报头的格式“报头名称：报头数据”
-    {
-      const char* crlf = buf->findCRLF();
-      if (crlf)
-      {
-        const char* colon = std::find(buf->peek(), crlf, ':');		//冒号所在位置
-        if (colon != crlf)//如果相等，那么就说明是空行，报头解析就结束了
-        {
-          context->request().addHeader(buf->peek(), colon, crlf);
-        }
-        else
-        {
-          // empty line, end of header
-          context->receiveHeaders();		// HttpContext将状态改为kGotAll
-          hasMore = !context->gotAll();
-        }
-        buf->retrieveUntil(crlf + 2);		// 将header从buf中取回，包括\r\n
-      }
-      else
-      {
-        hasMore = false;
-      }
-    }
-    else if (context->expectBody())			// 当前还不支持请求中带body
-    {
-      // FIXME:
-    }
-  }
-  return ok;
+  HttpResponse::updateDate(::time(NULL));
 }
 
-void defaultHttpCallback(const HttpRequest&, HttpResponse* resp)
+const char* errorResponse(int status)
 {
-  resp->setStatusCode(HttpResponse::k404NotFound);
-  resp->setStatusMessage("Not Found");
-  resp->setCloseConnection(true);
+  switch (status)
+  {
+    case 413:
+      return "HTTP/1.1 413 Payload Too Large\r\n\r\n";
+    case 431:
+      return "HTTP/1.1 431 Request Header Fields Too Large\r\n\r\n";
+    default:
+      return "HTTP/1.1 400 Bad Request\r\n\r\n";
+  }
 }
 
 }
@@ -146,12 +63,20 @@ HttpServer::HttpServer(EventLoop* loop,
                        const InetAddress& listenAddr,
                        const string& name)
   : server_(loop, listenAddr, name),
-    httpCallback_(detail::defaultHttpCallback)
+    httpCallback_(detail::defaultHttpCallback),
+    numWorkerThreads_(0),
+    maxInFlight_(0),
+    streamThreshold_(0),
+    maxHeaderSize_(HttpContext::kDefaultMaxHeaderSize),
+    maxBodySize_(HttpContext::kDefaultMaxBodySize),
+    highWaterMark_(kDefaultHighWaterMark)
 {
   server_.setConnectionCallback(
       boost::bind(&HttpServer::onConnection, this, _1));
   server_.setMessageCallback(
       boost::bind(&HttpServer::onMessage, this, _1, _2, _3));
+  server_.setWriteCompleteCallback(
+      boost::bind(&HttpServer::onWriteComplete, this, _1));
 }
 
 HttpServer::~HttpServer()
@@ -160,17 +85,43 @@ HttpServer::~HttpServer()
 
 void HttpServer::start()
 {
+  if (numWorkerThreads_ > 0)
+  {
+    workers_.reset(new ThreadPool(server_.name() + "Worker"));
+    workers_->start(numWorkerThreads_);
+  }
+  server_.setThreadInitCallback(
+      boost::bind(&HttpServer::onThreadInit, this, _1));
   LOG_WARN << "HttpServer[" << server_.name()
     << "] starts listenning on " << server_.hostport();
   server_.start();
 }
 
+// 在每个IO线程里每秒刷新一次Date，不用每个应答都格式化时间
+void HttpServer::onThreadInit(EventLoop* loop)
+{
+  detail::updateDate();
+  loop->runEvery(1.0, detail::updateDate);
+  if (threadInitCallback_)
+  {
+    threadInitCallback_(loop);
+  }
+}
+
 void HttpServer::onConnection(const TcpConnectionPtr& conn)//这个函数绑定到TcpServer::connectionCallback_上，
 //其实就是绑定到TcpConnection::connectionCallback_上，也就是在和客户端建立连接以后，以及断开连接前，会调用这个函数
 {
   if (conn->connected())
   {
-    conn->setContext(HttpContext());	// TcpConnection与一个HttpContext绑定
+    HttpContext* context = conn->emplaceContext<HttpContext>();	// HttpContext直接构造在TcpConnection里面
+    context->setMaxHeaderSize(maxHeaderSize_);
+    context->setMaxBodySize(maxBodySize_);
+    if (bodyCallback_)
+    {
+      context->setStreamThreshold(streamThreshold_);
+    }
+    conn->setHighWaterMarkCallback(
+        boost::bind(&HttpServer::onHighWaterMark, this, _1, _2), highWaterMark_);
   }
 }
 
@@ -178,35 +129,255 @@ void HttpServer::onMessage(const TcpConnectionPtr& conn,
                            Buffer* buf,
                            Timestamp receiveTime)//这个函数绑定在TcpConnection::messageCallback_上，会在TCpConnection的channel读函数中调用
 {
-  HttpContext* context = boost::any_cast<HttpContext>(conn->getMutableContext());
-
-  if (!detail::parseRequest(buf, context, receiveTime))
+  HttpContext* context = conn->context<HttpContext>();
+  if (context->errorStatus() != 0 || context->closing())
   {
-    conn->send("HTTP/1.1 400 Bad Request\r\n\r\n");
-    conn->shutdown();
+    buf->retrieveAll();		// 已经回复了错误或者要关闭连接，不再处理后面的请求
+    return;
   }
 
-  // 请求消息解析完毕
-  if (context->gotAll())
+  // 把buf中完整的请求都处理完，应答按顺序攒在output里，最后只发一次
+  Buffer output;
+  bool close = false;
+  while (!close)
   {
-    onRequest(conn, context->request());
+    if (!context->parseRequest(buf, receiveTime))
+    {
+      Buffer error;
+      error.append(detail::errorResponse(context->errorStatus()));
+      close = context->finishResponse(context->startResponse(), &error, true, &output);
+      break;
+    }
+
+    // 流式接收的body，交给用户后从buf中去掉，只留请求行和报头
+    if (context->hasBodyPiece())
+    {
+      bodyCallback_(conn, context->request(), context->bodyPiece(buf));
+      context->discardBodyPiece(buf);
+    }
+
+    if (!context->gotAll())
+    {
+      break;
+    }
+    // 请求消息解析完毕
+    conn->countMessage();
+    close = onRequest(conn, context, buf, &output);
+    buf->retrieve(context->requestLength());	// 请求引用着buf中的数据，处理完才能取走
     context->reset();		// 本次请求处理完毕，重置HttpContext，适用于长连接
+    if (buf->readableBytes() == 0)
+    {
+      break;
+    }
+  }
+
+  if (close)
+  {
+    buf->retrieveAll();
   }
+  flush(conn, context, &output, close);
 }
 
-void HttpServer::onRequest(const TcpConnectionPtr& conn, const HttpRequest& req)
+bool HttpServer::onRequest(const TcpConnectionPtr& conn,
+                           HttpContext* context,
+                           const Buffer* input,
+                           Buffer* output)
 {
-  const string& connection = req.getHeader("Connection");
+  const HttpRequest& req = context->request();
+  const int64_t id = context->startResponse();
+  StringPiece connection = req.getHeader("Connection");
   bool close = connection == "close" ||
     (req.getVersion() == HttpRequest::kHttp10 && connection != "Keep-Alive");
+
+  if (asyncHttpCallback_ || workers_)
+  {
+    if (maxInFlight_ > 0 && inFlight_.incrementAndGet() > maxInFlight_)
+    {
+      inFlight_.decrement();
+      HttpResponse busy(close);
+      busy.setStatusCode(HttpResponse::k503ServiceUnavailable);
+      return writeResponse(conn, context, id, req, &busy, output);
+    }
+    // 请求引用着input，拷贝一份交出去
+    HttpResponderPtr responder(new HttpResponder(
+        conn, id, req,
+        StringPiece(input->peek(), static_cast<int>(context->requestLength())),
+        close,
+        boost::bind(&HttpServer::onResponseDone, this, _1)));
+    if (asyncHttpCallback_)
+    {
+      asyncHttpCallback_(responder);
+    }
+    else
+    {
+      workers_->run(boost::bind(&HttpServer::runHttpCallback, this, responder));
+    }
+    return false;
+  }
+
   HttpResponse response(close);
   httpCallback_(req, &response);
+  return writeResponse(conn, context, id, req, &response, output);
+}
+
+// 前面的应答都已经在output里时直接写进去，否则先放在一边排队
+bool HttpServer::writeResponse(const TcpConnectionPtr& conn,
+                               HttpContext* context,
+                               int64_t id,
+                               const HttpRequest& req,
+                               HttpResponse* response,
+                               Buffer* output)
+{
+  if (req.method() == HttpRequest::kHead)
+  {
+    // 只发header，Content-Length还是实体的长度
+    if (context->isNextResponse(id))
+    {
+      response->appendHeadersToBuffer(output);
+      return context->finishResponse(id, NULL, response->closeConnection(), output);
+    }
+    Buffer headers;
+    response->appendHeadersToBuffer(&headers);
+    return context->finishResponse(id, &headers, response->closeConnection(), output);
+  }
+
+  HttpStreamPtr stream;
+  if (response->hasBodyStream())
+  {
+    // HTTP/1.0不支持chunked，靠关闭连接结束实体
+    if (req.getVersion() != HttpRequest::kHttp11)
+    {
+      response->setCloseConnection(true);
+    }
+    stream.reset(new HttpStream(conn, !response->closeConnection(), response->bodyStream(),
+                                boost::bind(&HttpServer::onStreamFinished, this, _1)));
+  }
+
+  if (response->hasExternalBody())
+  {
+    // 实体不拷贝，轮到它时先把前面攒着的发出去，再发实体，见flush()
+    HttpContext::Body body;
+    body.payload = response->payload();
+    body.fd = response->bodyFile();
+    body.offset = response->bodyFileOffset();
+    body.length = response->bodySize();
+    body.owner = response->bodyFileOwner();
+    Buffer headers;
+    response->appendHeadersToBuffer(&headers);
+    return context->finishResponse(id, &headers, response->closeConnection(), output,
+                                   HttpStreamPtr(), &body);
+  }
+
+  if (context->isNextResponse(id))
+  {
+    response->appendToBuffer(output);
+    return context->finishResponse(id, NULL, response->closeConnection(), output, stream);
+  }
   Buffer buf;
-  response.appendToBuffer(&buf);
-  conn->send(&buf);
-  if (response.closeConnection())
+  response->appendToBuffer(&buf);
+  return context->finishResponse(id, &buf, response->closeConnection(), output, stream);
+}
+
+// 发出攒着的应答，其中最后一个的实体是流式的话，从这里开始生产
+void HttpServer::flush(const TcpConnectionPtr& conn, HttpContext* context,
+                       Buffer* output, bool close)
+{
+  HttpContext::Body body;
+  while (context->takeBody(&body))
+  {
+    if (output->readableBytes() > 0)
+    {
+      conn->send(output);
+    }
+    if (body.payload)
+    {
+      conn->send(body.payload);
+    }
+    else
+    {
+      conn->sendFile(body.fd, body.offset, body.length);
+    }
+    body = HttpContext::Body();	// sendFile()已经dup了fd，可以放掉owner了
+    close = context->finishBody(output);
+  }
+  if (output->readableBytes() > 0)
+  {
+    conn->send(output);
+  }
+  HttpStreamPtr stream(context->startStream());
+  if (stream)
+  {
+    stream->produce();
+  }
+  if (close)
   {
     conn->shutdown();
   }
 }
 
+// 在工作线程中执行
+void HttpServer::runHttpCallback(const HttpResponderPtr& responder)
+{
+  httpCallback_(responder->request(), responder->response());
+  responder->done();
+}
+
+// 在连接所在的IO线程中执行，连接已经断开时在调用done()的线程中执行
+void HttpServer::onResponseDone(const HttpResponderPtr& responder)
+{
+  if (maxInFlight_ > 0)
+  {
+    inFlight_.decrement();
+  }
+  TcpConnectionPtr conn(responder->connection());
+  if (!conn || !conn->connected())
+  {
+    return;
+  }
+  HttpContext* context = conn->context<HttpContext>();
+  Buffer output;
+  bool close = writeResponse(conn, context, responder->id(), responder->request(),
+                             responder->response(), &output);
+  flush(conn, context, &output, close);
+}
+
+// 在连接所在的IO线程中执行
+void HttpServer::onStreamFinished(const HttpStreamPtr& stream)
+{
+  TcpConnectionPtr conn(stream->connection());
+  if (!conn || !conn->connected())
+  {
+    return;
+  }
+  HttpContext* context = conn->context<HttpContext>();
+  assert(context->activeStream() == stream);
+  Buffer output;
+  bool close = context->finishStream(&output);
+  flush(conn, context, &output, close);
+}
+
+// 发送缓冲发完了，让正在流式发送的应答继续生产
+void HttpServer::onWriteComplete(const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    HttpContext* context = conn->context<HttpContext>();
+    HttpStreamPtr stream(context->activeStream());
+    if (stream)
+    {
+      stream->produce();
+    }
+  }
+}
+
+void HttpServer::onHighWaterMark(const TcpConnectionPtr& conn, size_t)
+{
+  if (conn->connected())
+  {
+    HttpContext* context = conn->context<HttpContext>();
+    if (context->activeStream())
+    {
+      context->activeStream()->pause();
+    }
+  }
+}
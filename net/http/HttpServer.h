@@ -11,26 +11,45 @@
 #ifndef MUDUO_NET_HTTP_HTTPSERVER_H
 #define MUDUO_NET_HTTP_HTTPSERVER_H
 
+#include <muduo/base/Atomic.h>
 #include <muduo/net/TcpServer.h>
+#include <muduo/net/http/HttpResponder.h>
+
 #include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
 
 namespace muduo
 {
+
+class ThreadPool;
+
 namespace net
 {
 
-class HttpRequest;
-class HttpResponse;
+class HttpContext;
 
 /// A simple embeddable HTTP server designed for report status of a program.
 /// It is not a fully HTTP 1.1 compliant server, but provides minimum features
 /// that can communicate with HttpClient and Web browser.
-/// It is synchronous, just like Java Servlet.
+/// It is synchronous, just like Java Servlet, unless handlers are run in
+/// worker threads or registered as AsyncHttpCallback.
 class HttpServer : boost::noncopyable
 {
  public:
+  static const size_t kDefaultHighWaterMark = 1024*1024;
+
   typedef boost::function<void (const HttpRequest&,
                                 HttpResponse*)> HttpCallback;
+  /// Handles a request in the IO thread, answering later from any thread
+  /// with responder->done().
+  typedef boost::function<void (const HttpResponderPtr&)> AsyncHttpCallback;
+
+  /// A piece of a streamed request body.  Call conn->stopRead() to stop
+  /// receiving more until conn->startRead(), e.g. while the piece is being
+  /// written out.  The piece is gone after the callback returns.
+  typedef boost::function<void (const TcpConnectionPtr&,
+                                const HttpRequest&,
+                                const StringPiece&)> BodyCallback;
 
   HttpServer(EventLoop* loop,
              const InetAddress& listenAddr,
@@ -45,22 +64,88 @@ class HttpServer : boost::noncopyable
     httpCallback_ = cb;
   }
 
+  /// Takes precedence over the HttpCallback.
+  /// Not thread safe, callback be registered before calling start().
+  void setAsyncHttpCallback(const AsyncHttpCallback& cb)
+  { asyncHttpCallback_ = cb; }
+
+  /// Runs the HttpCallback in a pool of @c numThreads worker threads,
+  /// keeping the IO threads free.  Must be called before start().
+  void setWorkerThreads(int numThreads)
+  { numWorkerThreads_ = numThreads; }
+
+  /// Asynchronous requests being handled at most, across all connections.
+  /// Beyond that requests are answered with 503 right away.  0 (the default)
+  /// means no limit.
+  void setMaxRequestsInFlight(int maxRequests)
+  { maxInFlight_ = maxRequests; }
+
+  /// Bodies longer than @c threshold bytes go to @c cb in pieces as they
+  /// arrive, instead of being buffered whole.  The HttpCallback follows once
+  /// the body is complete, with HttpRequest::bodyStreamed() set.
+  /// Not thread safe, callback be registered before calling start().
+  void setBodyCallback(const BodyCallback& cb, size_t threshold = 64*1024)
+  {
+    bodyCallback_ = cb;
+    streamThreshold_ = threshold;
+  }
+
+  /// Longer request line plus headers are answered with 431, default 64KiB.
+  void setMaxHeaderSize(size_t bytes)
+  { maxHeaderSize_ = bytes; }
+
+  /// Longer bodies are answered with 413, default 1MiB.
+  /// Raise it for streamed uploads.
+  void setMaxBodySize(size_t bytes)
+  { maxBodySize_ = bytes; }
+
   void setThreadNum(int numThreads)
   {
     server_.setThreadNum(numThreads);
   }
 
+  /// Streamed response bodies pause while a connection has more than
+  /// @c bytes unsent, see HttpStream::paused().  Default 1MiB.
+  /// Must be called before start().
+  void setStreamHighWaterMark(size_t bytes)
+  { highWaterMark_ = bytes; }
+
+  /// Called in each IO loop before it starts, after HttpServer's own setup.
+  void setThreadInitCallback(const TcpServer::ThreadInitCallback& cb)
+  { threadInitCallback_ = cb; }
+
   void start();
 
  private:
+  void onThreadInit(EventLoop* loop);
   void onConnection(const TcpConnectionPtr& conn);
   void onMessage(const TcpConnectionPtr& conn,
                  Buffer* buf,
                  Timestamp receiveTime);
-  void onRequest(const TcpConnectionPtr&, const HttpRequest&);
+  // 处理一个请求，应答按顺序写到output，返回是否要关闭连接
+  bool onRequest(const TcpConnectionPtr&, HttpContext*, const Buffer* input, Buffer* output);
+  bool writeResponse(const TcpConnectionPtr&, HttpContext*, int64_t id,
+                     const HttpRequest&, HttpResponse*, Buffer* output);
+  void flush(const TcpConnectionPtr&, HttpContext*, Buffer* output, bool close);
+  void runHttpCallback(const HttpResponderPtr& responder);
+  void onResponseDone(const HttpResponderPtr& responder);
+  void onStreamFinished(const HttpStreamPtr& stream);
+  void onWriteComplete(const TcpConnectionPtr& conn);
+  void onHighWaterMark(const TcpConnectionPtr& conn, size_t len);
 
   TcpServer server_;
   HttpCallback httpCallback_;	// 在处理http请求（即调用onRequest）的过程中回调此函数，对请求进行具体的处理
+  AsyncHttpCallback asyncHttpCallback_;
+  BodyCallback bodyCallback_;	// 大的请求实体分段回调
+  int numWorkerThreads_;
+  boost::scoped_ptr<ThreadPool> workers_;	// 执行httpCallback_的线程池
+  int maxInFlight_;
+  AtomicInt32 inFlight_;		// 正在异步处理的请求数
+  TcpServer::ThreadInitCallback threadInitCallback_;
+  size_t streamThreshold_;
+  size_t maxHeaderSize_;
+  size_t maxBodySize_;
+  size_t highWaterMark_;
 };
 
 }
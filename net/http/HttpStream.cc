@@ -0,0 +1,90 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+
+#include <muduo/net/http/HttpStream.h>
+
+#include <muduo/net/Buffer.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/TcpConnection.h>
+
+#include <boost/bind.hpp>
+
+using namespace muduo;
+using namespace muduo::net;
+
+HttpStream::HttpStream(const TcpConnectionPtr& conn,
+                       bool chunked,
+                       const ProduceCallback& producer,
+                       const FinishCallback& finishCallback)
+  : conn_(conn),
+    chunked_(chunked),
+    producer_(producer),
+    finishCallback_(finishCallback)
+{
+}
+
+bool HttpStream::write(const StringPiece& data)
+{
+  TcpConnectionPtr conn(conn_.lock());
+  if (finished() || !conn || !conn->connected())
+  {
+    return false;
+  }
+  if (!chunked_)
+  {
+    conn->send(data);
+  }
+  else if (data.size() > 0)	// 长度为0的chunk表示结束，不能发
+  {
+    // chunk长度行 + 数据 + \r\n，一次发出
+    static const char kHex[] = "0123456789abcdef";
+    char size[sizeof(size_t) * 2];
+    char* p = size + sizeof size;
+    size_t n = data.size();
+    do
+    {
+      *--p = kHex[n & 0xf];
+      n >>= 4;
+    } while (n != 0);
+    Buffer buf;
+    buf.append(p, size + sizeof size - p);
+    buf.append("\r\n", 2);
+    buf.append(data);
+    buf.append("\r\n", 2);
+    conn->send(&buf);
+  }
+  return true;
+}
+
+void HttpStream::finish()
+{
+  if (finished_.getAndSet(1) != 0)
+  {
+    return;
+  }
+  TcpConnectionPtr conn(conn_.lock());
+  if (conn)
+  {
+    if (chunked_)
+    {
+      conn->send("0\r\n\r\n");
+    }
+    // 排在上面的发送之后
+    conn->getLoop()->queueInLoop(boost::bind(finishCallback_, shared_from_this()));
+  }
+}
+
+void HttpStream::produce()
+{
+  paused_.getAndSet(0);
+  if (!finished())
+  {
+    producer_(shared_from_this());
+  }
+}
@@ -0,0 +1,89 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+/*流式发送应答的实体：HTTP/1.1长连接用chunked编码，否则直接发送、发完关闭连接。
+ *连接的发送缓冲超过高水位标时暂停，发完后再让生产者继续写*/
+#ifndef MUDUO_NET_HTTP_HTTPSTREAM_H
+#define MUDUO_NET_HTTP_HTTPSTREAM_H
+
+#include <muduo/base/Atomic.h>
+#include <muduo/base/StringPiece.h>
+#include <muduo/net/Callbacks.h>
+
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/weak_ptr.hpp>
+
+namespace muduo
+{
+namespace net
+{
+
+class HttpStream;
+typedef boost::shared_ptr<HttpStream> HttpStreamPtr;
+
+///
+/// The body of a response, written piece by piece over time.
+///
+/// The ProduceCallback set with HttpResponse::setBodyStream() is called in
+/// the IO thread once the headers are out, and again each time the output
+/// buffer drains, so a producer that writes a bounded amount per call is
+/// paced by the peer.  Producers writing from other threads should check
+/// paused() and wait for the next call before writing more.
+class HttpStream : boost::noncopyable,
+                   public boost::enable_shared_from_this<HttpStream>
+{
+ public:
+  typedef boost::function<void (const HttpStreamPtr&)> ProduceCallback;
+  typedef boost::function<void (const HttpStreamPtr&)> FinishCallback;
+
+  HttpStream(const TcpConnectionPtr& conn,
+             bool chunked,
+             const ProduceCallback& producer,
+             const FinishCallback& finishCallback);
+
+  /// Sends @c data as the next piece of the body.  Thread safe.
+  /// Returns false once finished or the connection is gone.
+  bool write(const StringPiece& data);
+
+  /// Ends the body, the next response on the connection may follow.
+  /// Thread safe.
+  void finish();
+
+  /// The output buffer is above the high water mark, writes keep
+  /// piling up in memory.  Thread safe.
+  bool paused()
+  { return paused_.get() != 0; }
+
+  bool finished()
+  { return finished_.get() != 0; }
+
+  /// Empty once the connection is gone.
+  TcpConnectionPtr connection() const
+  { return conn_.lock(); }
+
+  // 下面的由HttpServer在IO线程中调用
+  void produce();
+  void pause()
+  { paused_.getAndSet(1); }
+
+ private:
+  boost::weak_ptr<TcpConnection> conn_;
+  const bool chunked_;		// chunked编码，否则靠关闭连接结束实体
+  ProduceCallback producer_;
+  FinishCallback finishCallback_;
+  AtomicInt32 paused_;
+  AtomicInt32 finished_;
+};
+
+}
+}
+
+#endif  // MUDUO_NET_HTTP_HTTPSTREAM_H
@@ -0,0 +1,23 @@
+#include "AllocationCounter.h"
+
+#include <new>
+#include <stdlib.h>
+
+int64_t g_allocations = 0;
+
+// 不写异常规格，C++98和C++11以后都能替换标准库的版本
+void* operator new(size_t size)
+{
+  ++g_allocations;
+  void* p = ::malloc(size == 0 ? 1 : size);
+  if (p == NULL)
+  {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void* p)
+{
+  ::free(p);
+}
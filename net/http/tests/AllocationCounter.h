@@ -0,0 +1,14 @@
+// Counts calls to the global operator new, for the benchmarks.
+//
+// Link AllocationCounter.cc into a benchmark, it replaces operator new
+// and operator delete for the whole program.
+
+#ifndef MUDUO_NET_HTTP_TESTS_ALLOCATIONCOUNTER_H
+#define MUDUO_NET_HTTP_TESTS_ALLOCATIONCOUNTER_H
+
+#include <stdint.h>
+
+// operator new的调用次数，只在一个线程里用，不加锁
+extern int64_t g_allocations;
+
+#endif  // MUDUO_NET_HTTP_TESTS_ALLOCATIONCOUNTER_H
@@ -0,0 +1,207 @@
+#include <muduo/net/http/HttpFileServer.h>
+#include <muduo/net/http/HttpContext.h>
+#include <muduo/net/http/HttpResponse.h>
+#include <muduo/net/Buffer.h>
+
+//#define BOOST_TEST_MODULE HttpFileServerTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using muduo::string;
+using muduo::Timestamp;
+using muduo::net::Buffer;
+using muduo::net::HttpContext;
+using muduo::net::HttpFileServer;
+using muduo::net::HttpResponse;
+
+namespace
+{
+
+// 临时目录，里面有index.html和a.txt
+struct Fixture
+{
+  Fixture()
+  {
+    char dir[] = "/tmp/httpfileserver_unittestXXXXXX";
+    root = ::mkdtemp(dir);
+    writeFile("index.html", "<html></html>");
+    writeFile("a.txt", "0123456789");
+    ::mkdir((root + "/sub").c_str(), 0755);
+    writeFile("sub/b%.txt", "b");
+  }
+
+  ~Fixture()
+  {
+    ::unlink((root + "/index.html").c_str());
+    ::unlink((root + "/a.txt").c_str());
+    ::unlink((root + "/sub/b%.txt").c_str());
+    ::rmdir((root + "/sub").c_str());
+    ::rmdir(root.c_str());
+  }
+
+  void writeFile(const string& name, const string& content)
+  {
+    FILE* fp = ::fopen((root + "/" + name).c_str(), "w");
+    ::fwrite(content.data(), 1, content.size(), fp);
+    ::fclose(fp);
+  }
+
+  string root;
+};
+
+// 解析请求交给files处理，返回序列化后的应答，不处理时返回空串
+string serve(HttpFileServer* files, const string& request)
+{
+  HttpContext context;
+  Buffer input;
+  input.append(request);
+  BOOST_REQUIRE(context.parseRequest(&input, Timestamp::now()));
+  BOOST_REQUIRE(context.gotAll());
+  HttpResponse response(false);
+  if (!files->handle(context.request(), &response))
+  {
+    return string();
+  }
+  Buffer output;
+  if (response.bodyFile() < 0)
+  {
+    response.appendToBuffer(&output);
+    return output.retrieveAllAsString();
+  }
+  // 文件实体HttpServer会sendFile，这里读出来接在header后面
+  response.appendHeadersToBuffer(&output);
+  string body(response.bodySize(), '\0');
+  BOOST_REQUIRE(::pread(response.bodyFile(), &body[0], body.size(), response.bodyFileOffset())
+                == static_cast<ssize_t>(body.size()));
+  return output.retrieveAllAsString() + body;
+}
+
+bool contains(const string& s, const string& part)
+{
+  return s.find(part) != string::npos;
+}
+
+// 应答头中的某个值
+string header(const string& response, const string& field)
+{
+  size_t start = response.find("\r\n" + field + ": ");
+  if (start == string::npos)
+  {
+    return string();
+  }
+  start += field.size() + 4;
+  return response.substr(start, response.find("\r\n", start) - start);
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(testServeFile)
+{
+  Fixture fixture;
+  HttpFileServer files(fixture.root, "/static/");
+
+  string resp = serve(&files, "GET /static/a.txt?v=1 HTTP/1.1\r\n\r\n");
+  BOOST_CHECK(contains(resp, "HTTP/1.1 200 OK\r\n"));
+  BOOST_CHECK_EQUAL(header(resp, "Content-Length"), string("10"));
+  BOOST_CHECK_EQUAL(header(resp, "Content-Type"), string("text/plain; charset=utf-8"));
+  BOOST_CHECK_EQUAL(header(resp, "Accept-Ranges"), string("bytes"));
+  BOOST_CHECK(!header(resp, "ETag").empty());
+  BOOST_CHECK(!header(resp, "Last-Modified").empty());
+  BOOST_CHECK(contains(resp, "\r\n\r\n0123456789"));
+  BOOST_CHECK_EQUAL(files.cachedFiles(), 1);
+
+  resp = serve(&files, "GET /static/ HTTP/1.1\r\n\r\n");
+  BOOST_CHECK(contains(resp, "\r\n\r\n<html></html>"));
+  BOOST_CHECK_EQUAL(header(resp, "Content-Type"), string("text/html; charset=utf-8"));
+
+  resp = serve(&files, "GET /static/sub/b%25.txt HTTP/1.1\r\n\r\n");
+  BOOST_CHECK(contains(resp, "\r\n\r\nb"));
+
+  BOOST_CHECK(contains(serve(&files, "GET /static/missing HTTP/1.1\r\n\r\n"), "HTTP/1.1 404"));
+  BOOST_CHECK(contains(serve(&files, "GET /static/../a.txt HTTP/1.1\r\n\r\n"), "HTTP/1.1 404"));
+  BOOST_CHECK(contains(serve(&files, "GET /static/sub/%2e%2e/a.txt HTTP/1.1\r\n\r\n"),
+                       "HTTP/1.1 404"));
+  BOOST_CHECK(serve(&files, "GET /other/a.txt HTTP/1.1\r\n\r\n").empty());
+  BOOST_CHECK(serve(&files, "DELETE /static/a.txt HTTP/1.1\r\n\r\n").empty());
+}
+
+BOOST_AUTO_TEST_CASE(testConditional)
+{
+  Fixture fixture;
+  HttpFileServer files(fixture.root);
+
+  string resp = serve(&files, "GET /a.txt HTTP/1.1\r\n\r\n");
+  const string etag = header(resp, "ETag");
+  const string lastModified = header(resp, "Last-Modified");
+
+  resp = serve(&files, "GET /a.txt HTTP/1.1\r\nIf-None-Match: \"x\", " + etag + "\r\n\r\n");
+  BOOST_CHECK(contains(resp, "HTTP/1.1 304 Not Modified\r\n"));
+  BOOST_CHECK(header(resp, "Content-Length").empty());
+  BOOST_CHECK_EQUAL(header(resp, "ETag"), etag);
+  BOOST_CHECK(!contains(resp, "0123456789"));
+
+  resp = serve(&files, "GET /a.txt HTTP/1.1\r\nIf-Modified-Since: " + lastModified + "\r\n\r\n");
+  BOOST_CHECK(contains(resp, "HTTP/1.1 304"));
+
+  resp = serve(&files, "GET /a.txt HTTP/1.1\r\nIf-None-Match: \"x\"\r\n\r\n");
+  BOOST_CHECK(contains(resp, "HTTP/1.1 200"));
+}
+
+BOOST_AUTO_TEST_CASE(testRange)
+{
+  Fixture fixture;
+  HttpFileServer files(fixture.root);
+
+  string resp = serve(&files, "GET /a.txt HTTP/1.1\r\nRange: bytes=2-4\r\n\r\n");
+  BOOST_CHECK(contains(resp, "HTTP/1.1 206 Partial Content\r\n"));
+  BOOST_CHECK_EQUAL(header(resp, "Content-Range"), string("bytes 2-4/10"));
+  BOOST_CHECK_EQUAL(header(resp, "Content-Length"), string("3"));
+  BOOST_CHECK(contains(resp, "\r\n\r\n234"));
+
+  resp = serve(&files, "GET /a.txt HTTP/1.1\r\nRange: bytes=7-\r\n\r\n");
+  BOOST_CHECK_EQUAL(header(resp, "Content-Range"), string("bytes 7-9/10"));
+  resp = serve(&files, "GET /a.txt HTTP/1.1\r\nRange: bytes=-3\r\n\r\n");
+  BOOST_CHECK_EQUAL(header(resp, "Content-Range"), string("bytes 7-9/10"));
+  resp = serve(&files, "GET /a.txt HTTP/1.1\r\nRange: bytes=5-100\r\n\r\n");
+  BOOST_CHECK_EQUAL(header(resp, "Content-Range"), string("bytes 5-9/10"));
+
+  resp = serve(&files, "GET /a.txt HTTP/1.1\r\nRange: bytes=10-\r\n\r\n");
+  BOOST_CHECK(contains(resp, "HTTP/1.1 416"));
+  BOOST_CHECK_EQUAL(header(resp, "Content-Range"), string("bytes */10"));
+
+  // 多个区间和不匹配的If-Range都发整个文件
+  resp = serve(&files, "GET /a.txt HTTP/1.1\r\nRange: bytes=0-1,3-4\r\n\r\n");
+  BOOST_CHECK(contains(resp, "HTTP/1.1 200"));
+  resp = serve(&files, "GET /a.txt HTTP/1.1\r\nRange: bytes=0-1\r\nIf-Range: \"old\"\r\n\r\n");
+  BOOST_CHECK(contains(resp, "HTTP/1.1 200"));
+}
+
+BOOST_AUTO_TEST_CASE(testCache)
+{
+  Fixture fixture;
+  HttpFileServer files(fixture.root);
+  files.setMaxCachedFiles(1);
+
+  serve(&files, "GET /a.txt HTTP/1.1\r\n\r\n");
+  serve(&files, "GET /index.html HTTP/1.1\r\n\r\n");
+  BOOST_CHECK_EQUAL(files.cachedFiles(), 1);
+
+  // 立即重新检查，文件变了就重新打开
+  files.setRevalidateInterval(0);
+  fixture.writeFile("a.txt", "changed");
+  string resp = serve(&files, "GET /a.txt HTTP/1.1\r\n\r\n");
+  BOOST_CHECK(contains(resp, "\r\n\r\nchanged"));
+  resp = serve(&files, "GET /a.txt HTTP/1.1\r\n\r\n");
+  BOOST_CHECK(contains(resp, "\r\n\r\nchanged"));
+
+  ::unlink((fixture.root + "/a.txt").c_str());
+  BOOST_CHECK(contains(serve(&files, "GET /a.txt HTTP/1.1\r\n\r\n"), "HTTP/1.1 404"));
+  BOOST_CHECK_EQUAL(files.cachedFiles(), 0);
+  fixture.writeFile("a.txt", "");
+}
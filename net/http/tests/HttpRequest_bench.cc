@@ -0,0 +1,81 @@
+// Parsing speed and heap allocations of HttpContext::parseRequest.
+//
+// usage: httprequest_bench [requests]
+//
+// Parses a typical browser request over and over, in one piece and
+// arriving in two pieces, and counts operator new calls per request.
+
+#include <muduo/net/http/HttpContext.h>
+#include <muduo/net/Buffer.h>
+#include <muduo/base/Timestamp.h>
+#include "AllocationCounter.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const char kRequest[] =
+  "GET /static/js/app.js?v=20101018 HTTP/1.1\r\n"
+  "Host: www.chenshuo.com\r\n"
+  "Connection: keep-alive\r\n"
+  "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/534.10 (KHTML, like Gecko) Chrome/8.0.552.0 Safari/534.10\r\n"
+  "Accept: */*\r\n"
+  "Referer: http://www.chenshuo.com/\r\n"
+  "Accept-Encoding: gzip,deflate,sdch\r\n"
+  "Accept-Language: en-US,en;q=0.8\r\n"
+  "Accept-Charset: ISO-8859-1,utf-8;q=0.7,*;q=0.3\r\n"
+  "Cookie: session=0123456789abcdef\r\n"
+  "\r\n";
+
+// split为0时一次收到整个请求，否则分两次收到
+void bench(int requests, size_t split)
+{
+  const size_t len = sizeof kRequest - 1;
+  HttpContext context;
+  Buffer buf;
+  // 预热，让Buffer和header列表都有了足够的容量
+  buf.append(kRequest, len);
+  context.parseRequest(&buf, Timestamp::now());
+  buf.retrieveAll();
+  context.reset();
+
+  int64_t allocations = g_allocations;
+  Timestamp start(Timestamp::now());
+  int headers = 0;
+  for (int i = 0; i < requests; ++i)
+  {
+    if (split > 0)
+    {
+      buf.append(kRequest, split);
+      context.parseRequest(&buf, start);
+      buf.append(kRequest + split, len - split);
+    }
+    else
+    {
+      buf.append(kRequest, len);
+    }
+    if (!context.parseRequest(&buf, start) || !context.gotAll())
+    {
+      fprintf(stderr, "parse error\n");
+      abort();
+    }
+    headers += static_cast<int>(context.request().numHeaders());
+    buf.retrieve(context.requestLength());
+    context.reset();
+  }
+  double seconds = timeDifference(Timestamp::now(), start);
+  printf("%-10s %d requests %.3f s, %.0f ns/request, %.2f allocations/request, %d headers\n",
+         split > 0 ? "two-piece" : "one-piece", requests, seconds,
+         seconds * 1e9 / requests,
+         static_cast<double>(g_allocations - allocations) / requests,
+         headers / requests);
+}
+
+int main(int argc, char* argv[])
+{
+  int requests = argc > 1 ? atoi(argv[1]) : 1000*1000;
+  bench(requests, 0);
+  bench(requests, 200);
+}
@@ -12,19 +12,6 @@ using muduo::net::Buffer;
 using muduo::net::HttpContext;
 using muduo::net::HttpRequest;
 
-namespace muduo
-{
-namespace net
-{
-namespace detail
-{
-bool parseRequest(Buffer* buf, HttpContext* context, Timestamp receiveTime);
-}
-}
-}
-
-using muduo::net::detail::parseRequest;
-
 BOOST_AUTO_TEST_CASE(testParseRequestAllInOne)
 {
   HttpContext context;
@@ -33,14 +20,14 @@ BOOST_AUTO_TEST_CASE(testParseRequestAllInOne)
        "Host: www.chenshuo.com\r\n"
        "\r\n");
 
-  BOOST_CHECK(parseRequest(&input, &context, Timestamp::now()));
+  BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
   BOOST_CHECK(context.gotAll());
   const HttpRequest& request = context.request();
   BOOST_CHECK_EQUAL(request.method(), HttpRequest::kGet);
-  BOOST_CHECK_EQUAL(request.path(), string("/index.html"));
+  BOOST_CHECK_EQUAL(request.path().as_string(), string("/index.html"));
   BOOST_CHECK_EQUAL(request.getVersion(), HttpRequest::kHttp11);
-  BOOST_CHECK_EQUAL(request.getHeader("Host"), string("www.chenshuo.com"));
-  BOOST_CHECK_EQUAL(request.getHeader("User-Agent"), string(""));
+  BOOST_CHECK_EQUAL(request.getHeader("Host").as_string(), string("www.chenshuo.com"));
+  BOOST_CHECK_EQUAL(request.getHeader("User-Agent").as_string(), string(""));
 }
 
 BOOST_AUTO_TEST_CASE(testParseRequestInTwoPieces)
@@ -54,19 +41,19 @@ BOOST_AUTO_TEST_CASE(testParseRequestInTwoPieces)
     HttpContext context;
     Buffer input;
     input.append(all.c_str(), sz1);
-    BOOST_CHECK(parseRequest(&input, &context, Timestamp::now()));
+    BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
     BOOST_CHECK(!context.gotAll());
 
     size_t sz2 = all.size() - sz1;
     input.append(all.c_str() + sz1, sz2);
-    BOOST_CHECK(parseRequest(&input, &context, Timestamp::now()));
+    BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
     BOOST_CHECK(context.gotAll());
     const HttpRequest& request = context.request();
     BOOST_CHECK_EQUAL(request.method(), HttpRequest::kGet);
-    BOOST_CHECK_EQUAL(request.path(), string("/index.html"));
+    BOOST_CHECK_EQUAL(request.path().as_string(), string("/index.html"));
     BOOST_CHECK_EQUAL(request.getVersion(), HttpRequest::kHttp11);
-    BOOST_CHECK_EQUAL(request.getHeader("Host"), string("www.chenshuo.com"));
-    BOOST_CHECK_EQUAL(request.getHeader("User-Agent"), string(""));
+    BOOST_CHECK_EQUAL(request.getHeader("Host").as_string(), string("www.chenshuo.com"));
+    BOOST_CHECK_EQUAL(request.getHeader("User-Agent").as_string(), string(""));
   }
 }
 
@@ -80,13 +67,415 @@ BOOST_AUTO_TEST_CASE(testParseRequestEmptyHeaderValue)
        "Accept-Encoding: \r\n"
        "\r\n");
 
-  BOOST_CHECK(parseRequest(&input, &context, Timestamp::now()));
+  BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
   BOOST_CHECK(context.gotAll());
   const HttpRequest& request = context.request();
   BOOST_CHECK_EQUAL(request.method(), HttpRequest::kGet);
-  BOOST_CHECK_EQUAL(request.path(), string("/index.html"));
+  BOOST_CHECK_EQUAL(request.path().as_string(), string("/index.html"));
   BOOST_CHECK_EQUAL(request.getVersion(), HttpRequest::kHttp11);
-  BOOST_CHECK_EQUAL(request.getHeader("Host"), string("www.chenshuo.com"));
-  BOOST_CHECK_EQUAL(request.getHeader("User-Agent"), string(""));
-  BOOST_CHECK_EQUAL(request.getHeader("Accept-Encoding"), string(""));
+  BOOST_CHECK_EQUAL(request.getHeader("Host").as_string(), string("www.chenshuo.com"));
+  BOOST_CHECK_EQUAL(request.getHeader("User-Agent").as_string(), string(""));
+  BOOST_CHECK_EQUAL(request.getHeader("Accept-Encoding").as_string(), string(""));
+}
+
+BOOST_AUTO_TEST_CASE(testParseRequestKeepsBuffer)
+{
+  HttpContext context;
+  Buffer input;
+  const string all("GET /index.html HTTP/1.1\r\n"
+       "Host: www.chenshuo.com\r\n"
+       "\r\n");
+  input.append(all);
+  input.append("GET /next");
+
+  BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+  BOOST_CHECK(context.gotAll());
+  BOOST_CHECK_EQUAL(context.requestLength(), all.size());
+  BOOST_CHECK_EQUAL(input.readableBytes(), all.size() + 9);
+  // 请求直接指向buf中的数据
+  const HttpRequest& request = context.request();
+  BOOST_CHECK(request.path().data() == input.peek() + 4);
+
+  input.retrieve(context.requestLength());
+  context.reset();
+  BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+  BOOST_CHECK(!context.gotAll());
+}
+
+BOOST_AUTO_TEST_CASE(testParseRequestHeaderLookup)
+{
+  HttpContext context;
+  Buffer input;
+  input.append("POST /upload HTTP/1.0\r\n"
+       "Host: www.chenshuo.com\r\n"
+       "content-length:  42 \r\n"
+       "X-Dup: 1\r\n"
+       "X-Dup: 2\r\n"
+       "\r\n");
+  input.append(string(42, 'x'));
+
+  BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+  BOOST_CHECK(context.gotAll());
+  const HttpRequest& request = context.request();
+  BOOST_CHECK_EQUAL(request.method(), HttpRequest::kPost);
+  BOOST_CHECK_EQUAL(request.getVersion(), HttpRequest::kHttp10);
+  BOOST_CHECK_EQUAL(request.getHeader("Content-Length").as_string(), string("42"));
+  BOOST_CHECK_EQUAL(request.getHeader("CONTENT-LENGTH").as_string(), string("42"));
+  BOOST_CHECK_EQUAL(request.getHeader("Content-Len").as_string(), string(""));
+  BOOST_CHECK_EQUAL(request.getHeader("X-Dup").as_string(), string("1"));
+  BOOST_REQUIRE_EQUAL(request.numHeaders(), 4);
+  BOOST_CHECK_EQUAL(request.headerField(1).as_string(), string("content-length"));
+  BOOST_CHECK_EQUAL(request.headerValue(3).as_string(), string("2"));
+  BOOST_CHECK_EQUAL(request.body().as_string(), string(42, 'x'));
+}
+
+BOOST_AUTO_TEST_CASE(testParseRequestByteByByte)
+{
+  const string all("GET /a/b?c=d HTTP/1.1\r\n"
+       "Host: www.chenshuo.com\r\n"
+       "User-Agent: muduo\r\n"
+       "\r\n");
+
+  HttpContext context;
+  Buffer input;
+  for (size_t i = 0; i < all.size(); ++i)
+  {
+    BOOST_CHECK(!context.gotAll());
+    input.append(all.c_str() + i, 1);
+    BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+  }
+  BOOST_CHECK(context.gotAll());
+  const HttpRequest& request = context.request();
+  BOOST_CHECK_EQUAL(request.path().as_string(), string("/a/b?c=d"));
+  BOOST_CHECK_EQUAL(request.getHeader("User-Agent").as_string(), string("muduo"));
+}
+
+BOOST_AUTO_TEST_CASE(testParseRequestBad)
+{
+  HttpContext context;
+  Buffer input;
+  input.append("FETCH /index.html HTTP/1.1\r\n\r\n");
+  BOOST_CHECK(!context.parseRequest(&input, Timestamp::now()));
+}
+
+BOOST_AUTO_TEST_CASE(testParseRequestBareLF)
+{
+  // 行中间的\n不能留在path或者header的值里
+  HttpContext context;
+  Buffer input;
+  input.append("GET /a\nb HTTP/1.1\r\n\r\n");
+  BOOST_CHECK(!context.parseRequest(&input, Timestamp::now()));
+  BOOST_CHECK_EQUAL(context.errorStatus(), 400);
+
+  HttpContext context2;
+  Buffer input2;
+  input2.append("GET /a HTTP/1.1\r\nAccept-Language: en\nX: y\r\n\r\n");
+  BOOST_CHECK(!context2.parseRequest(&input2, Timestamp::now()));
+  BOOST_CHECK_EQUAL(context2.errorStatus(), 400);
+}
+
+BOOST_AUTO_TEST_CASE(testParseRequestContentLength)
+{
+  const string head("POST /form HTTP/1.1\r\n"
+       "Content-Length: 11\r\n"
+       "\r\n");
+  const string next("GET / HTTP/1.1\r\n\r\n");
+  const string all(head + "hello world");
+
+  // 每次多给一个字节
+  HttpContext context;
+  Buffer input;
+  for (size_t i = 0; i < all.size(); ++i)
+  {
+    BOOST_CHECK(!context.gotAll());
+    input.append(all.c_str() + i, 1);
+    BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+    BOOST_CHECK(!context.hasBodyPiece());
+  }
+  input.append(next);
+  BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+  BOOST_CHECK(context.gotAll());
+  BOOST_CHECK_EQUAL(context.requestLength(), head.size() + 11);
+  BOOST_CHECK_EQUAL(context.request().body().as_string(), string("hello world"));
+  BOOST_CHECK(!context.request().bodyStreamed());
+  BOOST_CHECK(context.request().body().data() == input.peek() + head.size());
+
+  input.retrieve(context.requestLength());
+  context.reset();
+  BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+  BOOST_CHECK(context.gotAll());
+  BOOST_CHECK_EQUAL(context.request().body().size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(testParseRequestChunked)
+{
+  const string all("PUT /file HTTP/1.1\r\n"
+       "Transfer-Encoding: chunked\r\n"
+       "Content-Length: 3\r\n"
+       "\r\n"
+       "5\r\nhello\r\n"
+       "1;name=value\r\n \r\n"
+       "A\r\n0123456789\r\n"
+       "0\r\n"
+       "X-Trailer: ignored\r\n"
+       "\r\n");
+
+  for (size_t sz1 = 0; sz1 < all.size(); ++sz1)
+  {
+    HttpContext context;
+    Buffer input;
+    input.append(all.c_str(), sz1);
+    BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+    BOOST_CHECK(!context.gotAll());
+
+    size_t sz2 = all.size() - sz1;
+    input.append(all.c_str() + sz1, sz2);
+    BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+    BOOST_CHECK(context.gotAll());
+    // chunk头和trailer已经从Buffer里去掉了
+    BOOST_CHECK_EQUAL(context.requestLength(), input.readableBytes());
+    BOOST_CHECK_LT(context.requestLength(), all.size());
+    // 在Buffer里原地解码
+    BOOST_CHECK_EQUAL(context.request().body().as_string(), string("hello 0123456789"));
+    BOOST_CHECK_EQUAL(context.request().getHeader("Host").as_string(), string(""));
+  }
+
+  HttpContext context;
+  Buffer input;
+  input.append("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n5x\r\n");
+  BOOST_CHECK(!context.parseRequest(&input, Timestamp::now()));
+  BOOST_CHECK_EQUAL(context.errorStatus(), 400);
+}
+
+BOOST_AUTO_TEST_CASE(testParseRequestStreaming)
+{
+  const string head("POST /upload HTTP/1.1\r\n"
+       "Transfer-Encoding: chunked\r\n"
+       "\r\n");
+  string body;
+  for (int i = 0; i < 100; ++i)
+  {
+    body += static_cast<char>('a' + i % 26);
+  }
+
+  HttpContext context;
+  context.setStreamThreshold(16);
+  Buffer input;
+  input.append(head);
+  string received;
+  // 每次收到一个10字节的chunk
+  for (size_t i = 0; i < body.size(); i += 10)
+  {
+    input.append("a\r\n");
+    input.append(body.substr(i, 10));
+    input.append("\r\n");
+    BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+    if (context.hasBodyPiece())
+    {
+      received += context.bodyPiece(&input).as_string();
+      context.discardBodyPiece(&input);
+      // 只留下请求行和报头
+      BOOST_CHECK_EQUAL(input.readableBytes(), head.size());
+    }
+    BOOST_CHECK_EQUAL(context.request().getHeader("Transfer-Encoding").as_string(),
+                      string("chunked"));
+  }
+  BOOST_CHECK_EQUAL(received, body);
+  input.append("0\r\n\r\n");
+  BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+  BOOST_CHECK(context.gotAll());
+  BOOST_CHECK(!context.hasBodyPiece());
+  BOOST_CHECK(context.request().bodyStreamed());
+  BOOST_CHECK_EQUAL(context.request().body().size(), 0);
+  BOOST_CHECK_EQUAL(context.requestLength(), input.readableBytes());
+
+  // Content-Length超过阈值时从第一个字节就开始流式交付
+  HttpContext context2;
+  context2.setStreamThreshold(16);
+  Buffer input2;
+  input2.append("POST /upload HTTP/1.1\r\nContent-Length: 100\r\n\r\nabc");
+  BOOST_CHECK(context2.parseRequest(&input2, Timestamp::now()));
+  BOOST_CHECK(context2.hasBodyPiece());
+  BOOST_CHECK_EQUAL(context2.bodyPiece(&input2).as_string(), string("abc"));
+}
+
+BOOST_AUTO_TEST_CASE(testParseRequestLimits)
+{
+  HttpContext context;
+  context.setMaxHeaderSize(64);
+  Buffer input;
+  input.append("GET / HTTP/1.1\r\n");
+  input.append("Cookie: " + string(60, 'c'));
+  BOOST_CHECK(!context.parseRequest(&input, Timestamp::now()));
+  BOOST_CHECK_EQUAL(context.errorStatus(), 431);
+
+  HttpContext context2;
+  context2.setMaxBodySize(10);
+  Buffer input2;
+  input2.append("POST / HTTP/1.1\r\nContent-Length: 11\r\n\r\n");
+  BOOST_CHECK(!context2.parseRequest(&input2, Timestamp::now()));
+  BOOST_CHECK_EQUAL(context2.errorStatus(), 413);
+
+  HttpContext context3;
+  context3.setMaxBodySize(10);
+  Buffer input3;
+  input3.append("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+                "6\r\nabcdef\r\n5\r\n");
+  BOOST_CHECK(!context3.parseRequest(&input3, Timestamp::now()));
+  BOOST_CHECK_EQUAL(context3.errorStatus(), 413);
+}
+
+// 很多很小的chunk，Buffer里只留下请求行、报头、body和没解析完的部分
+BOOST_AUTO_TEST_CASE(testParseRequestTinyChunks)
+{
+  const string head("POST /upload HTTP/1.1\r\n"
+       "Transfer-Encoding: chunked\r\n"
+       "\r\n");
+  const string chunk("1;ext=" + string(20, 'e') + "\r\nx\r\n");
+
+  HttpContext context;
+  Buffer input;
+  input.append(head);
+  for (int i = 0; i < 2000; ++i)
+  {
+    // 每个chunk分两次收到，第二次之前长度行已经解析过了
+    input.append(chunk.data(), 10);
+    BOOST_REQUIRE(context.parseRequest(&input, Timestamp::now()));
+    input.append(chunk.data() + 10, chunk.size() - 10);
+    BOOST_REQUIRE(context.parseRequest(&input, Timestamp::now()));
+    BOOST_CHECK_EQUAL(input.readableBytes(), head.size() + i + 1);
+  }
+  input.append("0\r\nX-Trailer: ignored\r\n\r\n");
+  BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+  BOOST_CHECK(context.gotAll());
+  BOOST_CHECK_EQUAL(context.request().body().as_string(), string(2000, 'x'));
+  BOOST_CHECK_EQUAL(input.readableBytes(), head.size() + 2000);
+  BOOST_CHECK_EQUAL(context.requestLength(), input.readableBytes());
+
+  // chunk头加trailer比body多出maxHeaderSize以上
+  HttpContext context2;
+  context2.setMaxHeaderSize(4096);
+  Buffer input2;
+  input2.append(head);
+  const string longChunk("1;ext=" + string(1000, 'e') + "\r\nx\r\n");
+  int chunks = 0;
+  bool ok = true;
+  while (ok && chunks < 100)
+  {
+    input2.append(longChunk);
+    ok = context2.parseRequest(&input2, Timestamp::now());
+    ++chunks;
+    BOOST_CHECK_LT(input2.readableBytes(), head.size() + chunks + longChunk.size());
+  }
+  BOOST_CHECK(!ok);
+  BOOST_CHECK_EQUAL(context2.errorStatus(), 400);
+  BOOST_CHECK_EQUAL(chunks, 5);
+
+  HttpContext context3;
+  context3.setMaxHeaderSize(4096);
+  Buffer input3;
+  input3.append(head);
+  input3.append("1\r\nx\r\n0\r\n");
+  for (int i = 0; i < 10; ++i)
+  {
+    input3.append("X-Trailer: " + string(1000, 't') + "\r\n");
+  }
+  BOOST_CHECK(!context3.parseRequest(&input3, Timestamp::now()));
+  BOOST_CHECK_EQUAL(context3.errorStatus(), 400);
+}
+
+BOOST_AUTO_TEST_CASE(testResponseOrder)
+{
+  HttpContext context;
+  Buffer output;
+  const int64_t first = context.startResponse();
+  const int64_t second = context.startResponse();
+  const int64_t third = context.startResponse();
+  const int64_t fourth = context.startResponse();
+
+  // 后面的先完成，要等前面的
+  Buffer response;
+  response.append("3");
+  BOOST_CHECK(!context.finishResponse(third, &response, false, &output));
+  response.append("2");
+  BOOST_CHECK(!context.finishResponse(second, &response, false, &output));
+  BOOST_CHECK_EQUAL(output.readableBytes(), 0);
+
+  BOOST_CHECK(context.isNextResponse(first));
+  output.append("1");
+  BOOST_CHECK(!context.finishResponse(first, NULL, false, &output));
+  BOOST_CHECK_EQUAL(output.retrieveAllAsString(), string("123"));
+  BOOST_CHECK(context.isNextResponse(fourth));
+
+  // 关闭连接的应答之后的都丢掉
+  const int64_t fifth = context.startResponse();
+  response.append("5");
+  BOOST_CHECK(!context.finishResponse(fifth, &response, false, &output));
+  response.append("4");
+  BOOST_CHECK(context.finishResponse(fourth, &response, true, &output));
+  BOOST_CHECK(context.closing());
+  BOOST_CHECK_EQUAL(output.retrieveAllAsString(), string("4"));
+}
+
+BOOST_AUTO_TEST_CASE(testResponseOrderStream)
+{
+  HttpContext context;
+  Buffer output;
+  const int64_t first = context.startResponse();
+  const int64_t second = context.startResponse();
+  const int64_t third = context.startResponse();
+  muduo::net::HttpStreamPtr stream(new muduo::net::HttpStream(
+      muduo::net::TcpConnectionPtr(), true,
+      muduo::net::HttpStream::ProduceCallback(), muduo::net::HttpStream::FinishCallback()));
+
+  // 第一个应答的实体是流式的，后面的都要等它结束
+  output.append("1");
+  BOOST_CHECK(!context.finishResponse(first, NULL, false, &output, stream));
+  BOOST_CHECK(context.startStream() == stream);
+  BOOST_CHECK(!context.startStream());
+  Buffer response;
+  response.append("3");
+  BOOST_CHECK(!context.finishResponse(third, &response, true, &output));
+  response.append("2");
+  BOOST_CHECK(!context.finishResponse(second, &response, false, &output));
+  BOOST_CHECK_EQUAL(output.retrieveAllAsString(), string("1"));
+
+  BOOST_CHECK(context.finishStream(&output));
+  BOOST_CHECK(!context.activeStream());
+  BOOST_CHECK_EQUAL(output.retrieveAllAsString(), string("23"));
+}
+
+BOOST_AUTO_TEST_CASE(testResponseOrderBody)
+{
+  HttpContext context;
+  Buffer output;
+  const int64_t first = context.startResponse();
+  const int64_t second = context.startResponse();
+  const int64_t third = context.startResponse();
+
+  // 排队的应答带着文件实体，不拷贝，轮到它时交出来
+  HttpContext::Body body;
+  body.fd = 42;
+  body.offset = 100;
+  body.length = 1000;
+  Buffer response;
+  response.append("2");
+  BOOST_CHECK(!context.finishResponse(second, &response, false, &output,
+                                      muduo::net::HttpStreamPtr(), &body));
+  response.append("3");
+  BOOST_CHECK(!context.finishResponse(third, &response, true, &output));
+  HttpContext::Body taken;
+  BOOST_CHECK(!context.takeBody(&taken));
+
+  output.append("1");
+  BOOST_CHECK(!context.finishResponse(first, NULL, false, &output));
+  BOOST_CHECK_EQUAL(output.retrieveAllAsString(), string("12"));
+  BOOST_CHECK(context.takeBody(&taken));
+  BOOST_CHECK_EQUAL(taken.fd, 42);
+  BOOST_CHECK_EQUAL(taken.offset, 100);
+  BOOST_CHECK_EQUAL(taken.length, 1000u);
+  BOOST_CHECK(!context.takeBody(&taken));
+
+  BOOST_CHECK(context.finishBody(&output));
+  BOOST_CHECK_EQUAL(output.retrieveAllAsString(), string("3"));
 }
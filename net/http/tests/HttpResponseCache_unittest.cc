@@ -0,0 +1,372 @@
+#include <muduo/net/http/HttpResponseCache.h>
+#include <muduo/net/http/HttpContext.h>
+#include <muduo/net/http/HttpResponder.h>
+#include <muduo/net/http/HttpResponse.h>
+#include <muduo/net/Buffer.h>
+#include <muduo/base/Atomic.h>
+#include <muduo/base/CountDownLatch.h>
+#include <muduo/base/Thread.h>
+
+//#define BOOST_TEST_MODULE HttpResponseCacheTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <boost/bind.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+
+#include <stdexcept>
+#include <stdio.h>
+#include <unistd.h>
+
+using muduo::AtomicInt32;
+using muduo::CountDownLatch;
+using muduo::MutexLock;
+using muduo::MutexLockGuard;
+using muduo::StringPiece;
+using muduo::string;
+using muduo::Thread;
+using muduo::Timestamp;
+using muduo::net::Buffer;
+using muduo::net::HttpContext;
+using muduo::net::HttpRequest;
+using muduo::net::HttpResponder;
+using muduo::net::HttpResponderPtr;
+using muduo::net::HttpResponse;
+using muduo::net::HttpResponseCache;
+using muduo::net::TcpConnectionPtr;
+
+namespace
+{
+
+AtomicInt32 g_calls;
+int g_sleepMs = 0;
+
+// 实体里带上调用次数，看得出是不是缓存的
+void handler(const HttpRequest& req, HttpResponse* resp)
+{
+  int calls = g_calls.incrementAndGet();
+  if (g_sleepMs > 0)
+  {
+    ::usleep(g_sleepMs * 1000);
+  }
+  char buf[32];
+  snprintf(buf, sizeof buf, "call %d", calls);
+  resp->setStatusCode(HttpResponse::k200Ok);
+  resp->setContentType("text/plain");
+  if (req.path() == "/nostore")
+  {
+    resp->addHeader("Cache-Control", "no-store");
+  }
+  else if (req.path() == "/missing")
+  {
+    resp->setStatusCode(HttpResponse::k404NotFound);
+  }
+  else if (req.path() == "/throw")
+  {
+    throw std::runtime_error("handler failed");
+  }
+  else if (req.path().starts_with("/big"))
+  {
+    resp->setBody(string(1000, 'x'));
+    return;
+  }
+  resp->setBody(buf);
+}
+
+string serve(HttpResponseCache* cache, const HttpRequest& req)
+{
+  HttpResponse response(false);
+  cache->onRequest(req, &response);
+  Buffer output;
+  response.appendToBuffer(&output);
+  return output.retrieveAllAsString();
+}
+
+string serve(HttpResponseCache* cache, const string& request)
+{
+  HttpContext context;
+  Buffer input;
+  input.append(request);
+  BOOST_REQUIRE(context.parseRequest(&input, Timestamp::now()));
+  return serve(cache, context.request());
+}
+
+string body(const string& response)
+{
+  return response.substr(response.find("\r\n\r\n") + 4);
+}
+
+string get(HttpResponseCache* cache, const string& path)
+{
+  return body(serve(cache, "GET " + path + " HTTP/1.1\r\nAccept-Language: en\r\n\r\n"));
+}
+
+// 不经过解析器，GET /a，X和Y两个header的值里可以有任何字节
+string getWithHeaders(HttpResponseCache* cache, const string& x, const string& y)
+{
+  const string text = "GET/aX:" + x + "Y:" + y;
+  const char* p = text.data();
+  HttpRequest req;
+  req.setBase(p);
+  req.setMethod(p, p + 3);
+  req.setPath(p + 3, p + 5);
+  const char* fieldX = p + 5;
+  const char* fieldY = fieldX + 2 + x.size();
+  req.addHeader(fieldX, fieldX + 1, fieldY);
+  req.addHeader(fieldY, fieldY + 1, fieldY + 2 + y.size());
+  return body(serve(cache, req));
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(testHit)
+{
+  g_calls.getAndSet(0);
+  HttpResponseCache cache(handler);
+  string first = serve(&cache, "GET /a HTTP/1.1\r\n\r\n");
+  string second = serve(&cache, "GET /a HTTP/1.1\r\n\r\n");
+  BOOST_CHECK_EQUAL(first, second);
+  BOOST_CHECK_EQUAL(body(first), string("call 1"));
+  BOOST_CHECK(second.find("\r\nContent-Type: text/plain\r\n") != string::npos);
+  BOOST_CHECK(second.find("\r\nContent-Length: 6\r\n") != string::npos);
+
+  // HEAD查GET的应答，查询串和其他方法不一样
+  BOOST_CHECK_EQUAL(body(serve(&cache, "HEAD /a HTTP/1.1\r\n\r\n")), string("call 1"));
+  BOOST_CHECK_EQUAL(get(&cache, "/a?x=1"), string("call 2"));
+  BOOST_CHECK_EQUAL(body(serve(&cache, "POST /a HTTP/1.1\r\n\r\n")), string("call 3"));
+  BOOST_CHECK_EQUAL(body(serve(&cache, "POST /a HTTP/1.1\r\n\r\n")), string("call 4"));
+  BOOST_CHECK_EQUAL(get(&cache, "/a"), string("call 1"));
+
+  // HEAD的应答不进缓存
+  BOOST_CHECK_EQUAL(body(serve(&cache, "HEAD /b HTTP/1.1\r\n\r\n")), string("call 5"));
+  BOOST_CHECK_EQUAL(body(serve(&cache, "HEAD /b HTTP/1.1\r\n\r\n")), string("call 6"));
+  BOOST_CHECK_EQUAL(get(&cache, "/b"), string("call 7"));
+  BOOST_CHECK_EQUAL(body(serve(&cache, "HEAD /b HTTP/1.1\r\n\r\n")), string("call 7"));
+}
+
+BOOST_AUTO_TEST_CASE(testKeyHeaders)
+{
+  g_calls.getAndSet(0);
+  HttpResponseCache cache(handler);
+  cache.addKeyHeader("Accept-Language");
+  BOOST_CHECK_EQUAL(get(&cache, "/a"), string("call 1"));
+  BOOST_CHECK_EQUAL(body(serve(&cache, "GET /a HTTP/1.1\r\nAccept-Language: fr\r\n\r\n")),
+                    string("call 2"));
+  BOOST_CHECK_EQUAL(body(serve(&cache, "GET /a HTTP/1.1\r\nAccept-Language: fr\r\n\r\n")),
+                    string("call 2"));
+  BOOST_CHECK_EQUAL(get(&cache, "/a"), string("call 1"));
+}
+
+BOOST_AUTO_TEST_CASE(testKeyParts)
+{
+  g_calls.getAndSet(0);
+  HttpResponseCache cache(handler);
+  cache.addKeyHeader("X");
+  cache.addKeyHeader("Y");
+  // 直接拼接的话这两个请求的key是一样的
+  BOOST_CHECK_EQUAL(getWithHeaders(&cache, "a\nb", "c"), string("call 1"));
+  BOOST_CHECK_EQUAL(getWithHeaders(&cache, "a", "b\nc"), string("call 2"));
+  BOOST_CHECK_EQUAL(getWithHeaders(&cache, "a\nb", "c"), string("call 1"));
+  BOOST_CHECK_EQUAL(getWithHeaders(&cache, "a", "b\nc"), string("call 2"));
+}
+
+BOOST_AUTO_TEST_CASE(testNotCached)
+{
+  g_calls.getAndSet(0);
+  HttpResponseCache cache(handler);
+  get(&cache, "/nostore");
+  get(&cache, "/nostore");
+  get(&cache, "/missing");
+  get(&cache, "/missing");
+  BOOST_CHECK_EQUAL(g_calls.get(), 4);
+}
+
+BOOST_AUTO_TEST_CASE(testExpire)
+{
+  g_calls.getAndSet(0);
+  HttpResponseCache cache(handler);
+  cache.setTimeToLive(0.05);
+  BOOST_CHECK_EQUAL(get(&cache, "/a"), string("call 1"));
+  BOOST_CHECK_EQUAL(get(&cache, "/a"), string("call 1"));
+  ::usleep(100*1000);
+  BOOST_CHECK_EQUAL(get(&cache, "/a"), string("call 2"));
+}
+
+BOOST_AUTO_TEST_CASE(testEvict)
+{
+  g_calls.getAndSet(0);
+  HttpResponseCache cache(handler);
+  cache.setMaxBytes(2100);
+  get(&cache, "/big");
+  get(&cache, "/a");
+  get(&cache, "/big");		// /big最近用过
+  BOOST_CHECK_EQUAL(g_calls.get(), 2);
+  get(&cache, "/big?2");	// 放不下，淘汰/a
+  get(&cache, "/big");
+  BOOST_CHECK_EQUAL(g_calls.get(), 3);
+  BOOST_CHECK_EQUAL(get(&cache, "/a"), string("call 4"));
+
+  cache.setMaxBytes(100);
+  get(&cache, "/big?3");
+  get(&cache, "/big?3");
+  BOOST_CHECK_EQUAL(g_calls.get(), 6);
+}
+
+namespace
+{
+
+// 没有连接的HttpResponder，done()在调用它的线程里把应答写进results
+class Results
+{
+ public:
+  explicit Results(int expected) : latch_(expected) { }
+
+  HttpResponderPtr responder(const string& request)
+  {
+    HttpContext context;
+    Buffer input;
+    input.append(request);
+    BOOST_REQUIRE(context.parseRequest(&input, Timestamp::now()));
+    StringPiece raw(input.peek(), static_cast<int>(context.requestLength()));
+    return HttpResponderPtr(new HttpResponder(TcpConnectionPtr(), 0, context.request(), raw, false,
+                                              boost::bind(&Results::onDone, this, _1)));
+  }
+
+  void wait()
+  { latch_.wait(); }
+
+  std::vector<string> get()
+  {
+    MutexLockGuard lock(mutex_);
+    return responses_;
+  }
+
+ private:
+  void onDone(const HttpResponderPtr& responder)
+  {
+    Buffer output;
+    responder->response()->appendToBuffer(&output);
+    {
+      MutexLockGuard lock(mutex_);
+      responses_.push_back(output.retrieveAllAsString());
+    }
+    latch_.countDown();
+  }
+
+  CountDownLatch latch_;
+  MutexLock mutex_;
+  std::vector<string> responses_;
+};
+
+void concurrentGet(HttpResponseCache* cache, CountDownLatch* latch, string* result)
+{
+  latch->countDown();
+  latch->wait();
+  *result = get(cache, "/slow");
+  // 每个线程有自己的分片，再取一次命中本线程的
+  BOOST_CHECK_EQUAL(get(cache, "/slow"), *result);
+}
+
+void concurrentAsyncGet(HttpResponseCache* cache, CountDownLatch* latch,
+                        Results* results, const string& path)
+{
+  latch->countDown();
+  latch->wait();
+  try
+  {
+    cache->onAsyncRequest(results->responder("GET " + path + " HTTP/1.1\r\n\r\n"));
+  }
+  catch (const std::exception&)
+  {
+  }
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(testConcurrentSync)
+{
+  // 同步调用不等别的线程，各自调用处理函数
+  g_calls.getAndSet(0);
+  g_sleepMs = 200;
+  HttpResponseCache cache(handler);
+  const int kThreads = 4;
+  CountDownLatch latch(kThreads);
+  string results[kThreads];
+  boost::ptr_vector<Thread> threads;
+  for (int i = 0; i < kThreads; ++i)
+  {
+    threads.push_back(new Thread(boost::bind(concurrentGet, &cache, &latch, &results[i])));
+    threads.back().start();
+  }
+  for (int i = 0; i < kThreads; ++i)
+  {
+    threads[i].join();
+    BOOST_CHECK(results[i].find("call ") == 0);
+  }
+  BOOST_CHECK_EQUAL(g_calls.get(), kThreads);
+  g_sleepMs = 0;
+}
+
+BOOST_AUTO_TEST_CASE(testCoalesce)
+{
+  g_calls.getAndSet(0);
+  g_sleepMs = 200;
+  HttpResponseCache cache(handler);
+  const int kThreads = 4;
+  CountDownLatch latch(kThreads);
+  Results results(kThreads);
+  boost::ptr_vector<Thread> threads;
+  for (int i = 0; i < kThreads; ++i)
+  {
+    threads.push_back(new Thread(boost::bind(concurrentAsyncGet, &cache, &latch, &results,
+                                             string("/slow"))));
+    threads.back().start();
+  }
+  results.wait();
+  for (int i = 0; i < kThreads; ++i)
+  {
+    threads[i].join();
+  }
+  std::vector<string> responses = results.get();
+  BOOST_REQUIRE_EQUAL(responses.size(), static_cast<size_t>(kThreads));
+  for (int i = 0; i < kThreads; ++i)
+  {
+    BOOST_CHECK_EQUAL(body(responses[i]), string("call 1"));
+  }
+  BOOST_CHECK_EQUAL(g_calls.get(), 1);
+  g_sleepMs = 0;
+}
+
+BOOST_AUTO_TEST_CASE(testHandlerThrows)
+{
+  // 处理函数抛异常时，挂起的请求得到500，key也不会一直占着
+  g_calls.getAndSet(0);
+  g_sleepMs = 200;
+  HttpResponseCache cache(handler);
+  const int kThreads = 3;
+  CountDownLatch latch(kThreads);
+  Results results(kThreads - 1);
+  boost::ptr_vector<Thread> threads;
+  for (int i = 0; i < kThreads; ++i)
+  {
+    threads.push_back(new Thread(boost::bind(concurrentAsyncGet, &cache, &latch, &results,
+                                             string("/throw"))));
+    threads.back().start();
+  }
+  for (int i = 0; i < kThreads; ++i)
+  {
+    threads[i].join();
+  }
+  results.wait();
+  BOOST_CHECK_EQUAL(g_calls.get(), 1);
+  std::vector<string> responses = results.get();
+  for (size_t i = 0; i < responses.size(); ++i)
+  {
+    BOOST_CHECK(responses[i].find("HTTP/1.1 500 ") == 0);
+  }
+
+  g_sleepMs = 0;
+  BOOST_CHECK_THROW(get(&cache, "/throw"), std::runtime_error);
+  BOOST_CHECK_EQUAL(g_calls.get(), 2);
+}
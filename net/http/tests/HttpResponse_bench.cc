@@ -0,0 +1,75 @@
+// Serialization speed and heap allocations of HttpResponse.
+//
+// usage: httpresponse_bench [responses]
+//
+// Serializes a typical small response over and over, either prebuilt or
+// built for each request as a handler would, and counts operator new
+// calls per response.
+
+#include <muduo/net/http/HttpResponse.h>
+#include <muduo/net/Buffer.h>
+#include <muduo/base/Timestamp.h>
+#include "AllocationCounter.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const string kBody("<html><head><title>This is title</title></head>"
+                   "<body><h1>Hello</h1>Now is 20101018 17:00:00.000000</body></html>");
+
+void fill(HttpResponse* resp)
+{
+  resp->setStatusCode(HttpResponse::k200Ok);
+  resp->setStatusMessage("OK");
+  resp->setContentType("text/html");
+  resp->addHeader("Server", "Muduo");
+  resp->addHeader("Cache-Control", "no-cache");
+  resp->setBody(kBody);
+}
+
+// prebuilt为true时只测序列化，否则每次都构造应答
+void bench(int responses, bool prebuilt)
+{
+  HttpResponse prototype(false);
+  fill(&prototype);
+  Buffer buf;
+  // 预热，让Buffer有了足够的容量
+  prototype.appendToBuffer(&buf);
+  const size_t length = buf.readableBytes();
+  buf.retrieveAll();
+
+  int64_t allocations = g_allocations;
+  Timestamp start(Timestamp::now());
+  for (int i = 0; i < responses; ++i)
+  {
+    if (prebuilt)
+    {
+      prototype.appendToBuffer(&buf);
+    }
+    else
+    {
+      HttpResponse response(false);
+      fill(&response);
+      response.appendToBuffer(&buf);
+    }
+    buf.retrieveAll();
+  }
+  double seconds = timeDifference(Timestamp::now(), start);
+  printf("%-10s %d responses %.3f s, %.0f ns/response, %.1f MiB/s, %.2f allocations/response\n",
+         prebuilt ? "serialize" : "build", responses, seconds,
+         seconds * 1e9 / responses,
+         static_cast<double>(length) * responses / seconds / 1024 / 1024,
+         static_cast<double>(g_allocations - allocations) / responses);
+}
+
+int main(int argc, char* argv[])
+{
+  int responses = argc > 1 ? atoi(argv[1]) : 1000*1000;
+  HttpResponse::updateDate(::time(NULL));
+  bench(responses, true);
+  bench(responses, false);
+}
@@ -0,0 +1,167 @@
+// Lookup speed and heap allocations of HttpRouter with many routes.
+//
+// usage: httprouter_bench [services] [lookups]
+//
+// Registers 10 routes for each service, static, with parameters and with
+// a wildcard, then looks up paths spread over all of them.  For
+// comparison, the static paths are also looked up the way Inspector did,
+// splitting the path and searching nested maps.
+
+#include <muduo/net/http/HttpRouter.h>
+#include <muduo/base/Timestamp.h>
+#include "AllocationCounter.h"
+
+#include <map>
+#include <vector>
+#include <boost/bind.hpp>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+int g_calls = 0;
+
+void handler(const HttpRequest&, const HttpRouter::Params& params, HttpResponse*)
+{
+  g_calls += params.size();
+}
+
+const char* const kResources[] = { "users", "orders", "items", "stats", "config" };
+
+void addRoutes(HttpRouter* router, int services)
+{
+  char pattern[128];
+  for (int i = 0; i < services; ++i)
+  {
+    for (int j = 0; j < 5; ++j)
+    {
+      snprintf(pattern, sizeof pattern, "/api/v1/svc%d/%s", i, kResources[j]);
+      router->add(HttpRequest::kGet, pattern, handler);
+      snprintf(pattern, sizeof pattern, "/api/v1/svc%d/%s/:id", i, kResources[j]);
+      router->add(HttpRequest::kGet, pattern, handler);
+    }
+    snprintf(pattern, sizeof pattern, "/api/v1/svc%d/users/:id/orders/:order", i);
+    router->add(HttpRequest::kPut, pattern, handler);
+    snprintf(pattern, sizeof pattern, "/static/svc%d/*file", i);
+    router->add(HttpRequest::kGet, pattern, handler);
+  }
+}
+
+std::vector<string> makePaths(int services, bool withParams)
+{
+  std::vector<string> paths;
+  char path[128];
+  for (int n = 0; n < 1000; ++n)
+  {
+    int i = static_cast<int>(static_cast<unsigned>(n) * 2654435761u % static_cast<unsigned>(services));
+    const char* resource = kResources[n % 5];
+    if (!withParams)
+      snprintf(path, sizeof path, "/api/v1/svc%d/%s", i, resource);
+    else if (n % 3 == 0)
+      snprintf(path, sizeof path, "/api/v1/svc%d/%s/%d", i, resource, n);
+    else if (n % 3 == 1)
+      snprintf(path, sizeof path, "/static/svc%d/css/site%d.css", i, n);
+    else
+      snprintf(path, sizeof path, "/api/v1/svc%d/nothing/%d", i, n);
+    paths.push_back(path);
+  }
+  return paths;
+}
+
+void report(const char* name, int lookups, Timestamp start, int64_t allocations)
+{
+  double seconds = timeDifference(Timestamp::now(), start);
+  printf("%-10s %d lookups %.3f s, %.0f ns/lookup, %.2f allocations/lookup\n",
+         name, lookups, seconds, seconds * 1e9 / lookups,
+         static_cast<double>(g_allocations - allocations) / lookups);
+}
+
+void benchRouter(const HttpRouter& router, const std::vector<string>& paths,
+                 const char* name, int lookups)
+{
+  HttpRequest req;
+  int found = 0;
+  int64_t allocations = g_allocations;
+  Timestamp start(Timestamp::now());
+  for (int i = 0; i < lookups; ++i)
+  {
+    const string& path = paths[i % paths.size()];
+    HttpRouter::Params params;
+    const HttpRouter::Handler* h = router.find(HttpRequest::kGet, path, &params);
+    if (h)
+    {
+      (*h)(req, params, NULL);
+      ++found;
+    }
+  }
+  report(name, lookups, start, allocations);
+  printf("           %d found\n", found);
+}
+
+// Inspector原来的做法：按'/'切开，在嵌套的map里找
+std::vector<string> split(const string& str)
+{
+  std::vector<string> result;
+  size_t start = 0;
+  size_t pos = str.find('/');
+  while (pos != string::npos)
+  {
+    if (pos > start)
+    {
+      result.push_back(str.substr(start, pos-start));
+    }
+    start = pos+1;
+    pos = str.find('/', start);
+  }
+  if (start < str.length())
+  {
+    result.push_back(str.substr(start));
+  }
+  return result;
+}
+
+void benchMaps(int services, const std::vector<string>& paths, int lookups)
+{
+  typedef std::map<string, int> CommandList;
+  std::map<string, CommandList> commands;
+  char module[64];
+  for (int i = 0; i < services; ++i)
+  {
+    snprintf(module, sizeof module, "svc%d", i);
+    for (int j = 0; j < 5; ++j)
+    {
+      commands[module][kResources[j]] = j;
+    }
+  }
+
+  int found = 0;
+  int64_t allocations = g_allocations;
+  Timestamp start(Timestamp::now());
+  for (int i = 0; i < lookups; ++i)
+  {
+    std::vector<string> parts = split(paths[i % paths.size()]);
+    std::map<string, CommandList>::const_iterator it = commands.find(parts[2]);
+    if (it != commands.end() && it->second.find(parts[3]) != it->second.end())
+    {
+      ++found;
+    }
+  }
+  report("split+map", lookups, start, allocations);
+  printf("           %d found\n", found);
+}
+
+int main(int argc, char* argv[])
+{
+  int services = argc > 1 ? atoi(argv[1]) : 500;
+  int lookups = argc > 2 ? atoi(argv[2]) : 1000*1000;
+  HttpRouter router;
+  addRoutes(&router, services);
+  printf("%zd routes\n", router.routes());
+
+  std::vector<string> staticPaths = makePaths(services, false);
+  std::vector<string> mixedPaths = makePaths(services, true);
+  benchRouter(router, staticPaths, "static", lookups);
+  benchRouter(router, mixedPaths, "mixed", lookups);
+  benchMaps(services, staticPaths, lookups);
+}
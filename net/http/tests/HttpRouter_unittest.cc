@@ -0,0 +1,186 @@
+#include <muduo/net/http/HttpRouter.h>
+#include <muduo/net/http/HttpContext.h>
+#include <muduo/net/http/HttpResponse.h>
+#include <muduo/net/Buffer.h>
+
+//#define BOOST_TEST_MODULE HttpRouterTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <boost/bind.hpp>
+
+#include <string.h>
+
+using muduo::string;
+using muduo::StringPiece;
+using muduo::Timestamp;
+using muduo::net::Buffer;
+using muduo::net::HttpContext;
+using muduo::net::HttpRequest;
+using muduo::net::HttpResponse;
+using muduo::net::HttpRouter;
+
+namespace
+{
+
+// 处理函数把自己的名字和参数写到应答实体里
+void handler(const char* name, const HttpRequest&,
+             const HttpRouter::Params& params, HttpResponse* resp)
+{
+  string body(name);
+  for (int i = 0; i < params.size(); ++i)
+  {
+    body += " " + params.name(i).as_string() + "=" + params.value(i).as_string();
+  }
+  resp->setStatusCode(HttpResponse::k200Ok);
+  resp->setBody(body);
+}
+
+HttpRouter::Handler named(const char* name)
+{
+  return boost::bind(handler, name, _1, _2, _3);
+}
+
+// 找到的处理函数的输出，找不到时返回空串
+string lookup(const HttpRouter& router, HttpRequest::Method method, const char* path)
+{
+  HttpRouter::Params params;
+  const HttpRouter::Handler* h = router.find(method, path, &params);
+  if (h == NULL)
+  {
+    return string();
+  }
+  HttpRequest req;
+  HttpResponse resp(false);
+  (*h)(req, params, &resp);
+  Buffer buf;
+  resp.appendToBuffer(&buf);
+  string response = buf.retrieveAllAsString();
+  return response.substr(response.find("\r\n\r\n") + 4);
+}
+
+string get(const HttpRouter& router, const char* path)
+{
+  return lookup(router, HttpRequest::kGet, path);
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(testStatic)
+{
+  HttpRouter router;
+  BOOST_CHECK(router.add(HttpRequest::kGet, "/", named("root")));
+  BOOST_CHECK(router.add(HttpRequest::kGet, "/users", named("users")));
+  BOOST_CHECK(router.add(HttpRequest::kGet, "/user", named("user")));
+  BOOST_CHECK(router.add(HttpRequest::kGet, "/usage", named("usage")));
+  BOOST_CHECK(router.add(HttpRequest::kGet, "/users/", named("users/")));
+  BOOST_CHECK(router.add(HttpRequest::kPost, "/users", named("post")));
+  BOOST_CHECK_EQUAL(router.routes(), 6);
+
+  BOOST_CHECK_EQUAL(get(router, "/"), string("root"));
+  BOOST_CHECK_EQUAL(get(router, "/users"), string("users"));
+  BOOST_CHECK_EQUAL(get(router, "/user"), string("user"));
+  BOOST_CHECK_EQUAL(get(router, "/usage"), string("usage"));
+  BOOST_CHECK_EQUAL(get(router, "/users/"), string("users/"));
+  BOOST_CHECK_EQUAL(lookup(router, HttpRequest::kPost, "/users"), string("post"));
+  BOOST_CHECK_EQUAL(lookup(router, HttpRequest::kHead, "/users"), string("users"));
+  BOOST_CHECK_EQUAL(get(router, "/use"), string());
+  BOOST_CHECK_EQUAL(get(router, "/usersx"), string());
+  BOOST_CHECK_EQUAL(get(router, ""), string());
+  BOOST_CHECK_EQUAL(lookup(router, HttpRequest::kDelete, "/users"), string());
+
+  // 重复添加时替换
+  BOOST_CHECK(router.add(HttpRequest::kGet, "/user", named("user2")));
+  BOOST_CHECK_EQUAL(get(router, "/user"), string("user2"));
+  BOOST_CHECK_EQUAL(router.routes(), 6);
+}
+
+BOOST_AUTO_TEST_CASE(testParams)
+{
+  HttpRouter router;
+  BOOST_CHECK(router.add(HttpRequest::kGet, "/users/:id", named("user")));
+  BOOST_CHECK(router.add(HttpRequest::kGet, "/users/:id/posts/:post", named("post")));
+  BOOST_CHECK(router.add(HttpRequest::kGet, "/users/new", named("new")));
+  BOOST_CHECK(router.add(HttpRequest::kGet, "/files/*path", named("files")));
+  BOOST_CHECK(router.add(HttpRequest::kGet, "/files/index", named("index")));
+  BOOST_CHECK(router.add(HttpRequest::kGet, "/:module/:command", named("command")));
+  BOOST_CHECK(router.add(HttpRequest::kGet, "/:module/:command/*args", named("args")));
+
+  BOOST_CHECK_EQUAL(get(router, "/users/42"), string("user id=42"));
+  BOOST_CHECK_EQUAL(get(router, "/users/new"), string("new"));
+  BOOST_CHECK_EQUAL(get(router, "/users/newer"), string("user id=newer"));
+  BOOST_CHECK_EQUAL(get(router, "/users/42/posts/7"), string("post id=42 post=7"));
+  BOOST_CHECK_EQUAL(get(router, "/files/a/b.txt"), string("files path=a/b.txt"));
+  BOOST_CHECK_EQUAL(get(router, "/files/"), string("files path="));
+  BOOST_CHECK_EQUAL(get(router, "/files/index"), string("index"));
+  BOOST_CHECK_EQUAL(get(router, "/proc/status"), string("command module=proc command=status"));
+  BOOST_CHECK_EQUAL(get(router, "/proc/status/a/b"),
+                    string("args module=proc command=status args=a/b"));
+  // 静态的走不通时退回来试参数
+  BOOST_CHECK_EQUAL(get(router, "/users/42/x"), string("args module=users command=42 args=x"));
+  BOOST_CHECK_EQUAL(get(router, "/users"), string());
+  BOOST_CHECK_EQUAL(get(router, "//x"), string());
+
+  HttpRouter::Params params;
+  router.find(HttpRequest::kGet, "/users/42/posts/7", &params);
+  BOOST_CHECK(params.get("post") == "7");
+  BOOST_CHECK(params.get("none").empty());
+}
+
+BOOST_AUTO_TEST_CASE(testBadPattern)
+{
+  HttpRouter router;
+  BOOST_CHECK(!router.add(HttpRequest::kGet, "", named("x")));
+  BOOST_CHECK(!router.add(HttpRequest::kGet, "users", named("x")));
+  BOOST_CHECK(!router.add(HttpRequest::kGet, "/users/:", named("x")));
+  BOOST_CHECK(!router.add(HttpRequest::kGet, "/users/a:id", named("x")));
+  BOOST_CHECK(!router.add(HttpRequest::kGet, "/files/*path/x", named("x")));
+  BOOST_CHECK(!router.add(HttpRequest::kGet, "/a/:b:c", named("x")));
+  BOOST_CHECK(!router.add(HttpRequest::kGet, "/:a/:b/:c/:d/:e/:f/:g/:h/:i", named("x")));
+  BOOST_CHECK(router.add(HttpRequest::kGet, "/users/:id", named("x")));
+  BOOST_CHECK(!router.add(HttpRequest::kGet, "/users/:name/x", named("x")));
+  BOOST_CHECK_EQUAL(router.routes(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(testRoute)
+{
+  HttpRouter router;
+  router.add(HttpRequest::kGet, "/users/:id", named("get"));
+  router.add(HttpRequest::kPut, "/users/:id", named("put"));
+
+  const char* requests[] = {
+    "GET /users/1?x=/y HTTP/1.1\r\n\r\n",
+    "DELETE /users/1 HTTP/1.1\r\n\r\n",
+    "GET /none HTTP/1.1\r\n\r\n",
+  };
+  string responses[3];
+  for (int i = 0; i < 3; ++i)
+  {
+    HttpContext context;
+    Buffer input;
+    input.append(requests[i], strlen(requests[i]));
+    BOOST_REQUIRE(context.parseRequest(&input, Timestamp::now()));
+    HttpResponse resp(false);
+    router.onRequest(context.request(), &resp);
+    Buffer output;
+    resp.appendToBuffer(&output);
+    responses[i] = output.retrieveAllAsString();
+  }
+  BOOST_CHECK(responses[0].find("HTTP/1.1 200") == 0);
+  BOOST_CHECK(responses[0].find("\r\n\r\nget id=1") != string::npos);
+  BOOST_CHECK(responses[1].find("HTTP/1.1 405") == 0);
+  BOOST_CHECK(responses[1].find("\r\nAllow: GET, HEAD, PUT\r\n") != string::npos);
+  BOOST_CHECK(responses[2].find("HTTP/1.1 404") == 0);
+}
+
+BOOST_AUTO_TEST_CASE(testCopy)
+{
+  HttpRouter router;
+  router.add(HttpRequest::kGet, "/a/:x", named("a"));
+  HttpRouter copy(router);
+  copy.add(HttpRequest::kGet, "/ab", named("ab"));
+  BOOST_CHECK_EQUAL(get(copy, "/a/1"), string("a x=1"));
+  BOOST_CHECK_EQUAL(get(copy, "/ab"), string("ab"));
+  BOOST_CHECK_EQUAL(get(router, "/ab"), string());
+}
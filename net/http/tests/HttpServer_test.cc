@@ -1,30 +1,48 @@
 #include <muduo/net/http/HttpServer.h>
+#include <muduo/net/http/HttpFileServer.h>
 #include <muduo/net/http/HttpRequest.h>
 #include <muduo/net/http/HttpResponse.h>
 #include <muduo/net/EventLoop.h>
 #include <muduo/base/Logging.h>
 
+#include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
+
 #include <iostream>
-#include <map>
+#include <stdio.h>
 
 using namespace muduo;
 using namespace muduo::net;
 
 extern char favicon[555];
 bool benchmark = false;
+PayloadPtr g_favicon;	// 所有连接共享，不拷贝
+boost::scoped_ptr<HttpFileServer> g_files;	// /files/下是当前目录的文件
+
+// 每次可以写的时候写10行，共1000行
+void produceLines(const boost::shared_ptr<int>& line, const HttpStreamPtr& stream)
+{
+  for (int i = 0; i < 10 && *line < 1000 && !stream->paused(); ++i)
+  {
+    char buf[64];
+    snprintf(buf, sizeof buf, "line %d\n", ++*line);
+    stream->write(buf);
+  }
+  if (*line == 1000)
+  {
+    stream->finish();
+  }
+}
 
 // 实际的请求处理
 void onRequest(const HttpRequest& req, HttpResponse* resp)
 {
-  std::cout << "Headers " << req.methodString() << " " << req.path() << std::endl;
+  std::cout << "Headers " << req.methodString() << " " << req.path().as_string() << std::endl;
   if (!benchmark)
   {
-    const std::map<string, string>& headers = req.headers();
-    for (std::map<string, string>::const_iterator it = headers.begin();
-         it != headers.end();
-         ++it)
+    for (size_t i = 0; i < req.numHeaders(); ++i)
     {
-      std::cout << it->first << ": " << it->second << std::endl;
+      std::cout << req.headerField(i).as_string() << ": " << req.headerValue(i).as_string() << std::endl;
     }
   }
 
@@ -44,7 +62,7 @@ void onRequest(const HttpRequest& req, HttpResponse* resp)
     resp->setStatusCode(HttpResponse::k200Ok);
     resp->setStatusMessage("OK");
     resp->setContentType("image/png");
-    resp->setBody(string(favicon, sizeof favicon));
+    resp->setBody(g_favicon);
   }
   else if (req.path() == "/hello")
   {
@@ -54,6 +72,22 @@ void onRequest(const HttpRequest& req, HttpResponse* resp)
     resp->addHeader("Server", "Muduo");
     resp->setBody("hello, world!\n");
   }
+  else if (req.path() == "/stream")
+  {
+    resp->setStatusCode(HttpResponse::k200Ok);
+    resp->setContentType("text/plain");
+    resp->setBodyStream(boost::bind(produceLines, boost::shared_ptr<int>(new int(0)), _1));
+  }
+  else if (g_files->handle(req, resp))
+  {
+  }
+  else if (req.path() == "/echo")
+  {
+    resp->setStatusCode(HttpResponse::k200Ok);
+    resp->setStatusMessage("OK");
+    resp->setContentType("text/plain");
+    resp->setBody(req.bodyStreamed() ? "streamed\n" : req.body().as_string());
+  }
   else
   {
     resp->setStatusCode(HttpResponse::k404NotFound);
@@ -62,19 +96,39 @@ void onRequest(const HttpRequest& req, HttpResponse* resp)
   }
 }
 
+// 大的上传分段到达
+void onBody(const TcpConnectionPtr&, const HttpRequest& req, const StringPiece& piece)
+{
+  if (!benchmark)
+  {
+    std::cout << "Body " << req.path().as_string() << " " << piece.size() << " bytes" << std::endl;
+  }
+}
+
 int main(int argc, char* argv[])
 {
   int numThreads = 0;
+  int numWorkers = 0;
   if (argc > 1)
   {
     benchmark = true;
     Logger::setLogLevel(Logger::WARN);
     numThreads = atoi(argv[1]);
   }
+  if (argc > 2)
+  {
+    numWorkers = atoi(argv[2]);	// 在工作线程中处理请求
+  }
+  g_favicon.reset(new Payload(StringPiece(favicon, sizeof favicon)));
+  g_files.reset(new HttpFileServer(".", "/files/"));
   EventLoop loop;
   HttpServer server(&loop, InetAddress(8000), "dummy");
   server.setHttpCallback(onRequest);
+  server.setBodyCallback(onBody);
+  server.setMaxBodySize(100*1024*1024);
   server.setThreadNum(numThreads);
+  server.setWorkerThreads(numWorkers);
+  server.setMaxRequestsInFlight(1000);
   server.start();
   loop.loop();
 }
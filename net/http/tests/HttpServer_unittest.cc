@@ -0,0 +1,485 @@
+#include <muduo/net/http/HttpServer.h>
+#include <muduo/net/http/HttpRequest.h>
+#include <muduo/net/http/HttpResponse.h>
+#include <muduo/net/http/HttpStream.h>
+#include <muduo/base/ThreadPool.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/Payload.h>
+#include <muduo/net/TcpClient.h>
+
+//#define BOOST_TEST_MODULE HttpServerTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <vector>
+
+using muduo::string;
+using muduo::StringPiece;
+using muduo::Timestamp;
+using muduo::net::Buffer;
+using muduo::net::EventLoop;
+using muduo::net::HttpRequest;
+using muduo::net::HttpResponderPtr;
+using muduo::net::HttpResponse;
+using muduo::net::HttpServer;
+using muduo::net::HttpStreamPtr;
+using muduo::net::InetAddress;
+using muduo::net::Payload;
+using muduo::net::PayloadPtr;
+using muduo::net::TcpClient;
+using muduo::net::TcpConnection;
+using muduo::net::TcpConnectionPtr;
+
+namespace
+{
+
+// 每个应答都有一行Date，长度固定，内容每秒在变
+const size_t kDateLength = sizeof("Date: Thu, 01 Jan 1970 00:00:00 GMT\r\n") - 1;
+
+string get(const string& path)
+{
+  return "GET " + path + " HTTP/1.1\r\n\r\n";
+}
+
+string ok(const string& body)
+{
+  char length[32];
+  snprintf(length, sizeof length, "%zu", body.size());
+  return "HTTP/1.1 200 OK\r\nContent-Length: " + string(length) +
+    "\r\nConnection: Keep-Alive\r\n\r\n" + body;
+}
+
+// 每块一样长，chunk长度行都一样
+const size_t kPieceLength = 16*1024;
+
+string chunkedOk(const string& body)
+{
+  string result("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\nConnection: Keep-Alive\r\n\r\n");
+  char size[32];
+  snprintf(size, sizeof size, "%zx\r\n", kPieceLength);
+  for (size_t pos = 0; pos < body.size(); pos += kPieceLength)
+  {
+    result += size + body.substr(pos, kPieceLength) + "\r\n";
+  }
+  return result + "0\r\n\r\n";
+}
+
+string busy()
+{
+  return "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nConnection: Keep-Alive\r\n\r\n";
+}
+
+// 去掉所有的Date行，剩下的逐字节比较
+string withoutDate(const string& received)
+{
+  string result;
+  size_t pos = 0;
+  size_t date;
+  while ((date = received.find("\r\nDate: ", pos)) != string::npos)
+  {
+    result.append(received, pos, date + 2 - pos);
+    pos = date + kDateLength + 2;
+  }
+  if (pos < received.size())
+  {
+    result.append(received, pos, string::npos);
+  }
+  return result;
+}
+
+// 内容已经unlink的临时文件，给sendfile用
+int tempFile(const string& content)
+{
+  char name[] = "/tmp/httpserver_unittestXXXXXX";
+  int fd = ::mkstemp(name);
+  ::unlink(name);
+  BOOST_REQUIRE(::write(fd, content.data(), content.size()) == static_cast<ssize_t>(content.size()));
+  return fd;
+}
+
+// 客户端一批一批地发流水线请求，收齐一批的应答再发下一批，
+// 最后一批的应答收齐后断开
+struct HttpCheck
+{
+  typedef boost::function<void (EventLoop*, HttpServer*)> SetupFunction;
+
+  HttpCheck()
+    : loop(NULL), batch(0), expectedBytes(0), pauseReading(0.0), disconnected(false)
+  {
+  }
+
+  void addBatch(const string& requests, const string& replies)
+  {
+    batches.push_back(requests);
+    expected += replies;
+    size_t count = 0;
+    for (size_t pos = 0; (pos = requests.find("\r\n\r\n", pos)) != string::npos; pos += 4)
+    {
+      ++count;
+    }
+    batchBytes.push_back(replies.size() + count * kDateLength);
+  }
+
+  void onClientConnection(const TcpConnectionPtr& conn)
+  {
+    if (conn->connected())
+    {
+      if (pauseReading > 0.0)
+      {
+        // 先不读，让服务端的发送缓冲涨过高水位标
+        conn->stopRead();
+        loop->runAfter(pauseReading, boost::bind(&TcpConnection::startRead, conn));
+      }
+      sendBatch(conn);
+    }
+    else
+    {
+      disconnected = true;
+      loop->quit();
+    }
+  }
+
+  void onClientMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+  {
+    received.append(buf->peek(), buf->readableBytes());
+    buf->retrieveAll();
+    if (received.size() >= expectedBytes)
+    {
+      if (batch < batches.size())
+      {
+        sendBatch(conn);
+      }
+      else
+      {
+        conn->forceClose();
+      }
+    }
+  }
+
+  void sendBatch(const TcpConnectionPtr& conn)
+  {
+    expectedBytes += batchBytes[batch];
+    conn->send(batches[batch]);
+    ++batch;
+  }
+
+  void run(uint16_t port, const SetupFunction& setup)
+  {
+    EventLoop eventLoop;
+    loop = &eventLoop;
+    HttpServer server(&eventLoop, InetAddress(port), "HttpCheck");
+    setup(&eventLoop, &server);
+    server.start();
+
+    TcpClient client(&eventLoop, InetAddress("127.0.0.1", port), "HttpCheckClient");
+    client.setConnectionCallback(boost::bind(&HttpCheck::onClientConnection, this, _1));
+    client.setMessageCallback(boost::bind(&HttpCheck::onClientMessage, this, _1, _2, _3));
+    client.connect();
+
+    eventLoop.runAfter(10.0, boost::bind(&EventLoop::quit, &eventLoop));
+    eventLoop.loop();
+    loop = NULL;
+
+    BOOST_CHECK(disconnected);
+    BOOST_CHECK_EQUAL(received.size(), expectedBytes);
+    BOOST_CHECK(withoutDate(received) == expected);
+  }
+
+  EventLoop* loop;
+  std::vector<string> batches;
+  std::vector<size_t> batchBytes;	// 每批应答的字节数，包括Date行
+  size_t batch;
+  size_t expectedBytes;
+  double pauseReading;		// 连上后先停止读这么多秒
+  bool disconnected;
+  string expected;
+  string received;
+};
+
+// 在另一个线程里一块一块地写流式实体，暂停了就返回，
+// 等下一次produce()再接着写
+struct Streamer : boost::noncopyable
+{
+  explicit Streamer(const string& bodyArg)
+    : pool("Streamer"), body(bodyArg), written(0)
+  {
+    pool.start(1);
+  }
+
+  // 在IO线程中执行
+  void produce(const HttpStreamPtr& stream)
+  {
+    calls.increment();
+    pool.run(boost::bind(&Streamer::write, this, stream));
+  }
+
+  void write(const HttpStreamPtr& stream)
+  {
+    while (written < body.size())
+    {
+      if (stream->paused())
+      {
+        pauses.increment();
+        return;
+      }
+      BOOST_CHECK(stream->write(StringPiece(body.data() + written, static_cast<int>(kPieceLength))));
+      written += kPieceLength;
+      ::usleep(100);	// 比IO线程发得慢，高水位标回调之后马上能看到暂停
+    }
+    stream->finish();
+  }
+
+  muduo::ThreadPool pool;
+  string body;
+  size_t written;			// 只在pool的线程里访问
+  muduo::AtomicInt32 calls;
+  muduo::AtomicInt32 pauses;
+};
+
+// 按路径应答：/delay/N过N*10ms在IO线程里done()，其它的马上done()
+struct AsyncHandler
+{
+  AsyncHandler(EventLoop* loopArg, int fdArg, const string& fileArg, const PayloadPtr& payloadArg,
+               Streamer* streamerArg = NULL)
+    : loop(loopArg), fd(fdArg), file(fileArg), payload(payloadArg), streamer(streamerArg), requests(0)
+  {
+  }
+
+  void onRequest(const HttpResponderPtr& responder)
+  {
+    ++requests;
+    StringPiece path = responder->request().path();
+    HttpResponse* response = responder->response();
+    response->setStatusCode(HttpResponse::k200Ok);
+    if (path.starts_with("/delay/"))
+    {
+      int n = atoi(path.data() + 7);
+      response->setBody("delay " + string(path.data() + 7, path.size() - 7));
+      loop->runAfter(n * 0.01, boost::bind(&muduo::net::HttpResponder::done, responder));
+      return;
+    }
+    if (path == "/file")
+    {
+      response->setBodyFile(fd, 0, file.size());
+    }
+    else if (path == "/payload")
+    {
+      response->setBody(payload);
+    }
+    else if (path == "/stream")
+    {
+      response->setBodyStream(boost::bind(&Streamer::produce, streamer, _1));
+    }
+    else
+    {
+      response->setBody(path.as_string());
+    }
+    responder->done();
+  }
+
+  EventLoop* loop;
+  int fd;
+  string file;
+  PayloadPtr payload;
+  Streamer* streamer;
+  int requests;
+};
+
+void setAsync(AsyncHandler* handler, int maxInFlight, EventLoop* loop, HttpServer* server)
+{
+  handler->loop = loop;
+  server->setAsyncHttpCallback(boost::bind(&AsyncHandler::onRequest, handler, _1));
+  server->setMaxRequestsInFlight(maxInFlight);
+}
+
+const size_t kStreamHighWaterMark = 4096;
+
+// 在IO线程里应答：/stream流式，/file用sendfile，其它的回路径
+struct StreamHandler
+{
+  StreamHandler(int fdArg, const string& fileArg, Streamer* streamerArg)
+    : fd(fdArg), file(fileArg), streamer(streamerArg)
+  {
+  }
+
+  void onRequest(const HttpRequest& req, HttpResponse* resp)
+  {
+    StringPiece path = req.path();
+    resp->setStatusCode(HttpResponse::k200Ok);
+    if (path == "/stream")
+    {
+      resp->setBodyStream(boost::bind(&Streamer::produce, streamer, _1));
+    }
+    else if (path == "/file")
+    {
+      resp->setBodyFile(fd, 0, file.size());
+    }
+    else
+    {
+      resp->setBody(path.as_string());
+    }
+  }
+
+  int fd;
+  string file;
+  Streamer* streamer;
+};
+
+void setStream(StreamHandler* handler, EventLoop*, HttpServer* server)
+{
+  server->setHttpCallback(boost::bind(&StreamHandler::onRequest, handler, _1, _2));
+  server->setStreamHighWaterMark(kStreamHighWaterMark);
+}
+
+void setAsyncStream(AsyncHandler* handler, EventLoop* loop, HttpServer* server)
+{
+  setAsync(handler, 0, loop, server);
+  server->setStreamHighWaterMark(kStreamHighWaterMark);
+}
+
+// 8MB，比两端socket的缓冲加起来还大，每块内容都不一样
+string streamBody()
+{
+  string body;
+  for (size_t i = 0; body.size() < 8*1024*1024; ++i)
+  {
+    body.append(kPieceLength, static_cast<char>('a' + i % 26));
+  }
+  return body;
+}
+
+// 在工作线程里执行，/sleep/N睡N*10ms，越早的请求睡得越久
+void sleepHandler(const HttpRequest& req, HttpResponse* resp)
+{
+  StringPiece path = req.path();
+  resp->setStatusCode(HttpResponse::k200Ok);
+  if (path.starts_with("/sleep/"))
+  {
+    ::usleep(atoi(path.data() + 7) * 10*1000);
+  }
+  resp->setBody(path.as_string());
+}
+
+void setWorkers(int numThreads, EventLoop*, HttpServer* server)
+{
+  server->setHttpCallback(sleepHandler);
+  server->setWorkerThreads(numThreads);
+}
+
+void setWorkersThenAsync(AsyncHandler* handler, EventLoop* loop, HttpServer* server)
+{
+  setWorkers(2, loop, server);
+  setAsync(handler, 0, loop, server);
+}
+
+}
+
+// 异步应答完成的顺序和请求的顺序不同，发出去还是按请求的顺序；
+// 文件和Payload实体夹在中间
+BOOST_AUTO_TEST_CASE(testAsyncPipeline)
+{
+  const string file(100*1000, 'f');
+  const string payload(50*1000, 'p');
+  int fd = tempFile(file);
+  AsyncHandler handler(NULL, fd, file, PayloadPtr(new Payload(payload)));
+
+  HttpCheck check;
+  check.addBatch(get("/delay/5") + get("/file") + get("/delay/1") + get("/payload") + get("/hello"),
+                 ok("delay 5") + ok(file) + ok("delay 1") + ok(payload) + ok("/hello"));
+  check.addBatch(get("/payload") + get("/delay/2") + get("/file"),
+                 ok(payload) + ok("delay 2") + ok(file));
+  check.run(23471, boost::bind(setAsync, &handler, 0, _1, _2));
+
+  BOOST_CHECK_EQUAL(handler.requests, 8);
+  ::close(fd);
+}
+
+// 同时在处理的请求超过上限时马上回503，也要排在前面的应答之后；
+// 前面的处理完以后又能接受新的请求
+BOOST_AUTO_TEST_CASE(testMaxRequestsInFlight)
+{
+  AsyncHandler handler(NULL, -1, string(), PayloadPtr());
+
+  HttpCheck check;
+  check.addBatch(get("/delay/3") + get("/delay/1") + get("/delay/1") + get("/hello"),
+                 ok("delay 3") + ok("delay 1") + busy() + busy());
+  check.addBatch(get("/delay/1") + get("/hello"),
+                 ok("delay 1") + ok("/hello"));
+  check.run(23472, boost::bind(setAsync, &handler, 2, _1, _2));
+
+  BOOST_CHECK_EQUAL(handler.requests, 4);
+}
+
+// 工作线程里完成的顺序是反的
+BOOST_AUTO_TEST_CASE(testWorkerThreads)
+{
+  HttpCheck check;
+  check.addBatch(get("/sleep/8") + get("/sleep/6") + get("/sleep/4") + get("/sleep/2") + get("/hello"),
+                 ok("/sleep/8") + ok("/sleep/6") + ok("/sleep/4") + ok("/sleep/2") + ok("/hello"));
+  check.addBatch(get("/sleep/3") + get("/sleep/0"),
+                 ok("/sleep/3") + ok("/sleep/0"));
+  check.run(23473, boost::bind(setWorkers, 4, _1, _2));
+}
+
+// AsyncHttpCallback优先，和设置的先后无关
+BOOST_AUTO_TEST_CASE(testAsyncBeforeWorkers)
+{
+  AsyncHandler handler(NULL, -1, string(), PayloadPtr());
+
+  HttpCheck check;
+  check.addBatch(get("/sleep/1") + get("/hello"),
+                 ok("/sleep/1") + ok("/hello"));
+  check.run(23474, boost::bind(setWorkersThenAsync, &handler, _1, _2));
+
+  BOOST_CHECK_EQUAL(handler.requests, 2);
+}
+
+// 流式实体超过高水位标时暂停，发送缓冲发完后继续；前后的应答
+// 要等它的最后一块发完，文件实体也不能插到它中间
+BOOST_AUTO_TEST_CASE(testStreamPipeline)
+{
+  const string file(100*1000, 'f');
+  int fd = tempFile(file);
+  Streamer streamer(streamBody());
+  StreamHandler handler(fd, file, &streamer);
+
+  HttpCheck check;
+  check.pauseReading = 0.2;
+  check.addBatch(get("/hello") + get("/stream") + get("/file") + get("/hello"),
+                 ok("/hello") + chunkedOk(streamer.body) + ok(file) + ok("/hello"));
+  check.addBatch(get("/file") + get("/bye"),
+                 ok(file) + ok("/bye"));
+  check.run(23475, boost::bind(setStream, &handler, _1, _2));
+
+  BOOST_CHECK_GT(streamer.pauses.get(), 0);
+  BOOST_CHECK_GT(streamer.calls.get(), 1);
+  ::close(fd);
+}
+
+// 异步应答的实体也可以是流式的，排在还没完成的应答后面
+BOOST_AUTO_TEST_CASE(testAsyncStreamPipeline)
+{
+  const string file(100*1000, 'f');
+  int fd = tempFile(file);
+  Streamer streamer(streamBody());
+  AsyncHandler handler(NULL, fd, file, PayloadPtr(), &streamer);
+
+  HttpCheck check;
+  check.pauseReading = 0.2;
+  check.addBatch(get("/delay/5") + get("/stream") + get("/delay/1") + get("/file"),
+                 ok("delay 5") + chunkedOk(streamer.body) + ok("delay 1") + ok(file));
+  check.run(23476, boost::bind(setAsyncStream, &handler, _1, _2));
+
+  BOOST_CHECK_EQUAL(handler.requests, 4);
+  BOOST_CHECK_GT(streamer.pauses.get(), 0);
+  ::close(fd);
+}
@@ -0,0 +1,201 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+
+#include <muduo/net/inspect/ConnectionInspector.h>
+#include <muduo/net/TcpServer.h>
+
+#include <boost/bind.hpp>
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define __STDC_FORMAT_MACROS
+#include <inttypes.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+typedef double (*MetricFunc)(const ConnectionStats&, Timestamp now);
+
+double bytesRead(const ConnectionStats& s, Timestamp) { return static_cast<double>(s.bytesRead); }
+double bytesWritten(const ConnectionStats& s, Timestamp) { return static_cast<double>(s.bytesWritten); }
+double reads(const ConnectionStats& s, Timestamp) { return static_cast<double>(s.reads); }
+double writes(const ConnectionStats& s, Timestamp) { return static_cast<double>(s.writes); }
+double messages(const ConnectionStats& s, Timestamp) { return static_cast<double>(s.messages); }
+double peakOutput(const ConnectionStats& s, Timestamp) { return static_cast<double>(s.peakOutputBytes); }
+double writeBlocked(const ConnectionStats& s, Timestamp) { return s.writeBlockedSeconds; }
+double idle(const ConnectionStats& s, Timestamp now) { return timeDifference(now, s.lastActivity); }
+double rtt(const ConnectionStats& s, Timestamp) { return static_cast<double>(s.tcpiRttUs); }
+double cwnd(const ConnectionStats& s, Timestamp) { return static_cast<double>(s.tcpiCwnd); }
+double retrans(const ConnectionStats& s, Timestamp) { return static_cast<double>(s.tcpiTotalRetrans); }
+
+struct Metric
+{
+  const char* name;
+  MetricFunc func;
+};
+
+const Metric kMetrics[] =
+{
+  { "bytes_read", bytesRead },
+  { "bytes_written", bytesWritten },
+  { "reads", reads },
+  { "writes", writes },
+  { "messages", messages },
+  { "peak_output", peakOutput },
+  { "write_blocked", writeBlocked },
+  { "idle", idle },
+  { "rtt", rtt },
+  { "cwnd", cwnd },
+  { "retrans", retrans },
+};
+
+const int kNumMetrics = sizeof kMetrics / sizeof kMetrics[0];
+
+const char kHeader[] =
+    "# name bytes_read bytes_written reads writes messages peak_output"
+    " write_blocked_s idle_s rtt_us cwnd retrans\n";
+
+void appendStats(string* out, const string& name, const ConnectionStats& s, Timestamp now)
+{
+  char buf[512];
+  snprintf(buf, sizeof buf,
+           "%s %" PRId64 " %" PRId64 " %" PRId64 " %" PRId64 " %" PRId64 " %" PRId64
+           " %.3f %.3f %" PRId64 " %" PRId64 " %" PRId64 "\n",
+           name.c_str(), s.bytesRead, s.bytesWritten, s.reads, s.writes,
+           s.messages, s.peakOutputBytes, s.writeBlockedSeconds,
+           s.lastActivity.valid() ? timeDifference(now, s.lastActivity) : 0.0,
+           s.connections > 0 ? s.tcpiRttUs / s.connections : 0,
+           s.connections > 0 ? s.tcpiCwnd / s.connections : 0,
+           s.tcpiTotalRetrans);
+  *out += buf;
+}
+
+typedef std::pair<double, TcpServer::ConnectionStatsList::value_type> RankedStats;
+
+bool greaterRank(const RankedStats& lhs, const RankedStats& rhs)
+{
+  return lhs.first > rhs.first;
+}
+
+}
+
+void ConnectionInspector::registerCommands(Inspector* ins)
+{
+  ins->add("conn", "summary", boost::bind(&ConnectionInspector::summary, this, _1, _2),
+           "traffic per server and per loop");
+  ins->add("conn", "top", boost::bind(&ConnectionInspector::top, this, _1, _2),
+           "top/<metric>/<n>, connections with the largest metric");
+}
+
+void ConnectionInspector::addServer(TcpServer* server)
+{
+  MutexLockGuard lock(mutex_);
+  servers_.push_back(server);
+}
+
+void ConnectionInspector::removeServer(TcpServer* server)
+{
+  MutexLockGuard lock(mutex_);
+  servers_.erase(std::remove(servers_.begin(), servers_.end(), server), servers_.end());
+}
+
+std::vector<TcpServer*> ConnectionInspector::servers() const
+{
+  MutexLockGuard lock(mutex_);
+  return servers_;
+}
+
+// 汇总的rtt和cwnd是平均值
+string ConnectionInspector::summary(HttpRequest::Method, const Inspector::ArgList&)
+{
+  std::vector<TcpServer*> servers(this->servers());
+  Timestamp now(Timestamp::now());
+  string result(kHeader);
+  for (size_t i = 0; i < servers.size(); ++i)
+  {
+    TcpServer::ConnectionStatsList conns;
+    std::vector<ConnectionStats> perLoop;
+    servers[i]->getConnectionStats(&conns, &perLoop);
+    ConnectionStats total;
+    for (size_t j = 0; j < perLoop.size(); ++j)
+    {
+      total.add(perLoop[j]);
+    }
+    char connections[32];
+    snprintf(connections, sizeof connections, " (%" PRId64 " conns)", total.connections);
+    appendStats(&result, servers[i]->name() + connections, total, now);
+    for (size_t j = 0; j < perLoop.size(); ++j)
+    {
+      char loop[64];
+      snprintf(loop, sizeof loop, "/loop%zu (%" PRId64 " conns)", j, perLoop[j].connections);
+      appendStats(&result, servers[i]->name() + loop, perLoop[j], now);
+    }
+  }
+  return result;
+}
+
+string ConnectionInspector::top(HttpRequest::Method, const Inspector::ArgList& args)
+{
+  const Metric* metric = &kMetrics[1];  // bytes_written
+  size_t n = 10;
+  if (args.size() > 0)
+  {
+    metric = NULL;
+    for (int i = 0; i < kNumMetrics; ++i)
+    {
+      if (args[0] == kMetrics[i].name)
+      {
+        metric = &kMetrics[i];
+      }
+    }
+    if (metric == NULL)
+    {
+      string result("unknown metric, one of:");
+      for (int i = 0; i < kNumMetrics; ++i)
+      {
+        result += " ";
+        result += kMetrics[i].name;
+      }
+      return result + "\n";
+    }
+  }
+  if (args.size() > 1)
+  {
+    n = static_cast<size_t>(atoi(args[1].c_str()));
+  }
+
+  std::vector<TcpServer*> servers(this->servers());
+  Timestamp now(Timestamp::now());
+  std::vector<RankedStats> ranked;
+  for (size_t i = 0; i < servers.size(); ++i)
+  {
+    TcpServer::ConnectionStatsList conns;
+    std::vector<ConnectionStats> perLoop;
+    servers[i]->getConnectionStats(&conns, &perLoop);
+    for (size_t j = 0; j < conns.size(); ++j)
+    {
+      ranked.push_back(RankedStats(metric->func(conns[j].second, now), conns[j]));
+    }
+  }
+  n = std::min(n, ranked.size());
+  std::partial_sort(ranked.begin(), ranked.begin() + n, ranked.end(), greaterRank);
+
+  string result(kHeader);
+  for (size_t i = 0; i < n; ++i)
+  {
+    const TcpConnectionPtr& conn = ranked[i].second.first;
+    appendStats(&result, conn->name(), ranked[i].second.second, now);
+  }
+  return result;
+}
@@ -0,0 +1,47 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is an internal header file, you should not include this.
+
+#ifndef MUDUO_NET_INSPECT_CONNECTIONINSPECTOR_H
+#define MUDUO_NET_INSPECT_CONNECTIONINSPECTOR_H
+
+#include <muduo/base/Mutex.h>
+#include <muduo/net/inspect/Inspector.h>
+#include <boost/noncopyable.hpp>
+
+namespace muduo
+{
+namespace net
+{
+
+class TcpServer;
+
+// 各个TcpServer的连接统计，/conn/summary和/conn/top/<metric>/<n>
+class ConnectionInspector : boost::noncopyable
+{
+ public:
+  void registerCommands(Inspector* ins);	// 注册命令接口
+
+  void addServer(TcpServer* server);
+  void removeServer(TcpServer* server);
+
+ private:
+  string summary(HttpRequest::Method, const Inspector::ArgList&);
+  string top(HttpRequest::Method, const Inspector::ArgList& args);
+
+  std::vector<TcpServer*> servers() const;
+
+  mutable MutexLock mutex_;
+  std::vector<TcpServer*> servers_;
+};
+
+}
+}
+
+#endif  // MUDUO_NET_INSPECT_CONNECTIONINSPECTOR_H
@@ -13,14 +13,13 @@
 #include <muduo/net/EventLoop.h>
 #include <muduo/net/http/HttpRequest.h>
 #include <muduo/net/http/HttpResponse.h>
+#include <muduo/net/http/HttpRouter.h>
+#include <muduo/net/inspect/ConnectionInspector.h>
+#include <muduo/net/inspect/NetInspector.h>
 #include <muduo/net/inspect/ProcessInspector.h>
 
-//#include <iostream>
-//#include <iterator>
-//#include <sstream>
+#include <algorithm>
 #include <boost/bind.hpp>
-#include <boost/algorithm/string/classification.hpp>
-#include <boost/algorithm/string/split.hpp>
 
 using namespace muduo;
 using namespace muduo::net;
@@ -29,28 +28,41 @@ namespace
 {
 Inspector* g_globalInspector = 0;
 
-// Looks buggy
-std::vector<string> split(const string& str)
+// 通配段按'/'分割成参数表，空的段跳过
+Inspector::ArgList splitArgs(const StringPiece& str)
 {
-  std::vector<string> result;
-  size_t start = 0;
-  size_t pos = str.find('/');
-  while (pos != string::npos)
+  Inspector::ArgList result;
+  const char* start = str.data();
+  const char* end = str.data() + str.size();
+  while (start < end)
   {
-    if (pos > start)
+    const char* slash = std::find(start, end, '/');
+    if (slash > start)
     {
-      result.push_back(str.substr(start, pos-start));
+      result.push_back(string(start, slash));
     }
-    start = pos+1;
-    pos = str.find('/', start);
+    start = slash + 1;
   }
+  return result;
+}
 
-  if (start < str.length())		// 说明最后一个字符不是'/'
+void onCommand(const Inspector::Callback& cb,
+               const HttpRequest& req,
+               const HttpRouter::Params& params,
+               HttpResponse* resp)
+{
+  if (cb)
   {
-    result.push_back(str.substr(start));
+    resp->setStatusCode(HttpResponse::k200Ok);
+    resp->setStatusMessage("OK");
+    resp->setContentType("text/plain");
+    resp->setBody(cb(req.method(), splitArgs(params.get("args"))));		// 调用cb将返回的字符串传给setBody
+  }
+  else
+  {
+    resp->setStatusCode(HttpResponse::k404NotFound);
+    resp->setStatusMessage("Not Found");
   }
-
-  return result;
 }
 
 }
@@ -59,13 +71,23 @@ Inspector::Inspector(EventLoop* loop,
                      const InetAddress& httpAddr,
                      const string& name)
     : server_(loop, httpAddr, "Inspector:"+name),
-      processInspector_(new ProcessInspector)
+      processInspector_(new ProcessInspector),
+      netInspector_(new NetInspector),
+      connectionInspector_(new ConnectionInspector),
+      router_(new HttpRouter)
 {
   assert(CurrentThread::isMainThread());
   assert(g_globalInspector == 0);
   g_globalInspector = this;
+  for (int m = HttpRequest::kGet; m <= HttpRequest::kDelete; ++m)
+  {
+    router_->add(static_cast<HttpRequest::Method>(m), "/",
+                 boost::bind(&Inspector::onHelp, this, _3));
+  }
   server_.setHttpCallback(boost::bind(&Inspector::onRequest, this, _1, _2));
   processInspector_->registerCommands(this);
+  netInspector_->registerCommands(this);
+  connectionInspector_->registerCommands(this);
   // 这样子做法是为了防止竞态问题
   // 如果直接调用start，（当前线程不是loop所属的IO线程，是主线程）那么有可能，当前构造函数还没返回，
   // HttpServer所在的IO线程可能已经收到了http客户端的请求了（因为这时候HttpServer已启动），那么就会回调
@@ -85,10 +107,33 @@ void Inspector::add(const string& module,
                     const string& help)
 {
   MutexLockGuard lock(mutex_);
-  commands_[module][command] = cb;
+  if (!router_.unique())
+  {
+    router_.reset(new HttpRouter(*router_));
+  }
+  // /module/command后面的各段是传给cb的参数，方法由cb自己区分
+  const string pattern = "/" + module + "/" + command;
+  HttpRouter::Handler handler(boost::bind(onCommand, cb, _1, _2, _3));
+  for (int m = HttpRequest::kGet; m <= HttpRequest::kDelete; ++m)
+  {
+    HttpRequest::Method method = static_cast<HttpRequest::Method>(m);
+    bool ok = router_->add(method, pattern, handler)
+              && router_->add(method, pattern + "/*args", handler);
+    assert(ok); (void)ok;
+  }
   helps_[module][command] = help;
 }
 
+void Inspector::addTcpServer(TcpServer* server)
+{
+  connectionInspector_->addServer(server);
+}
+
+void Inspector::removeTcpServer(TcpServer* server)
+{
+  connectionInspector_->removeServer(server);
+}
+
 void Inspector::start()
 {
   server_.start();
@@ -96,85 +141,40 @@ void Inspector::start()
 
 void Inspector::onRequest(const HttpRequest& req, HttpResponse* resp)
 {
-  if (req.path() == "/")
+  boost::shared_ptr<HttpRouter> router;
   {
-    string result;
     MutexLockGuard lock(mutex_);
-    // 遍历helps 
-    for (std::map<string, HelpList>::const_iterator helpListI = helps_.begin();
-         helpListI != helps_.end();
-         ++helpListI)
-    {
-      const HelpList& list = helpListI->second;
-      for (HelpList::const_iterator it = list.begin();
-           it != list.end();
-           ++it)
-      {
-        result += "/";
-        result += helpListI->first;		// module
-        result += "/";
-        result += it->first;			// command
-        result += "\t";
-        result += it->second;			// help
-        result += "\n";
-      }
-    }
-    resp->setStatusCode(HttpResponse::k200Ok);
-    resp->setStatusMessage("OK");
-    resp->setContentType("text/plain");
-    resp->setBody(result);
+    router = router_;
   }
-  else
-  {
-    // 以"/"进行分割，将得到的字符串保存在result中
-    std::vector<string> result = split(req.path());
-    // boost::split(result, req.path(), boost::is_any_of("/"));
-    //std::copy(result.begin(), result.end(), std::ostream_iterator<string>(std::cout, ", "));
-    //std::cout << "\n";
-    bool ok = false;
-    if (result.size() == 0)
-    {
-      // 这种情况是错误的，因此ok仍为false
-    }
-    else if (result.size() == 1)
-    {
-      // 只有module，没有command也是错的，因此ok仍为false
-      string module = result[0];
-    }
-    else
-    {
-      string module = result[0];
-      // 查找module所对应的命令列表
-      std::map<string, CommandList>::const_iterator commListI = commands_.find(module);
-      if (commListI != commands_.end())
-      {
-        string command = result[1];
-        const CommandList& commList = commListI->second;
-		// 查找command对应的命令
-        CommandList::const_iterator it = commList.find(command);
-        if (it != commList.end())
-        {
-          ArgList args(result.begin()+2, result.end());		// 传递给回调函数的参数表
-          if (it->second)
-          {
-            resp->setStatusCode(HttpResponse::k200Ok);
-            resp->setStatusMessage("OK");
-            resp->setContentType("text/plain");
-            const Callback& cb = it->second;
-            resp->setBody(cb(req.method(), args));		// 调用cb将返回的字符串传给setBody
-            ok = true;
-          }
-        }
-      }
-
-    }
+  router->onRequest(req, resp);
+}
 
-    if (!ok)
+// 列出所有命令
+void Inspector::onHelp(HttpResponse* resp)
+{
+  string result;
+  MutexLockGuard lock(mutex_);
+  // 遍历helps
+  for (std::map<string, HelpList>::const_iterator helpListI = helps_.begin();
+       helpListI != helps_.end();
+       ++helpListI)
+  {
+    const HelpList& list = helpListI->second;
+    for (HelpList::const_iterator it = list.begin();
+         it != list.end();
+         ++it)
     {
-      resp->setStatusCode(HttpResponse::k404NotFound);
-      resp->setStatusMessage("Not Found");
+      result += "/";
+      result += helpListI->first;		// module
+      result += "/";
+      result += it->first;			// command
+      result += "\t";
+      result += it->second;			// help
+      result += "\n";
     }
-    //resp->setCloseConnection(true);
   }
+  resp->setStatusCode(HttpResponse::k200Ok);
+  resp->setStatusMessage("OK");
+  resp->setContentType("text/plain");
+  resp->setBody(result);
 }
-
@@ -19,12 +19,16 @@
 #include <boost/function.hpp>
 #include <boost/noncopyable.hpp>
 #include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
 
 namespace muduo
 {
 namespace net
 {
 
+class ConnectionInspector;
+class HttpRouter;
+class NetInspector;
 class ProcessInspector;
 
 // A internal inspector of the running process, usually a singleton.
@@ -45,17 +49,25 @@ class Inspector : boost::noncopyable
            const Callback& cb,
            const string& help);
 
+  /// Lists connections of @c server under /conn.
+  /// Thread safe.
+  void addTcpServer(TcpServer* server);
+  void removeTcpServer(TcpServer* server);
+
  private:
-  typedef std::map<string, Callback> CommandList;
   typedef std::map<string, string> HelpList;
 
   void start();
   void onRequest(const HttpRequest& req, HttpResponse* resp);
+  void onHelp(HttpResponse* resp);
 
   HttpServer server_;
   boost::scoped_ptr<ProcessInspector> processInspector_;
+  boost::scoped_ptr<NetInspector> netInspector_;
+  boost::scoped_ptr<ConnectionInspector> connectionInspector_;
   MutexLock mutex_;
-  std::map<string, CommandList> commands_;
+  // 写时复制：add()时如果有请求正在用，就复制一份再改
+  boost::shared_ptr<HttpRouter> router_;
   std::map<string, HelpList> helps_;
 };
 
@@ -0,0 +1,46 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+
+#include <muduo/net/inspect/NetInspector.h>
+#include <muduo/net/TcpConnection.h>
+
+#include <stdio.h>
+
+#define __STDC_FORMAT_MACROS
+#include <inttypes.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+void NetInspector::registerCommands(Inspector* ins)
+{
+  ins->add("net", "buffers", NetInspector::buffers, "bytes buffered by all connections");
+  ins->add("net", "idle", NetInspector::idle, "connections closed for being idle");
+}
+
+string NetInspector::buffers(HttpRequest::Method, const Inspector::ArgList&)
+{
+  char buf[256];
+  snprintf(buf, sizeof buf,
+           "buffered_bytes %" PRId64 "\n"
+           "peak_buffered_bytes %" PRId64 "\n"
+           "buffered_bytes_limit %" PRId64 "\n",
+           TcpConnection::totalBufferedBytes(),
+           TcpConnection::peakBufferedBytes(),
+           TcpConnection::bufferedBytesLimit());
+  return buf;
+}
+
+string NetInspector::idle(HttpRequest::Method, const Inspector::ArgList&)
+{
+  char buf[64];
+  snprintf(buf, sizeof buf, "idle_evictions %" PRId64 "\n",
+           TcpConnection::totalIdleEvictions());
+  return buf;
+}
@@ -0,0 +1,35 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is an internal header file, you should not include this.
+
+#ifndef MUDUO_NET_INSPECT_NETINSPECTOR_H
+#define MUDUO_NET_INSPECT_NETINSPECTOR_H
+
+#include <muduo/net/inspect/Inspector.h>
+#include <boost/noncopyable.hpp>
+
+namespace muduo
+{
+namespace net
+{
+
+class NetInspector : boost::noncopyable
+{
+ public:
+  void registerCommands(Inspector* ins);	// 注册命令接口
+
+ private:
+  static string buffers(HttpRequest::Method, const Inspector::ArgList&);
+  static string idle(HttpRequest::Method, const Inspector::ArgList&);
+};
+
+}
+}
+
+#endif  // MUDUO_NET_INSPECT_NETINSPECTOR_H
@@ -116,6 +116,11 @@ void EPollPoller::updateChannel(Channel* channel)//根据channel的序号在epol
     {
       assert(channels_.find(fd) != channels_.end());//确保这个channel的文件描述符在channels_中
       assert(channels_[fd] == channel);//确保在epoll队列中channel和fd一致
+      if (channel->isNoneEvent())
+      {
+        // 仍然没有要关注的事件，不要加回去，否则还会收到EPOLLHUP/EPOLLERR
+        return;
+      }
     }
     channel->set_index(kAdded);//修改index为已在队列中
     update(EPOLL_CTL_ADD, channel);
@@ -0,0 +1,165 @@
+// Queueing delay towards a slow reader with a fixed vs. an adaptive high
+// water mark.
+//
+// usage: adaptivehighwatermark_bench [read_kbps] [seconds] [-a]
+//   -a  turns on TcpServer::setAdaptiveHighWaterMark(0.05)
+//
+// The server sends 64KiB records stamped with the send time as long as it
+// is below its high water mark (8MiB), pausing on the high water mark
+// callback and resuming on the low water mark callback.  The client reads
+// at a fixed rate and reports how old the records are when they arrive,
+// and how much was queued on the server.
+
+#include <muduo/base/Logging.h>
+#include <muduo/base/Thread.h>
+#include <muduo/base/Timestamp.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/InetAddress.h>
+#include <muduo/net/SocketsOps.h>
+#include <muduo/net/TcpServer.h>
+
+#include <boost/bind.hpp>
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const uint16_t kPort = 2014;
+const size_t kRecordSize = 64*1024;
+
+int g_readKBps = 10*1024;
+int g_seconds = 5;
+bool g_adaptive = false;
+bool g_paused = false;
+int64_t g_peakOutput = 0;
+TcpConnectionPtr g_conn;
+
+void onHighWaterMark(const TcpConnectionPtr&, size_t)
+{
+  g_paused = true;
+}
+
+void onLowWaterMark(const TcpConnectionPtr&, size_t)
+{
+  g_paused = false;
+}
+
+void onConnection(const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    conn->setHighWaterMarkCallback(onHighWaterMark, 8*1024*1024);
+    conn->setLowWaterMarkCallback(onLowWaterMark, 0);
+    g_conn = conn;
+  }
+  else
+  {
+    g_peakOutput = conn->stats().peakOutputBytes;
+    g_conn.reset();
+  }
+}
+
+void produce()
+{
+  if (g_conn && g_conn->connected() && !g_paused)
+  {
+    string record(kRecordSize, 'r');
+    int64_t now = Timestamp::now().microSecondsSinceEpoch();
+    memcpy(&record[0], &now, sizeof now);
+    g_conn->send(record);
+  }
+}
+
+void runClient(EventLoop* loop)
+{
+  InetAddress serverAddr("127.0.0.1", kPort);
+  int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0 || sockets::connect(fd, serverAddr.getSockAddrInet()) < 0)
+  {
+    perror("connect");
+    loop->quit();
+    return;
+  }
+  // 每10ms读一次
+  const size_t kReadSize = static_cast<size_t>(g_readKBps) * 1024 / 100;
+  std::vector<char> buf(kReadSize);
+  std::vector<char> record;
+  double sumDelay = 0;
+  double maxDelay = 0;
+  int records = 0;
+  Timestamp start(Timestamp::now());
+  while (timeDifference(Timestamp::now(), start) < g_seconds)
+  {
+    ssize_t n = ::read(fd, &buf[0], buf.size());
+    if (n <= 0)
+    {
+      break;
+    }
+    record.insert(record.end(), buf.begin(), buf.begin() + n);
+    while (record.size() >= kRecordSize)
+    {
+      int64_t sent = 0;
+      memcpy(&sent, &record[0], sizeof sent);
+      double delay = static_cast<double>(Timestamp::now().microSecondsSinceEpoch() - sent) / 1e6;
+      sumDelay += delay;
+      maxDelay = std::max(maxDelay, delay);
+      ++records;
+      record.erase(record.begin(), record.begin() + kRecordSize);
+    }
+    ::usleep(10*1000);
+  }
+  ::close(fd);
+  ::usleep(100*1000);
+  printf("%s: %d records, delay mean %.3f s max %.3f s, ",
+         g_adaptive ? "adaptive" : "fixed", records,
+         records > 0 ? sumDelay / records : 0.0, maxDelay);
+  loop->runInLoop(boost::bind(&EventLoop::quit, loop));
+}
+
+int main(int argc, char* argv[])
+{
+  Logger::setLogLevel(Logger::ERROR);
+  int numArgs = 0;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (strcmp(argv[i], "-a") == 0)
+    {
+      g_adaptive = true;
+    }
+    else if (numArgs++ == 0)
+    {
+      g_readKBps = atoi(argv[i]);
+    }
+    else
+    {
+      g_seconds = atoi(argv[i]);
+    }
+  }
+
+  EventLoop loop;
+  TcpServer server(&loop, InetAddress(kPort), "AdaptiveBench");
+  server.setConnectionCallback(onConnection);
+  if (g_adaptive)
+  {
+    server.setAdaptiveHighWaterMark(0.05);
+  }
+  server.start();
+  loop.runEvery(0.001, produce);
+
+  Thread client(boost::bind(runClient, &loop), "client");
+  client.start();
+  loop.loop();
+  client.join();
+  if (g_conn)
+  {
+    g_peakOutput = g_conn->stats().peakOutputBytes;
+  }
+  printf("peak output buffer %.1f MiB\n", static_cast<double>(g_peakOutput) / (1024*1024));
+}
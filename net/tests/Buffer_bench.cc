@@ -0,0 +1,122 @@
+// Append/retrieve patterns of Buffer under each BufferAllocator policy.
+//
+// usage: buffer_bench [iterations]
+
+#include <muduo/base/BlockingQueue.h>
+#include <muduo/base/Thread.h>
+#include <muduo/base/Timestamp.h>
+#include <muduo/net/Buffer.h>
+#include <muduo/net/BufferAllocator.h>
+
+#include <boost/bind.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+using namespace muduo;
+using namespace muduo::net;
+
+int g_iterations = 200000;
+const char kData[4096] = { 0 };
+
+// request/response: small appends, drained completely every round
+double benchSmallMessages()
+{
+  Timestamp start(Timestamp::now());
+  Buffer buf;
+  for (int i = 0; i < g_iterations; ++i)
+  {
+    buf.append(kData, 100);
+    buf.append(kData, 300);
+    buf.retrieve(200);
+    buf.append(kData, 60);
+    buf.retrieveAll();
+  }
+  return timeDifference(Timestamp::now(), start);
+}
+
+// short lived buffers growing up to 64KiB, like a connection's output
+// buffer under a burst
+double benchGrowAndFree()
+{
+  Timestamp start(Timestamp::now());
+  for (int i = 0; i < g_iterations / 10; ++i)
+  {
+    Buffer buf;
+    for (int j = 0; j < 16; ++j)
+    {
+      buf.append(kData, sizeof kData);
+    }
+    buf.retrieveAll();
+  }
+  return timeDifference(Timestamp::now(), start);
+}
+
+// the same pattern with std::vector, which zero-fills on every resize
+double benchVectorGrow()
+{
+  Timestamp start(Timestamp::now());
+  for (int i = 0; i < g_iterations / 10; ++i)
+  {
+    std::vector<char> buf(1032);
+    size_t size = 0;
+    for (int j = 0; j < 16; ++j)
+    {
+      if (buf.size() < size + sizeof kData)
+      {
+        buf.resize(size + sizeof kData);
+      }
+      std::copy(kData, kData + sizeof kData, buf.begin() + size);
+      size += sizeof kData;
+    }
+  }
+  return timeDifference(Timestamp::now(), start);
+}
+
+typedef BlockingQueue<Buffer*> BufferQueue;
+
+void freeBuffers(BufferQueue* queue)
+{
+  while (Buffer* buf = queue->take())
+  {
+    delete buf;
+  }
+}
+
+// buffers allocated in one thread and destroyed in another,
+// as with messages handed to a worker thread
+double benchCrossThread()
+{
+  BufferQueue queue;
+  Thread consumer(boost::bind(freeBuffers, &queue), "consumer");
+  consumer.start();
+  Timestamp start(Timestamp::now());
+  for (int i = 0; i < g_iterations; ++i)
+  {
+    Buffer* buf = new Buffer;
+    buf->append(kData, 512);
+    queue.put(buf);
+  }
+  queue.put(NULL);
+  consumer.join();
+  return timeDifference(Timestamp::now(), start);
+}
+
+void run(BufferAllocator::Policy policy, const char* name)
+{
+  BufferAllocator::setPolicy(policy);
+  printf("%-12s small %.3fs  grow %.3fs  cross-thread %.3fs\n",
+         name, benchSmallMessages(), benchGrowAndFree(), benchCrossThread());
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc > 1)
+  {
+    g_iterations = atoi(argv[1]);
+  }
+  printf("std::vector grow %.3fs\n", benchVectorGrow());
+  run(BufferAllocator::kHeap, "heap");
+  run(BufferAllocator::kThreadCache, "threadcache");
+}
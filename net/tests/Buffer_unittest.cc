@@ -0,0 +1,154 @@
+#include <muduo/net/Buffer.h>
+#include <muduo/net/BufferAllocator.h>
+#include <muduo/net/BufferPool.h>
+
+//#define BOOST_TEST_MODULE BufferTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using muduo::string;
+using muduo::net::Buffer;
+using muduo::net::BufferAllocator;
+using muduo::net::BufferPool;
+
+BOOST_AUTO_TEST_CASE(testBufferAppendRetrieve)
+{
+  Buffer buf;
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 0);
+  BOOST_CHECK_EQUAL(buf.writableBytes(), Buffer::kInitialSize);
+  BOOST_CHECK_EQUAL(buf.prependableBytes(), Buffer::kCheapPrepend);
+
+  const string str(200, 'x');
+  buf.append(str);
+  BOOST_CHECK_EQUAL(buf.readableBytes(), str.size());
+  BOOST_CHECK_EQUAL(buf.writableBytes(), Buffer::kInitialSize - str.size());
+  BOOST_CHECK_EQUAL(buf.prependableBytes(), Buffer::kCheapPrepend);
+
+  const string str2 =  buf.retrieveAsString(50);
+  BOOST_CHECK_EQUAL(str2.size(), 50);
+  BOOST_CHECK_EQUAL(buf.readableBytes(), str.size() - str2.size());
+  BOOST_CHECK_EQUAL(buf.prependableBytes(), Buffer::kCheapPrepend + str2.size());
+  BOOST_CHECK_EQUAL(str2, string(50, 'x'));
+
+  buf.append(str);
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 2*str.size() - str2.size());
+
+  const string str3 =  buf.retrieveAllAsString();
+  BOOST_CHECK_EQUAL(str3.size(), 350);
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 0);
+  BOOST_CHECK_EQUAL(buf.prependableBytes(), Buffer::kCheapPrepend);
+  BOOST_CHECK_EQUAL(str3, string(350, 'x'));
+}
+
+BOOST_AUTO_TEST_CASE(testBufferGrow)
+{
+  Buffer buf;
+  buf.append(string(400, 'y'));
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 400);
+
+  buf.retrieve(50);
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 350);
+  BOOST_CHECK_EQUAL(buf.prependableBytes(), Buffer::kCheapPrepend+50);
+
+  buf.append(string(1000, 'z'));
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 1350);
+  BOOST_CHECK_EQUAL(buf.prependableBytes(), Buffer::kCheapPrepend);
+  BOOST_CHECK(buf.writableBytes() > 0);
+  BOOST_CHECK_EQUAL(buf.retrieveAsString(350), string(350, 'y'));
+  BOOST_CHECK_EQUAL(buf.retrieveAllAsString(), string(1000, 'z'));
+}
+
+BOOST_AUTO_TEST_CASE(testBufferInsideGrow)
+{
+  Buffer buf;
+  buf.append(string(800, 'y'));
+  buf.retrieve(500);
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 300);
+  BOOST_CHECK_EQUAL(buf.prependableBytes(), Buffer::kCheapPrepend+500);
+
+  const size_t capacity = buf.internalCapacity();
+  buf.append(string(300, 'z'));
+  BOOST_CHECK_EQUAL(buf.internalCapacity(), capacity);
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 600);
+  BOOST_CHECK_EQUAL(buf.prependableBytes(), Buffer::kCheapPrepend);
+}
+
+BOOST_AUTO_TEST_CASE(testBufferShrink)
+{
+  Buffer buf;
+  buf.append(string(2000, 'y'));
+  buf.retrieve(1500);
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 500);
+
+  buf.shrink(0);
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 500);
+  BOOST_CHECK_EQUAL(buf.retrieveAllAsString(), string(500, 'y'));
+}
+
+BOOST_AUTO_TEST_CASE(testBufferPrepend)
+{
+  Buffer buf;
+  buf.append(string(200, 'y'));
+  int x = 0;
+  buf.prepend(&x, sizeof x);
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 204);
+  BOOST_CHECK_EQUAL(buf.prependableBytes(), Buffer::kCheapPrepend - 4);
+  BOOST_CHECK_EQUAL(buf.readInt32(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(testBufferCopyAndSwap)
+{
+  Buffer a;
+  a.append("hello");
+  a.retrieve(1);
+  Buffer b(a);
+  BOOST_CHECK_EQUAL(b.retrieveAllAsString(), string("ello"));
+  BOOST_CHECK_EQUAL(a.toStringPiece().as_string(), string("ello"));
+
+  Buffer c(0);
+  c = a;
+  a.retrieveAll();
+  BOOST_CHECK_EQUAL(c.retrieveAllAsString(), string("ello"));
+
+  Buffer d;
+  d.append("world");
+  a.swap(d);
+  BOOST_CHECK_EQUAL(a.retrieveAllAsString(), string("world"));
+  BOOST_CHECK_EQUAL(d.readableBytes(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(testBufferThreadCache)
+{
+  BufferAllocator::setPolicy(BufferAllocator::kThreadCache);
+  {
+    Buffer buf;
+    BOOST_CHECK_EQUAL(buf.internalCapacity(), BufferAllocator::sizeClass(0));
+    buf.append(string(5000, 'x'));
+    BOOST_CHECK_EQUAL(buf.internalCapacity(), BufferAllocator::sizeClass(2));
+    BOOST_CHECK_EQUAL(buf.retrieveAllAsString(), string(5000, 'x'));
+  }
+  BOOST_CHECK_EQUAL(BufferAllocator::cachedBlocksInThisThread(), 2);
+  {
+    Buffer buf;
+    BOOST_CHECK_EQUAL(BufferAllocator::cachedBlocksInThisThread(), 1);
+  }
+  BufferAllocator::setPolicy(BufferAllocator::kHeap);
+}
+
+BOOST_AUTO_TEST_CASE(testBufferPool)
+{
+  BufferPool pool;
+  Buffer buf;
+  pool.release(&buf);
+  BOOST_CHECK(!BufferPool::hasStorage(buf));
+  BOOST_CHECK_EQUAL(pool.freeCount(), 1);
+
+  pool.acquire(&buf);
+  BOOST_CHECK(BufferPool::hasStorage(buf));
+  BOOST_CHECK_EQUAL(pool.freeCount(), 0);
+  buf.append(string(10000, 'x'));
+  buf.retrieveAll();
+  pool.release(&buf);
+  BOOST_CHECK_EQUAL(pool.freeCount(), 0);
+}
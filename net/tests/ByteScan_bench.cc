@@ -0,0 +1,132 @@
+// Scanning header lines for CRLF and delimiters: std::search and
+// std::find_first_of, as Buffer used to, against each kernel of ByteScan.
+//
+// usage: bytescan_bench [megabytes]
+//
+// Each test scans the same amount of input cut into lines of one length,
+// from short header lines to long cookies.
+
+#include <muduo/base/Timestamp.h>
+#include <muduo/net/ByteScan.h>
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const char kCRLF[] = "\r\n";
+const char kDelimiters[] = ":;";
+
+// 用lineLength长的行填满buf
+void fill(std::vector<char>* buf, size_t lineLength)
+{
+  for (size_t i = 0; i < buf->size(); ++i)
+  {
+    (*buf)[i] = static_cast<char>('a' + i % 26);
+  }
+  for (size_t i = lineLength - 2; i + 1 < buf->size(); i += lineLength)
+  {
+    (*buf)[i] = '\r';
+    (*buf)[i + 1] = '\n';
+  }
+}
+
+template<typename Scan>
+double bench(const std::vector<char>& buf, int rounds, Scan scanLine)
+{
+  const char* end = &buf[0] + buf.size();
+  size_t lines = 0;
+  Timestamp start(Timestamp::now());
+  for (int r = 0; r < rounds; ++r)
+  {
+    const char* p = &buf[0];
+    while (const char* crlf = scanLine(p, end))
+    {
+      ++lines;
+      p = crlf + 2;
+    }
+  }
+  double seconds = timeDifference(Timestamp::now(), start);
+  if (lines == 0)
+  {
+    abort();
+  }
+  return static_cast<double>(buf.size()) * rounds / (1024*1024) / seconds;
+}
+
+const char* searchCRLF(const char* begin, const char* end)
+{
+  const char* crlf = std::search(begin, end, kCRLF, kCRLF + 2);
+  return crlf == end ? NULL : crlf;
+}
+
+const char* g_found = NULL;
+
+// 像解析header一样，先找行尾，再在行内找分隔符
+const char* findFirstOfStd(const char* begin, const char* end)
+{
+  const char* crlf = searchCRLF(begin, end);
+  if (crlf)
+  {
+    const char* p = std::find_first_of(begin, crlf, kDelimiters, kDelimiters + 2);
+    g_found = p == crlf ? NULL : p;
+  }
+  return crlf;
+}
+
+const char* findFirstOfScan(const char* begin, const char* end)
+{
+  const char* crlf = scan::findCRLF(begin, end);
+  if (crlf)
+  {
+    g_found = scan::findFirstOf(begin, crlf, kDelimiters, 2);
+  }
+  return crlf;
+}
+
+int main(int argc, char* argv[])
+{
+  const size_t kBytes = 1024*1024;
+  int megabytes = argc > 1 ? atoi(argv[1]) : 256;
+  const scan::Implementation best = scan::implementation();
+  const scan::Implementation impls[] = { scan::kScalar, scan::kSse2, scan::kAvx2 };
+  const size_t lineLengths[] = { 16, 32, 64, 128, 512, 4096 };
+
+  printf("findCRLF MiB/s, best kernel is %s\n", scan::implementationName());
+  printf("%6s %10s %10s %10s %10s\n", "line", "std", "scalar", "sse2", "avx2");
+  std::vector<char> buf(kBytes);
+  for (size_t l = 0; l < sizeof lineLengths / sizeof lineLengths[0]; ++l)
+  {
+    fill(&buf, lineLengths[l]);
+    printf("%6zu %10.0f", lineLengths[l], bench(buf, megabytes, searchCRLF));
+    for (size_t i = 0; i < sizeof impls / sizeof impls[0]; ++i)
+    {
+      if (scan::setImplementation(impls[i]))
+        printf(" %10.0f", bench(buf, megabytes, scan::findCRLF));
+      else
+        printf(" %10s", "-");
+    }
+    printf("\n");
+  }
+
+  // 分隔符不出现，每行都要扫两遍
+  printf("\nfindCRLF then findFirstOf(\":;\") in the line, MiB/s\n");
+  printf("%6s %10s %10s %10s %10s\n", "line", "std", "scalar", "sse2", "avx2");
+  for (size_t l = 0; l < sizeof lineLengths / sizeof lineLengths[0]; ++l)
+  {
+    fill(&buf, lineLengths[l]);
+    printf("%6zu %10.0f", lineLengths[l], bench(buf, megabytes, findFirstOfStd));
+    for (size_t i = 0; i < sizeof impls / sizeof impls[0]; ++i)
+    {
+      if (scan::setImplementation(impls[i]))
+        printf(" %10.0f", bench(buf, megabytes, findFirstOfScan));
+      else
+        printf(" %10s", "-");
+    }
+    printf("\n");
+  }
+  scan::setImplementation(best);
+}
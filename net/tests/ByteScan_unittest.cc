@@ -0,0 +1,117 @@
+#include <muduo/net/Buffer.h>
+#include <muduo/net/ByteScan.h>
+
+//#define BOOST_TEST_MODULE ByteScanTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <vector>
+
+using muduo::string;
+using muduo::net::Buffer;
+namespace scan = muduo::net::scan;
+
+namespace
+{
+
+const scan::Implementation kImpls[] = { scan::kScalar, scan::kSse2, scan::kAvx2 };
+
+const char* searchCRLF(const char* begin, const char* end)
+{
+  const char crlf[] = "\r\n";
+  const char* p = std::search(begin, end, crlf, crlf + 2);
+  return p == end ? NULL : p;
+}
+
+const char* searchFirstOf(const char* begin, const char* end, const char* delims, size_t n)
+{
+  const char* p = std::find_first_of(begin, end, delims, delims + n);
+  return p == end ? NULL : p;
+}
+
+// 每个长度、每个位置放一个目标，前后夹着容易混淆的字节
+void checkAll()
+{
+  const char* delims = ":; ";
+  std::vector<char> data(200);
+  for (size_t len = 0; len <= 100; ++len)
+  {
+    for (size_t pos = 0; pos <= len; ++pos)
+    {
+      for (size_t offset = 0; offset < 3; ++offset)
+      {
+        std::fill(data.begin(), data.end(), 'x');
+        char* begin = &data[offset];
+        char* end = begin + len;
+        // 单独的\r和\n不算
+        if (pos > 2)
+        {
+          begin[pos - 3] = '\r';
+          begin[pos - 2] = '\n' + 1;
+        }
+        if (pos < len)
+        {
+          begin[pos] = '\r';
+        }
+        if (pos + 1 < len)
+        {
+          begin[pos + 1] = '\n';
+        }
+        if (pos + 2 < len)
+        {
+          begin[pos + 2] = ';';
+        }
+        // 结尾之后的字节不能被当成数据
+        *end = '\n';
+        BOOST_CHECK(scan::findCRLF(begin, end) == searchCRLF(begin, end));
+        BOOST_CHECK(scan::findEOL(begin, end) == searchFirstOf(begin, end, "\n", 1));
+        for (size_t n = 1; n <= 3; ++n)
+        {
+          BOOST_CHECK(scan::findFirstOf(begin, end, delims, n)
+                      == searchFirstOf(begin, end, delims, n));
+        }
+      }
+    }
+  }
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(testAllImplementations)
+{
+  scan::Implementation best = scan::implementation();
+  for (size_t i = 0; i < sizeof kImpls / sizeof kImpls[0]; ++i)
+  {
+    if (scan::setImplementation(kImpls[i]))
+    {
+      BOOST_TEST_MESSAGE("checking " << scan::implementationName());
+      checkAll();
+    }
+  }
+  BOOST_CHECK(scan::setImplementation(best));
+}
+
+BOOST_AUTO_TEST_CASE(testFind)
+{
+  const string line("Host: www.chenshuo.com");
+  const char* end = line.data() + line.size();
+  BOOST_CHECK_EQUAL(scan::find(line.data(), end, ':') - line.data(), 4);
+  BOOST_CHECK(scan::find(line.data(), end, '#') == end);
+}
+
+BOOST_AUTO_TEST_CASE(testBufferFindEOL)
+{
+  Buffer buf;
+  buf.append(string(100000, 'x'));
+  const char* null = NULL;
+  BOOST_CHECK_EQUAL(buf.findEOL(), null);
+  BOOST_CHECK_EQUAL(buf.findCRLF(), null);
+
+  buf.append("\r\n");
+  BOOST_CHECK_EQUAL(buf.findEOL(), buf.peek() + 100001);
+  BOOST_CHECK_EQUAL(buf.findCRLF(), buf.peek() + 100000);
+  BOOST_CHECK_EQUAL(buf.findCRLF(buf.peek() + 100000), buf.peek() + 100000);
+  BOOST_CHECK_EQUAL(buf.findCRLF(buf.peek() + 100001), null);
+}
@@ -0,0 +1,192 @@
+// Broadcasting one message to many connections: send(StringPiece) copies
+// it into every output buffer, send(PayloadPtr) shares a single block.
+//
+// usage: fanout_bench [connections] [messages] [message_kb] [-p]
+//   -p  broadcasts with send(PayloadPtr)
+//
+// The server runs 4 IO threads; a publisher thread pushes each message to
+// all subscribers in a burst and one client thread drains every socket.
+
+#include <muduo/base/Logging.h>
+#include <muduo/base/Mutex.h>
+#include <muduo/base/Thread.h>
+#include <muduo/base/Timestamp.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/InetAddress.h>
+#include <muduo/net/Payload.h>
+#include <muduo/net/SocketsOps.h>
+#include <muduo/net/TcpServer.h>
+
+#include <boost/bind.hpp>
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const uint16_t kPort = 2013;
+
+int g_numConns = 400;
+int g_numMessages = 50;
+size_t g_messageSize = 64*1024;
+bool g_payload = false;
+
+MutexLock g_mutex;
+std::vector<TcpConnectionPtr> g_conns;
+
+void onConnection(const TcpConnectionPtr& conn)
+{
+  MutexLockGuard lock(g_mutex);
+  if (conn->connected())
+  {
+    g_conns.push_back(conn);
+  }
+}
+
+void publish()
+{
+  std::vector<TcpConnectionPtr> conns;
+  while (static_cast<int>(conns.size()) < g_numConns)
+  {
+    ::usleep(10*1000);
+    MutexLockGuard lock(g_mutex);
+    conns = g_conns;
+  }
+  string message(g_messageSize, 'm');
+  for (int i = 0; i < g_numMessages; ++i)
+  {
+    // 每条消息都重新编码一次
+    message[0] = static_cast<char>('a' + i % 26);
+    if (g_payload)
+    {
+      PayloadPtr payload(new Payload(message));
+      for (size_t j = 0; j < conns.size(); ++j)
+      {
+        conns[j]->send(payload);
+      }
+    }
+    else
+    {
+      for (size_t j = 0; j < conns.size(); ++j)
+      {
+        conns[j]->send(message);
+      }
+    }
+  }
+}
+
+void runClient(EventLoop* loop)
+{
+  InetAddress serverAddr("127.0.0.1", kPort);
+  std::vector<struct pollfd> pfds(g_numConns);
+  for (int i = 0; i < g_numConns; ++i)
+  {
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    // 小接收窗口，让消息积压在服务端
+    int rcvbuf = 64*1024;
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof rcvbuf);
+    if (fd < 0 || (sockets::connect(fd, serverAddr.getSockAddrInet()) < 0 && errno != EINPROGRESS))
+    {
+      perror("connect");
+      loop->quit();
+      return;
+    }
+    pfds[i].fd = fd;
+    pfds[i].events = POLLIN;
+  }
+
+  const int64_t expected = static_cast<int64_t>(g_numConns) * g_numMessages
+                           * static_cast<int64_t>(g_messageSize);
+  std::vector<char> buf(256*1024);
+  int64_t received = 0;
+  Timestamp start;
+  while (received < expected)
+  {
+    if (::poll(&pfds[0], pfds.size(), 5000) <= 0)
+    {
+      fprintf(stderr, "timeout, %lld of %lld bytes received\n",
+              static_cast<long long>(received), static_cast<long long>(expected));
+      break;
+    }
+    for (size_t i = 0; i < pfds.size(); ++i)
+    {
+      if (pfds[i].revents & POLLIN)
+      {
+        ssize_t n = ::read(pfds[i].fd, &buf[0], buf.size());
+        if (n > 0)
+        {
+          if (!start.valid())
+          {
+            start = Timestamp::now();
+          }
+          received += n;
+        }
+      }
+    }
+  }
+  double seconds = timeDifference(Timestamp::now(), start);
+  // 拷贝模式下每个连接各有一份消息，峰值内存随订阅者数增长
+  struct rusage usage;
+  ::getrusage(RUSAGE_SELF, &usage);
+  printf("%s: %d connections x %d messages x %zu KiB in %.3f s, %.1f MiB/s, max RSS %.1f MiB\n",
+         g_payload ? "payload" : "copy",
+         g_numConns, g_numMessages, g_messageSize / 1024, seconds,
+         static_cast<double>(received) / (1024*1024) / seconds,
+         static_cast<double>(usage.ru_maxrss) / 1024);
+  for (size_t i = 0; i < pfds.size(); ++i)
+  {
+    ::close(pfds[i].fd);
+  }
+  loop->runAfter(0.1, boost::bind(&EventLoop::quit, loop));
+}
+
+int main(int argc, char* argv[])
+{
+  Logger::setLogLevel(Logger::WARN);
+  int numArgs = 0;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (strcmp(argv[i], "-p") == 0)
+    {
+      g_payload = true;
+    }
+    else if (numArgs == 0)
+    {
+      g_numConns = atoi(argv[i]);
+      ++numArgs;
+    }
+    else if (numArgs == 1)
+    {
+      g_numMessages = atoi(argv[i]);
+      ++numArgs;
+    }
+    else
+    {
+      g_messageSize = static_cast<size_t>(atoi(argv[i])) * 1024;
+    }
+  }
+
+  EventLoop loop;
+  TcpServer server(&loop, InetAddress(kPort), "FanOutBench");
+  server.setConnectionCallback(onConnection);
+  server.setThreadNum(4);
+  server.start();
+
+  Thread publisher(publish, "publisher");
+  publisher.start();
+  Thread client(boost::bind(runClient, &loop), "client");
+  client.start();
+  loop.loop();
+  client.join();
+  publisher.join();
+  MutexLockGuard lock(g_mutex);
+  g_conns.clear();
+}
@@ -0,0 +1,129 @@
+// Measures the resident memory held by each idle TcpConnection.
+//
+// usage: idleconnection_bench [num_connections] [-l]
+//   -l  turns on TcpServer::setLowMemoryMode()
+//
+// The process needs two fds per connection, raise 'ulimit -n' for large runs.
+
+#include <muduo/base/Atomic.h>
+#include <muduo/base/Logging.h>
+#include <muduo/base/Thread.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/InetAddress.h>
+#include <muduo/net/SocketsOps.h>
+#include <muduo/net/TcpServer.h>
+
+#include <boost/bind.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const uint16_t kPort = 2008;
+
+int g_numConns = 400;
+bool g_lowMemory = false;
+AtomicInt32 g_connected;
+AtomicInt32 g_messages;
+
+long residentBytes()
+{
+  long pages = 0;
+  FILE* fp = ::fopen("/proc/self/statm", "r");
+  if (fp)
+  {
+    long size = 0;
+    if (::fscanf(fp, "%ld %ld", &size, &pages) != 2)
+    {
+      pages = 0;
+    }
+    ::fclose(fp);
+  }
+  return pages * ::sysconf(_SC_PAGESIZE);
+}
+
+void onConnection(const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    g_connected.increment();
+  }
+}
+
+void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+{
+  // echo once; the output buffer is empty so the reply goes out with a
+  // direct write, only the input buffer has borrowed storage from the pool
+  conn->send(buf);
+  g_messages.increment();
+}
+
+void runClients(EventLoop* loop)
+{
+  const long before = residentBytes();
+  InetAddress serverAddr("127.0.0.1", kPort);
+  std::vector<int> clients;
+  for (int i = 0; i < g_numConns; ++i)
+  {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0 || sockets::connect(fd, serverAddr.getSockAddrInet()) < 0)
+    {
+      perror("connect");
+      break;
+    }
+    const char msg[] = "ping";
+    char reply[sizeof msg];
+    if (::write(fd, msg, sizeof msg) > 0 && ::read(fd, reply, sizeof reply) < 0)
+    {
+      perror("read");
+    }
+    clients.push_back(fd);
+  }
+
+  const int32_t total = static_cast<int32_t>(clients.size());
+  while (g_connected.get() < total || g_messages.get() < total)
+  {
+    ::usleep(10*1000);
+  }
+  const long after = residentBytes();
+
+  printf("mode %s, %zu connections, RSS +%ld KiB, %.1f bytes per connection\n",
+         g_lowMemory ? "low-memory" : "default",
+         clients.size(),
+         (after - before) / 1024,
+         total == 0 ? 0.0 : static_cast<double>(after - before) / total);
+
+  for (size_t i = 0; i < clients.size(); ++i)
+  {
+    ::close(clients[i]);
+  }
+  loop->quit();
+}
+
+int main(int argc, char* argv[])
+{
+  Logger::setLogLevel(Logger::WARN);
+  if (argc > 1)
+  {
+    g_numConns = atoi(argv[1]);
+  }
+  g_lowMemory = argc > 2 && strcmp(argv[2], "-l") == 0;
+
+  EventLoop loop;
+  TcpServer server(&loop, InetAddress(kPort), "IdleConnectionBench");
+  server.setConnectionCallback(onConnection);
+  server.setMessageCallback(onMessage);
+  server.setLowMemoryMode(g_lowMemory);
+  server.start();
+
+  Thread clients(boost::bind(runClients, &loop), "clients");
+  clients.start();
+  loop.loop();
+  clients.join();
+}
@@ -0,0 +1,230 @@
+#include <muduo/net/Buffer.h>
+#include <muduo/net/LengthHeaderCodec.h>
+
+//#define BOOST_TEST_MODULE LengthHeaderCodecTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using muduo::string;
+using muduo::Timestamp;
+using muduo::net::Buffer;
+using muduo::net::LengthHeaderCodec;
+using muduo::net::TcpConnectionPtr;
+
+namespace
+{
+
+void onFrames(const TcpConnectionPtr&, const LengthHeaderCodec::FrameList&, Timestamp)
+{
+}
+
+// 把若干条消息编码后依次放进一个Buffer
+void appendFrame(const LengthHeaderCodec& codec, Buffer* wire, const string& message)
+{
+  Buffer buf;
+  buf.append(message);
+  codec.encode(&buf);
+  wire->append(buf.peek(), buf.readableBytes());
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(testEncodeInPlace)
+{
+  LengthHeaderCodec codec(onFrames, LengthHeaderCodec::kInt32);
+  Buffer buf;
+  buf.append("hello", 5);
+  const char* data = buf.peek();
+  codec.encode(&buf);
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 9);
+  BOOST_CHECK_EQUAL(buf.peek() + 4, data);
+  BOOST_CHECK_EQUAL(buf.prependableBytes(), Buffer::kCheapPrepend - 4);
+  BOOST_CHECK_EQUAL(buf.peekInt32(), 5);
+
+  LengthHeaderCodec codec64(onFrames, LengthHeaderCodec::kInt64);
+  Buffer buf64;
+  buf64.append("hello", 5);
+  codec64.encode(&buf64);
+  BOOST_CHECK_EQUAL(buf64.prependableBytes(), 0);
+  BOOST_CHECK_EQUAL(buf64.readInt64(), 5);
+  BOOST_CHECK_EQUAL(buf64.retrieveAllAsString(), "hello");
+}
+
+BOOST_AUTO_TEST_CASE(testEncodeWithoutRoom)
+{
+  LengthHeaderCodec codec(onFrames, LengthHeaderCodec::kInt64);
+  Buffer buf;
+  buf.append("world", 5);
+  // 前面已经放了一个字节，剩下的不够放8字节的头
+  buf.prependInt8(3);
+  BOOST_CHECK_EQUAL(buf.prependableBytes(), Buffer::kCheapPrepend - 1);
+  codec.encode(&buf);
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 14);
+  BOOST_CHECK_EQUAL(buf.readInt64(), 6);
+  BOOST_CHECK_EQUAL(buf.readInt8(), 3);
+  BOOST_CHECK_EQUAL(buf.retrieveAllAsString(), "world");
+}
+
+BOOST_AUTO_TEST_CASE(testDecodeBatch)
+{
+  const LengthHeaderCodec::HeaderFormat formats[] = {
+    LengthHeaderCodec::kInt8,
+    LengthHeaderCodec::kInt16,
+    LengthHeaderCodec::kInt32,
+    LengthHeaderCodec::kInt64,
+    LengthHeaderCodec::kVarint,
+  };
+  for (size_t f = 0; f < sizeof formats / sizeof formats[0]; ++f)
+  {
+    LengthHeaderCodec codec(onFrames, formats[f], 200);
+    Buffer wire;
+    appendFrame(codec, &wire, "");
+    appendFrame(codec, &wire, "a");
+    appendFrame(codec, &wire, string(200, 'b'));
+    appendFrame(codec, &wire, "tail");
+    const size_t total = wire.readableBytes();
+
+    LengthHeaderCodec::FrameList frames;
+    size_t consumed = 0;
+    size_t pending = 0;
+    BOOST_CHECK_EQUAL(codec.decode(&wire, &frames, &consumed, &pending),
+                      LengthHeaderCodec::kNoError);
+    BOOST_REQUIRE_EQUAL(frames.size(), 4);
+    BOOST_CHECK_EQUAL(frames[0].size(), 0);
+    BOOST_CHECK_EQUAL(frames[1].as_string(), "a");
+    BOOST_CHECK_EQUAL(frames[2].as_string(), string(200, 'b'));
+    BOOST_CHECK_EQUAL(frames[3].as_string(), "tail");
+    // 切片直接指向Buffer
+    BOOST_CHECK(frames[3].data() + 4 == wire.peek() + total);
+    BOOST_CHECK_EQUAL(consumed, total);
+    BOOST_CHECK_EQUAL(pending, 0);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testDecodePartial)
+{
+  LengthHeaderCodec codec(onFrames, LengthHeaderCodec::kInt32);
+  Buffer wire;
+  appendFrame(codec, &wire, "first");
+  appendFrame(codec, &wire, "second");
+
+  // 每次多给一个字节
+  for (size_t len = 0; len <= wire.readableBytes(); ++len)
+  {
+    Buffer partial;
+    partial.append(wire.peek(), len);
+    LengthHeaderCodec::FrameList frames;
+    size_t consumed = 0;
+    size_t pending = 0;
+    BOOST_CHECK_EQUAL(codec.decode(&partial, &frames, &consumed, &pending),
+                      LengthHeaderCodec::kNoError);
+    if (len < 4)
+    {
+      BOOST_CHECK_EQUAL(frames.size(), 0);
+      BOOST_CHECK_EQUAL(pending, 0);
+    }
+    else if (len < 9)
+    {
+      BOOST_CHECK_EQUAL(frames.size(), 0);
+      BOOST_CHECK_EQUAL(pending, 9);
+    }
+    else if (len < 13)
+    {
+      BOOST_CHECK_EQUAL(frames.size(), 1);
+      BOOST_CHECK_EQUAL(consumed, 9);
+      BOOST_CHECK_EQUAL(pending, 0);
+    }
+    else if (len < 19)
+    {
+      BOOST_CHECK_EQUAL(frames.size(), 1);
+      BOOST_CHECK_EQUAL(consumed, 9);
+      BOOST_CHECK_EQUAL(pending, 10);
+    }
+    else
+    {
+      BOOST_CHECK_EQUAL(frames.size(), 2);
+      BOOST_CHECK_EQUAL(consumed, 19);
+      BOOST_CHECK_EQUAL(pending, 0);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testVarint)
+{
+  LengthHeaderCodec codec(onFrames, LengthHeaderCodec::kVarint);
+  const size_t lengths[] = { 0, 127, 128, 300, 16383, 16384, 1000000 };
+  const size_t headers[] = { 1, 1, 2, 2, 2, 3, 3 };
+  for (size_t i = 0; i < sizeof lengths / sizeof lengths[0]; ++i)
+  {
+    Buffer buf;
+    buf.append(string(lengths[i], 'v'));
+    codec.encode(&buf);
+    BOOST_CHECK_EQUAL(buf.readableBytes(), lengths[i] + headers[i]);
+
+    LengthHeaderCodec::FrameList frames;
+    size_t consumed = 0;
+    size_t pending = 0;
+    codec.decode(&buf, &frames, &consumed, &pending);
+    BOOST_REQUIRE_EQUAL(frames.size(), 1);
+    BOOST_CHECK_EQUAL(frames[0].size(), static_cast<int>(lengths[i]));
+  }
+
+  // 300 = 0xac 0x02
+  Buffer buf;
+  buf.append(string(300, 'v'));
+  codec.encode(&buf);
+  BOOST_CHECK_EQUAL(static_cast<uint8_t>(buf.peek()[0]), 0xac);
+  BOOST_CHECK_EQUAL(static_cast<uint8_t>(buf.peek()[1]), 0x02);
+}
+
+BOOST_AUTO_TEST_CASE(testErrors)
+{
+  LengthHeaderCodec codec(onFrames, LengthHeaderCodec::kInt16, 100);
+  Buffer wire;
+  appendFrame(codec, &wire, "ok");
+  wire.appendInt16(101);
+  wire.append(string(101, 'x'));
+
+  LengthHeaderCodec::FrameList frames;
+  size_t consumed = 0;
+  size_t pending = 0;
+  BOOST_CHECK_EQUAL(codec.decode(&wire, &frames, &consumed, &pending),
+                    LengthHeaderCodec::kFrameTooLong);
+  BOOST_CHECK_EQUAL(frames.size(), 1);
+  BOOST_CHECK_EQUAL(consumed, 4);
+
+  LengthHeaderCodec varint(onFrames, LengthHeaderCodec::kVarint);
+  Buffer bad;
+  bad.append(string(LengthHeaderCodec::kMaxVarintLength - 1, '\xff'));
+  frames.clear();
+  BOOST_CHECK_EQUAL(varint.decode(&bad, &frames, &consumed, &pending),
+                    LengthHeaderCodec::kNoError);
+  bad.append("\xff", 1);
+  BOOST_CHECK_EQUAL(varint.decode(&bad, &frames, &consumed, &pending),
+                    LengthHeaderCodec::kInvalidVarint);
+  BOOST_CHECK_EQUAL(frames.size(), 0);
+}
+
+// 默认的上限比一两个字节的头能表示的大，要收到头能表示的最大值
+BOOST_AUTO_TEST_CASE(testDefaultMaxFrameLength)
+{
+  LengthHeaderCodec codec8(onFrames, LengthHeaderCodec::kInt8);
+  BOOST_CHECK_EQUAL(codec8.maxFrameLength(), 255);
+  LengthHeaderCodec codec16(onFrames, LengthHeaderCodec::kInt16);
+  BOOST_CHECK_EQUAL(codec16.maxFrameLength(), 65535);
+  LengthHeaderCodec codec32(onFrames, LengthHeaderCodec::kInt32);
+  BOOST_CHECK_EQUAL(codec32.maxFrameLength(), 64*1024*1024);
+
+  // 最长的帧还能编解码
+  Buffer wire;
+  appendFrame(codec8, &wire, string(255, 'x'));
+  LengthHeaderCodec::FrameList frames;
+  size_t consumed = 0;
+  size_t pending = 0;
+  BOOST_CHECK_EQUAL(codec8.decode(&wire, &frames, &consumed, &pending),
+                    LengthHeaderCodec::kNoError);
+  BOOST_REQUIRE_EQUAL(frames.size(), 1);
+  BOOST_CHECK_EQUAL(frames[0].size(), 255);
+  BOOST_CHECK_EQUAL(consumed, 256);
+}
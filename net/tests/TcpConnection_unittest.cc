@@ -0,0 +1,563 @@
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/TcpClient.h>
+#include <muduo/net/TcpServer.h>
+
+//#define BOOST_TEST_MODULE TcpConnectionTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <linux/capability.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using muduo::string;
+using muduo::StringPiece;
+using muduo::Timestamp;
+using muduo::net::Buffer;
+using muduo::net::EventLoop;
+using muduo::net::InetAddress;
+using muduo::net::Payload;
+using muduo::net::PayloadPtr;
+using muduo::net::TcpClient;
+using muduo::net::TcpConnectionPtr;
+using muduo::net::TcpServer;
+using muduo::net::TcpConnection;
+
+namespace
+{
+
+const size_t kHighWaterMark = 1024;
+const size_t kReply = 64*1024;
+const int kRounds = 3;
+
+// 服务端合并写，每收到一个字节回复kReply字节，超过高水位标时暂停读自己，
+// 客户端收齐一轮回复后再发下一个字节
+struct CorkedEcho
+{
+  CorkedEcho() : loop(NULL), rounds(0), highWaterMarks(0), lowWaterMarks(0), received(0) { }
+
+  void onServerConnection(const TcpConnectionPtr& conn)
+  {
+    if (conn->connected())
+    {
+      conn->setWriteCoalescing(true);
+      conn->setHighWaterMarkCallback(boost::bind(&CorkedEcho::onHighWaterMark, this), kHighWaterMark);
+      conn->setLowWaterMarkCallback(boost::bind(&CorkedEcho::onLowWaterMark, this), 0);
+      conn->setFlowControlPeer(conn);
+    }
+  }
+
+  void onServerMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+  {
+    buf->retrieveAll();
+    conn->send(string(kReply, 'x'));
+  }
+
+  void onHighWaterMark() { ++highWaterMarks; }
+  void onLowWaterMark() { ++lowWaterMarks; }
+
+  void onClientConnection(const TcpConnectionPtr& conn)
+  {
+    if (conn->connected())
+    {
+      conn->send("a", 1);
+    }
+  }
+
+  void onClientMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+  {
+    received += buf->readableBytes();
+    buf->retrieveAll();
+    if (received == kReply)
+    {
+      received = 0;
+      if (++rounds == kRounds)
+      {
+        loop->quit();
+      }
+      else
+      {
+        conn->send("a", 1);
+      }
+    }
+  }
+
+  EventLoop* loop;
+  int rounds;
+  int highWaterMarks;
+  int lowWaterMarks;
+  size_t received;
+};
+
+// 服务端用sendFile发送一个管道，sendfile(2)读不了管道，连接应该被关掉而不是忙等
+struct SendPipe
+{
+  SendPipe() : loop(NULL), disconnected(false) { }
+
+  void onServerConnection(const TcpConnectionPtr& conn)
+  {
+    if (conn->connected())
+    {
+      int fds[2];
+      BOOST_REQUIRE(::pipe(fds) == 0);
+      BOOST_REQUIRE(::write(fds[1], "hello", 5) == 5);
+      conn->sendFile(fds[0], 0, 5);
+      ::close(fds[0]);
+      ::close(fds[1]);
+    }
+  }
+
+  void onClientConnection(const TcpConnectionPtr& conn)
+  {
+    if (!conn->connected())
+    {
+      disconnected = true;
+      loop->quit();
+    }
+  }
+
+  EventLoop* loop;
+  bool disconnected;
+};
+
+const size_t kFlood = 16*1024*1024;
+
+// 服务端的source连接以sink连接为流控对端，sink的客户端不读，sink超过高水位标后source暂停读；
+// sink的客户端断开以后source必须恢复读，否则source的客户端发的数据永远收不到
+struct PeerClose
+{
+  PeerClose()
+    : loop(NULL), sinkClient(NULL), sourceClient(NULL),
+      sourcePausedBeforeClose(false), sourceReceived(false)
+  {
+  }
+
+  void onServerConnection(const TcpConnectionPtr& conn)
+  {
+    if (!conn->connected())
+    {
+      return;
+    }
+    if (!sink)
+    {
+      sink = conn;
+      sink->setHighWaterMarkCallback(muduo::net::HighWaterMarkCallback(), 1);
+      sourceClient->connect();
+    }
+    else
+    {
+      source = conn;
+      source->setFlowControlPeer(sink);
+      sink->send(string(kFlood, 'x'));
+      loop->queueInLoop(boost::bind(&PeerClose::closeSink, this));
+    }
+  }
+
+  void closeSink()
+  {
+    sourcePausedBeforeClose = !source->isReading();
+    sinkClient->connection()->forceClose();
+  }
+
+  void onServerMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+  {
+    buf->retrieveAll();
+    if (conn == source)
+    {
+      sourceReceived = true;
+      loop->quit();
+    }
+  }
+
+  void onSinkClientConnection(const TcpConnectionPtr& conn)
+  {
+    if (conn->connected())
+    {
+      conn->stopRead();
+    }
+    else
+    {
+      sourceClient->connection()->send("a", 1);
+    }
+  }
+
+  EventLoop* loop;
+  TcpClient* sinkClient;
+  TcpClient* sourceClient;
+  TcpConnectionPtr sink;
+  TcpConnectionPtr source;
+  bool sourcePausedBeforeClose;
+  bool sourceReceived;
+};
+
+// 每个位置的字节都不一样，发送顺序错了就对不上
+string makeStream(size_t len)
+{
+  string stream(len, '\0');
+  for (size_t i = 0; i < len; ++i)
+  {
+    stream[i] = static_cast<char>((i * 2654435761u) >> 24);
+  }
+  return stream;
+}
+
+// 在kFileOffset处写入data，返回已经unlink的临时文件
+const off_t kFileOffset = 4096;
+
+int makeFile(const string& data)
+{
+  char name[] = "/tmp/tcpconnection_unittest_XXXXXX";
+  int fd = ::mkstemp(name);
+  BOOST_REQUIRE(fd >= 0);
+  ::unlink(name);
+  string junk(kFileOffset, '#');
+  BOOST_REQUIRE(::write(fd, junk.data(), junk.size()) == static_cast<ssize_t>(junk.size()));
+  BOOST_REQUIRE(::write(fd, data.data(), data.size()) == static_cast<ssize_t>(data.size()));
+  return fd;
+}
+
+// 服务端连上以后调用send把数据用各种方式发出去然后shutdown，两端都断开为止；
+// 服务端的发送缓冲区很小，每种方式都要分好几次才写得完
+struct StreamCheck
+{
+  typedef boost::function<void (const TcpConnectionPtr&)> SendFunction;
+
+  StreamCheck()
+    : loop(NULL), zeroCopyThreshold(0), disconnected(false), serverDisconnected(false)
+  {
+  }
+
+  void onServerConnection(const TcpConnectionPtr& conn)
+  {
+    if (conn->connected())
+    {
+      int sndbuf = 16*1024;
+      ::setsockopt(conn->fd(), SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof sndbuf);
+      send(conn);
+      conn->shutdown();
+    }
+    else
+    {
+      serverDisconnected = true;
+      quitIfDone();
+    }
+  }
+
+  void onClientConnection(const TcpConnectionPtr& conn)
+  {
+    if (!conn->connected())
+    {
+      disconnected = true;
+      quitIfDone();
+    }
+  }
+
+  void quitIfDone()
+  {
+    if (disconnected && serverDisconnected)
+    {
+      loop->quit();
+    }
+  }
+
+  void onClientMessage(const TcpConnectionPtr&, Buffer* buf, Timestamp)
+  {
+    received.append(buf->peek(), buf->readableBytes());
+    buf->retrieveAll();
+  }
+
+  void run(uint16_t port)
+  {
+    EventLoop eventLoop;
+    loop = &eventLoop;
+    TcpServer server(&eventLoop, InetAddress(port), "StreamCheck");
+    server.setZeroCopyThreshold(zeroCopyThreshold);
+    server.setConnectionCallback(boost::bind(&StreamCheck::onServerConnection, this, _1));
+    server.start();
+
+    TcpClient client(&eventLoop, InetAddress("127.0.0.1", port), "StreamCheckClient");
+    client.setConnectionCallback(boost::bind(&StreamCheck::onClientConnection, this, _1));
+    client.setMessageCallback(boost::bind(&StreamCheck::onClientMessage, this, _1, _2, _3));
+    client.connect();
+
+    eventLoop.runAfter(10.0, boost::bind(&EventLoop::quit, &eventLoop));
+    eventLoop.loop();
+    loop = NULL;
+  }
+
+  EventLoop* loop;
+  SendFunction send;
+  size_t zeroCopyThreshold;
+  bool disconnected;
+  bool serverDisconnected;
+  string received;
+};
+
+void sendString(const TcpConnectionPtr& conn, const string& stream, size_t begin, size_t end)
+{
+  conn->send(stream.data() + begin, end - begin);
+}
+
+void sendBuffer(const TcpConnectionPtr& conn, const string& stream, size_t begin, size_t end)
+{
+  Buffer buf;
+  buf.append(stream.data() + begin, end - begin);
+  conn->send(&buf);
+}
+
+// 文件里stream的begin字节在kFileOffset + begin处
+void sendFileRange(const TcpConnectionPtr& conn, int fd, size_t begin, size_t end)
+{
+  conn->sendFile(fd, kFileOffset + begin, end - begin);
+}
+
+const size_t kFileStream = 1300*1000;
+
+void sendWithFiles(const string* stream, int fd, const TcpConnectionPtr& conn)
+{
+  sendFileRange(conn, fd, 0, 200*1000);
+  sendString(conn, *stream, 200*1000, 500*1000);
+  sendFileRange(conn, fd, 500*1000, 1000*1000);
+  sendBuffer(conn, *stream, 1000*1000, 1100*1000);
+  sendFileRange(conn, fd, 1100*1000, 1299*1000);
+  sendFileRange(conn, fd, 1299*1000, 1299*1000 + 999);
+  sendString(conn, *stream, 1299*1000 + 999, kFileStream);
+}
+
+void sendPayload(const TcpConnectionPtr& conn, const string& stream, size_t begin, size_t end)
+{
+  PayloadPtr payload(new Payload(StringPiece(stream.data() + begin, static_cast<int>(end - begin))));
+  conn->send(payload);
+}
+
+const size_t kPayloadStream = 1000*1000 + 10;
+
+// 第一段写不完，剩下的留在outputBuffer_，Payload段和它后面send的数据
+// 在handleWrite里一起writev，每次都只写出一部分
+void sendWithPayloads(const string* stream, const TcpConnectionPtr& conn)
+{
+  sendString(conn, *stream, 0, 300*1000);
+  sendPayload(conn, *stream, 300*1000, 600*1000);
+  sendString(conn, *stream, 600*1000, 700*1000);
+  sendPayload(conn, *stream, 700*1000, 700*1000 + 1);
+  sendPayload(conn, *stream, 700*1000 + 1, 1000*1000);
+  sendString(conn, *stream, 1000*1000, kPayloadStream);
+}
+
+const size_t kZeroCopyThreshold = 64*1024;
+const size_t kZeroCopyStream = 1000*1000;
+
+// 大于kZeroCopyThreshold的Buffer用MSG_ZEROCOPY发送，和其它方式交错
+void sendWithZeroCopy(const string* stream, const TcpConnectionPtr& conn)
+{
+  sendBuffer(conn, *stream, 0, 200*1000);
+  sendString(conn, *stream, 200*1000, 300*1000);
+  sendBuffer(conn, *stream, 300*1000, 310*1000);
+  sendBuffer(conn, *stream, 310*1000, 800*1000);
+  sendPayload(conn, *stream, 800*1000, 900*1000);
+  sendBuffer(conn, *stream, 900*1000, kZeroCopyStream);
+}
+
+// 可锁定内存的上限为0时MSG_ZEROCOPY发送返回ENOBUFS，只能退回普通拷贝；
+// root有CAP_IPC_LOCK不受这个上限约束，要先从本线程的effective集合里去掉
+class NoLockedMemory : boost::noncopyable
+{
+ public:
+  NoLockedMemory()
+  {
+    ::getrlimit(RLIMIT_MEMLOCK, &savedLimit_);
+    struct rlimit limit = savedLimit_;
+    limit.rlim_cur = 0;
+    ::setrlimit(RLIMIT_MEMLOCK, &limit);
+
+    bzero(&header_, sizeof header_);
+    header_.version = _LINUX_CAPABILITY_VERSION_3;
+    bzero(savedCaps_, sizeof savedCaps_);
+    capsSaved_ = ::syscall(SYS_capget, &header_, savedCaps_) == 0;
+    if (capsSaved_)
+    {
+      struct __user_cap_data_struct caps[_LINUX_CAPABILITY_U32S_3];
+      ::memcpy(caps, savedCaps_, sizeof caps);
+      caps[CAP_TO_INDEX(CAP_IPC_LOCK)].effective &= ~CAP_TO_MASK(CAP_IPC_LOCK);
+      ::syscall(SYS_capset, &header_, caps);
+    }
+  }
+
+  ~NoLockedMemory()
+  {
+    if (capsSaved_)
+    {
+      ::syscall(SYS_capset, &header_, savedCaps_);
+    }
+    ::setrlimit(RLIMIT_MEMLOCK, &savedLimit_);
+  }
+
+ private:
+  struct rlimit savedLimit_;
+  struct __user_cap_header_struct header_;
+  struct __user_cap_data_struct savedCaps_[_LINUX_CAPABILITY_U32S_3];
+  bool capsSaved_;
+};
+
+// 文件只有前100K，sendFile要的更多；之后send的数据不能发出去
+const size_t kShortFile = 100*1000;
+
+void sendShortFile(const string* stream, int fd, const TcpConnectionPtr& conn)
+{
+  sendString(conn, *stream, 0, 1000);
+  sendFileRange(conn, fd, 1000, 2*kShortFile);
+  sendString(conn, *stream, 2*kShortFile, 3*kShortFile);
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(testCorkedFlowControl)
+{
+  EventLoop loop;
+  CorkedEcho echo;
+  echo.loop = &loop;
+  InetAddress addr(23461);
+  TcpServer server(&loop, addr, "CorkedEcho");
+  server.setConnectionCallback(boost::bind(&CorkedEcho::onServerConnection, &echo, _1));
+  server.setMessageCallback(boost::bind(&CorkedEcho::onServerMessage, &echo, _1, _2, _3));
+  server.start();
+
+  TcpClient client(&loop, InetAddress("127.0.0.1", 23461), "CorkedClient");
+  client.setConnectionCallback(boost::bind(&CorkedEcho::onClientConnection, &echo, _1));
+  client.setMessageCallback(boost::bind(&CorkedEcho::onClientMessage, &echo, _1, _2, _3));
+  client.connect();
+
+  // 服务端一直暂停读的话，第二轮就不会开始
+  loop.runAfter(3.0, boost::bind(&EventLoop::quit, &loop));
+  loop.loop();
+
+  BOOST_CHECK_EQUAL(echo.rounds, kRounds);
+  BOOST_CHECK_EQUAL(echo.highWaterMarks, kRounds);
+  BOOST_CHECK_EQUAL(echo.lowWaterMarks, kRounds);
+  client.disconnect();
+}
+
+BOOST_AUTO_TEST_CASE(testSendFileFromPipe)
+{
+  EventLoop loop;
+  SendPipe sendPipe;
+  sendPipe.loop = &loop;
+  InetAddress addr(23462);
+  TcpServer server(&loop, addr, "SendPipe");
+  server.setConnectionCallback(boost::bind(&SendPipe::onServerConnection, &sendPipe, _1));
+  server.start();
+
+  TcpClient client(&loop, InetAddress("127.0.0.1", 23462), "SendPipeClient");
+  client.setConnectionCallback(boost::bind(&SendPipe::onClientConnection, &sendPipe, _1));
+  client.connect();
+
+  loop.runAfter(3.0, boost::bind(&EventLoop::quit, &loop));
+  loop.loop();
+
+  BOOST_CHECK(sendPipe.disconnected);
+}
+
+BOOST_AUTO_TEST_CASE(testFlowControlPeerClose)
+{
+  EventLoop loop;
+  PeerClose peerClose;
+  peerClose.loop = &loop;
+  InetAddress addr(23463);
+  TcpServer server(&loop, addr, "PeerClose");
+  server.setConnectionCallback(boost::bind(&PeerClose::onServerConnection, &peerClose, _1));
+  server.setMessageCallback(boost::bind(&PeerClose::onServerMessage, &peerClose, _1, _2, _3));
+  server.start();
+
+  TcpClient sinkClient(&loop, InetAddress("127.0.0.1", 23463), "SinkClient");
+  sinkClient.setConnectionCallback(boost::bind(&PeerClose::onSinkClientConnection, &peerClose, _1));
+  TcpClient sourceClient(&loop, InetAddress("127.0.0.1", 23463), "SourceClient");
+  peerClose.sinkClient = &sinkClient;
+  peerClose.sourceClient = &sourceClient;
+  sinkClient.connect();
+
+  loop.runAfter(3.0, boost::bind(&EventLoop::quit, &loop));
+  loop.loop();
+
+  BOOST_CHECK(peerClose.sourcePausedBeforeClose);
+  BOOST_CHECK(peerClose.sourceReceived);
+  peerClose.sink.reset();
+  peerClose.source.reset();
+}
+
+BOOST_AUTO_TEST_CASE(testSendFileInOrder)
+{
+  string stream(makeStream(kFileStream));
+  int fd = makeFile(stream);
+  StreamCheck check;
+  check.send = boost::bind(sendWithFiles, &stream, fd, _1);
+  check.run(23464);
+  ::close(fd);
+
+  BOOST_CHECK(check.disconnected);
+  BOOST_CHECK_EQUAL(check.received.size(), stream.size());
+  BOOST_CHECK(check.received == stream);
+}
+
+BOOST_AUTO_TEST_CASE(testSendFileShortFile)
+{
+  string stream(makeStream(3*kShortFile));
+  int fd = makeFile(stream.substr(0, kShortFile));
+  StreamCheck check;
+  check.send = boost::bind(sendShortFile, &stream, fd, _1);
+  check.run(23465);
+  ::close(fd);
+
+  // 文件后面的数据没有发出去，连接被关闭
+  BOOST_CHECK(check.disconnected);
+  BOOST_CHECK_EQUAL(check.received.size(), kShortFile);
+  BOOST_CHECK(check.received == stream.substr(0, kShortFile));
+}
+
+BOOST_AUTO_TEST_CASE(testSendPayloadInOrder)
+{
+  string stream(makeStream(kPayloadStream));
+  StreamCheck check;
+  check.send = boost::bind(sendWithPayloads, &stream, _1);
+  check.run(23466);
+
+  BOOST_CHECK(check.disconnected);
+  BOOST_CHECK_EQUAL(check.received.size(), stream.size());
+  BOOST_CHECK(check.received == stream);
+}
+
+BOOST_AUTO_TEST_CASE(testSendZeroCopyInOrder)
+{
+  string stream(makeStream(kZeroCopyStream));
+  StreamCheck check;
+  check.zeroCopyThreshold = kZeroCopyThreshold;
+  check.send = boost::bind(sendWithZeroCopy, &stream, _1);
+  check.run(23467);
+
+  BOOST_CHECK(check.disconnected);
+  BOOST_CHECK_EQUAL(check.received.size(), stream.size());
+  BOOST_CHECK(check.received == stream);
+}
+
+BOOST_AUTO_TEST_CASE(testSendZeroCopyFallback)
+{
+  NoLockedMemory noLockedMemory;
+  string stream(makeStream(kZeroCopyStream));
+  StreamCheck check;
+  check.zeroCopyThreshold = kZeroCopyThreshold;
+  check.send = boost::bind(sendWithZeroCopy, &stream, _1);
+  check.run(23468);
+
+  BOOST_CHECK(check.disconnected);
+  BOOST_CHECK_EQUAL(check.received.size(), stream.size());
+  BOOST_CHECK(check.received == stream);
+}
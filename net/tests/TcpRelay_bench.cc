@@ -0,0 +1,173 @@
+// Throughput of a TCP relay: splice based TcpRelay vs. relaying through Buffers.
+//
+// usage: tcprelay_bench [total_mb] [-b]
+//   -b  relays through messageCallback and send() instead of TcpRelay
+//
+// client --> relay (port 2011) --> backend (port 2010), all on loopback.
+
+#include <muduo/base/Logging.h>
+#include <muduo/base/Thread.h>
+#include <muduo/base/Timestamp.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/InetAddress.h>
+#include <muduo/net/SocketsOps.h>
+#include <muduo/net/TcpClient.h>
+#include <muduo/net/TcpRelay.h>
+#include <muduo/net/TcpServer.h>
+
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const uint16_t kBackendPort = 2010;
+const uint16_t kRelayPort = 2011;
+
+int64_t g_totalBytes = 1024LL*1024*1024;
+bool g_buffered = false;
+int64_t g_received = 0;
+Timestamp g_start;
+std::vector<boost::shared_ptr<TcpClient> > g_clients;
+
+// backend: counts and discards
+void onBackendMessage(EventLoop* loop, const TcpConnectionPtr&, Buffer* buf, Timestamp)
+{
+  g_received += static_cast<int64_t>(buf->readableBytes());
+  buf->retrieveAll();
+  if (g_received >= g_totalBytes)
+  {
+    double seconds = timeDifference(Timestamp::now(), g_start);
+    printf("%s: %.1f MiB in %.3f s, %.1f MiB/s\n",
+           g_buffered ? "buffered" : "splice",
+           static_cast<double>(g_received) / (1024*1024), seconds,
+           static_cast<double>(g_received) / (1024*1024) / seconds);
+    loop->quit();
+  }
+}
+
+void forward(const boost::weak_ptr<TcpConnection>& weakPeer,
+             const TcpConnectionPtr&, Buffer* buf, Timestamp)
+{
+  TcpConnectionPtr peer(weakPeer.lock());
+  if (peer)
+  {
+    peer->send(buf);
+  }
+  else
+  {
+    buf->retrieveAll();
+  }
+}
+
+void onRelayedConnection(const boost::weak_ptr<TcpConnection>& weakClientConn,
+                         const TcpConnectionPtr& backendConn)
+{
+  TcpConnectionPtr clientConn(weakClientConn.lock());
+  if (!clientConn)
+  {
+    return;
+  }
+  if (!backendConn->connected())
+  {
+    clientConn->forceClose();
+    return;
+  }
+  if (g_buffered)
+  {
+    backendConn->setHighWaterMarkCallback(HighWaterMarkCallback(), 1024*1024);
+    clientConn->setHighWaterMarkCallback(HighWaterMarkCallback(), 1024*1024);
+    clientConn->setFlowControlPeer(backendConn);
+    backendConn->setFlowControlPeer(clientConn);
+    clientConn->setMessageCallback(
+        boost::bind(forward, boost::weak_ptr<TcpConnection>(backendConn), _1, _2, _3));
+    backendConn->setMessageCallback(
+        boost::bind(forward, weakClientConn, _1, _2, _3));
+  }
+  else
+  {
+    TcpRelay::start(clientConn, backendConn);
+  }
+  clientConn->startRead();
+}
+
+void onRelayConnection(EventLoop* loop, const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    // 后端连上之前先不读
+    conn->stopRead();
+    boost::shared_ptr<TcpClient> client(
+        new TcpClient(loop, InetAddress("127.0.0.1", kBackendPort), "backend"));
+    client->setConnectionCallback(
+        boost::bind(onRelayedConnection, boost::weak_ptr<TcpConnection>(conn), _1));
+    client->connect();
+    g_clients.push_back(client);
+  }
+}
+
+void runClient()
+{
+  InetAddress relayAddr("127.0.0.1", kRelayPort);
+  int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0 || sockets::connect(fd, relayAddr.getSockAddrInet()) < 0)
+  {
+    perror("connect");
+    return;
+  }
+  std::vector<char> buf(256*1024, 'r');
+  g_start = Timestamp::now();
+  int64_t sent = 0;
+  while (sent < g_totalBytes)
+  {
+    ssize_t n = ::write(fd, &buf[0], buf.size());
+    if (n <= 0)
+    {
+      perror("write");
+      break;
+    }
+    sent += n;
+  }
+  // 等服务端退出再关闭
+  char c;
+  while (::read(fd, &c, 1) > 0)
+  {
+  }
+  ::close(fd);
+}
+
+int main(int argc, char* argv[])
+{
+  Logger::setLogLevel(Logger::WARN);
+  for (int i = 1; i < argc; ++i)
+  {
+    if (strcmp(argv[i], "-b") == 0)
+    {
+      g_buffered = true;
+    }
+    else
+    {
+      g_totalBytes = static_cast<int64_t>(atoi(argv[i])) * 1024 * 1024;
+    }
+  }
+
+  EventLoop loop;
+  TcpServer backend(&loop, InetAddress(kBackendPort), "backend");
+  backend.setMessageCallback(boost::bind(onBackendMessage, &loop, _1, _2, _3));
+  backend.start();
+  TcpServer relay(&loop, InetAddress(kRelayPort), "relay");
+  relay.setConnectionCallback(boost::bind(onRelayConnection, &loop, _1));
+  relay.start();
+
+  Thread client(runClient, "client");
+  client.start();
+  loop.loop();
+  g_clients.clear();
+}
@@ -0,0 +1,156 @@
+// Write syscalls per request when a reply is sent in several pieces,
+// with and without TcpConnection::setWriteCoalescing().
+//
+// usage: writecoalescing_bench [num_requests] [-c]
+//   -c  turns on TcpServer::setWriteCoalescing()
+//
+// Counts syscw of the server thread from /proc/thread-self/io.
+
+#include <muduo/base/Logging.h>
+#include <muduo/base/Thread.h>
+#include <muduo/base/Timestamp.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/InetAddress.h>
+#include <muduo/net/SocketsOps.h>
+#include <muduo/net/TcpServer.h>
+
+#include <boost/bind.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const uint16_t kPort = 2012;
+const char kHeader[] = "HEADER 0123456789\r\n";
+const char kBody[] = "body body body body body body body body\r\n";
+const char kTrailer[] = "END\r\n";
+const size_t kReplyLen = sizeof kHeader - 1 + sizeof kBody - 1 + sizeof kTrailer - 1;
+
+int g_numRequests = 100000;
+bool g_coalescing = false;
+int g_served = 0;
+long g_syscwStart = 0;
+Timestamp g_start;
+
+long writeSyscalls()
+{
+  long syscw = 0;
+  FILE* fp = ::fopen("/proc/thread-self/io", "r");
+  if (fp)
+  {
+    char line[256];
+    while (::fgets(line, sizeof line, fp))
+    {
+      if (::sscanf(line, "syscw: %ld", &syscw) == 1)
+      {
+        break;
+      }
+    }
+    ::fclose(fp);
+  }
+  return syscw;
+}
+
+void onConnection(const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    // 否则Nagle和延迟ACK会让未合并的回复每次等40ms
+    conn->setTcpNoDelay(true);
+  }
+}
+
+void onMessage(EventLoop* loop, const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+{
+  if (g_served == 0)
+  {
+    g_syscwStart = writeSyscalls();
+    g_start = Timestamp::now();
+  }
+  const char* crlf = NULL;
+  while ((crlf = buf->findCRLF()) != NULL)
+  {
+    buf->retrieveUntil(crlf + 2);
+    // 一个回复分三次send
+    conn->send(kHeader, sizeof kHeader - 1);
+    conn->send(kBody, sizeof kBody - 1);
+    conn->send(kTrailer, sizeof kTrailer - 1);
+    ++g_served;
+  }
+  if (g_served >= g_numRequests)
+  {
+    double seconds = timeDifference(Timestamp::now(), g_start);
+    // 合并写模式下最后一个回复还没flush，quit()之后本轮仍会执行
+    loop->quit();
+    long syscw = writeSyscalls() - g_syscwStart;
+    printf("%s: %d requests in %.3f s, %.2f write syscalls per request\n",
+           g_coalescing ? "coalescing" : "default",
+           g_served, seconds, static_cast<double>(syscw) / g_served);
+  }
+}
+
+void runClient()
+{
+  InetAddress serverAddr("127.0.0.1", kPort);
+  int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0 || sockets::connect(fd, serverAddr.getSockAddrInet()) < 0)
+  {
+    perror("connect");
+    return;
+  }
+  char reply[kReplyLen];
+  for (int i = 0; i < g_numRequests; ++i)
+  {
+    if (::write(fd, "GET\r\n", 5) != 5)
+    {
+      perror("write");
+      break;
+    }
+    size_t got = 0;
+    while (got < kReplyLen)
+    {
+      ssize_t n = ::read(fd, reply + got, kReplyLen - got);
+      if (n <= 0)
+      {
+        perror("read");
+        ::close(fd);
+        return;
+      }
+      got += n;
+    }
+  }
+  ::close(fd);
+}
+
+int main(int argc, char* argv[])
+{
+  Logger::setLogLevel(Logger::WARN);
+  for (int i = 1; i < argc; ++i)
+  {
+    if (strcmp(argv[i], "-c") == 0)
+    {
+      g_coalescing = true;
+    }
+    else
+    {
+      g_numRequests = atoi(argv[i]);
+    }
+  }
+
+  EventLoop loop;
+  TcpServer server(&loop, InetAddress(kPort), "WriteCoalescingBench");
+  server.setConnectionCallback(onConnection);
+  server.setMessageCallback(boost::bind(onMessage, &loop, _1, _2, _3));
+  server.setWriteCoalescing(g_coalescing);
+  server.start();
+
+  Thread client(runClient, "client");
+  client.start();
+  loop.loop();
+  client.join();
+}
@@ -0,0 +1,66 @@
+#include <muduo/net/ZeroCopyCompletions.h>
+
+//#define BOOST_TEST_MODULE ZeroCopyCompletionsTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using muduo::net::ZeroCopyCompletions;
+
+BOOST_AUTO_TEST_CASE(testInOrder)
+{
+  ZeroCopyCompletions completions;
+  BOOST_CHECK(!completions.done(0));
+  completions.complete(0, 0);
+  BOOST_CHECK(completions.done(0));
+  BOOST_CHECK(!completions.done(1));
+  completions.complete(1, 5);
+  BOOST_CHECK(completions.done(5));
+  BOOST_CHECK(!completions.done(6));
+  BOOST_CHECK_EQUAL(completions.completed(), 6u);
+  BOOST_CHECK_EQUAL(completions.pendingRanges(), 0u);
+}
+
+// 后面的区间先到，前面的发送没完成，后面的也不算完成
+BOOST_AUTO_TEST_CASE(testOutOfOrder)
+{
+  ZeroCopyCompletions completions;
+  completions.complete(0, 2);
+  completions.complete(7, 9);
+  BOOST_CHECK(completions.done(2));
+  BOOST_CHECK(!completions.done(3));
+  BOOST_CHECK(!completions.done(7));
+  BOOST_CHECK(!completions.done(9));
+  BOOST_CHECK_EQUAL(completions.completed(), 3u);
+
+  completions.complete(5, 6);
+  BOOST_CHECK(!completions.done(5));
+  BOOST_CHECK_EQUAL(completions.pendingRanges(), 2u);
+
+  // 补上中间缺的，一直推到最后
+  completions.complete(3, 4);
+  BOOST_CHECK(completions.done(9));
+  BOOST_CHECK(!completions.done(10));
+  BOOST_CHECK_EQUAL(completions.completed(), 10u);
+  BOOST_CHECK_EQUAL(completions.pendingRanges(), 0u);
+
+  // 重复的通知不会往回退
+  completions.complete(8, 8);
+  BOOST_CHECK_EQUAL(completions.completed(), 10u);
+  BOOST_CHECK_EQUAL(completions.pendingRanges(), 0u);
+}
+
+// 32位序号回绕
+BOOST_AUTO_TEST_CASE(testWrapAround)
+{
+  ZeroCopyCompletions completions;
+  completions.complete(0, 0xfffffff0u);
+  BOOST_CHECK(completions.done(0xfffffff0u));
+  completions.complete(2, 3);
+  BOOST_CHECK(!completions.done(2));
+  completions.complete(0xfffffff1u, 1);
+  BOOST_CHECK(completions.done(0xffffffffu));
+  BOOST_CHECK(completions.done(3));
+  BOOST_CHECK(!completions.done(4));
+  BOOST_CHECK_EQUAL(completions.completed(), 4u);
+}
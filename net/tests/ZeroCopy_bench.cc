@@ -0,0 +1,144 @@
+// Loopback throughput of send(Buffer*) with and without MSG_ZEROCOPY.
+//
+// usage: zerocopy_bench [chunk_kb] [total_mb] [-z]
+//   -z  turns on TcpServer::setZeroCopyThreshold()
+//
+// On loopback the kernel falls back to copying for zero-copy sends,
+// the bench reports how many did so.  Point a real NIC at it for
+// meaningful numbers.
+
+#include <muduo/base/Logging.h>
+#include <muduo/base/Thread.h>
+#include <muduo/base/Timestamp.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/InetAddress.h>
+#include <muduo/net/SocketsOps.h>
+#include <muduo/net/TcpServer.h>
+
+#include <boost/bind.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const uint16_t kPort = 2009;
+
+size_t g_chunkSize = 1024*1024;
+int64_t g_totalBytes = 1024LL*1024*1024;
+bool g_zeroCopy = false;
+int64_t g_sentBytes = 0;
+string g_block;
+int64_t g_copied = 0;
+TcpConnectionPtr g_conn;
+
+void sendChunk(const TcpConnectionPtr& conn)
+{
+  if (g_sentBytes < g_totalBytes && conn->connected())
+  {
+    Buffer buf(g_chunkSize);
+    buf.append(g_block);
+    g_sentBytes += static_cast<int64_t>(buf.readableBytes());
+    conn->send(&buf);
+  }
+}
+
+void onConnection(const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    g_conn = conn;
+    sendChunk(conn);
+  }
+  else
+  {
+    g_copied = conn->zeroCopyCopiedCount();
+    g_conn.reset();
+  }
+}
+
+void finish(EventLoop* loop, double seconds)
+{
+  printf("%s: %.1f MiB in %.3f s, %.1f MiB/s",
+         g_zeroCopy ? "zerocopy" : "copy",
+         static_cast<double>(g_totalBytes) / (1024*1024), seconds,
+         static_cast<double>(g_totalBytes) / (1024*1024) / seconds);
+  if (g_zeroCopy)
+  {
+    int64_t copied = g_conn ? g_conn->zeroCopyCopiedCount() : g_copied;
+    printf(", %lld sends copied by kernel", static_cast<long long>(copied));
+  }
+  printf("\n");
+  loop->quit();
+}
+
+void runClient(EventLoop* loop)
+{
+  InetAddress serverAddr("127.0.0.1", kPort);
+  int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0 || sockets::connect(fd, serverAddr.getSockAddrInet()) < 0)
+  {
+    perror("connect");
+    loop->quit();
+    return;
+  }
+  std::vector<char> buf(256*1024);
+  int64_t received = 0;
+  Timestamp start(Timestamp::now());
+  while (received < g_totalBytes)
+  {
+    ssize_t n = ::read(fd, &buf[0], buf.size());
+    if (n <= 0)
+    {
+      perror("read");
+      break;
+    }
+    received += n;
+  }
+  double seconds = timeDifference(Timestamp::now(), start);
+  ::close(fd);
+  loop->runInLoop(boost::bind(finish, loop, seconds));
+}
+
+int main(int argc, char* argv[])
+{
+  Logger::setLogLevel(Logger::WARN);
+  int numArgs = 0;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (strcmp(argv[i], "-z") == 0)
+    {
+      g_zeroCopy = true;
+    }
+    else if (numArgs++ == 0)
+    {
+      g_chunkSize = static_cast<size_t>(atoi(argv[i])) * 1024;
+    }
+    else
+    {
+      g_totalBytes = static_cast<int64_t>(atoi(argv[i])) * 1024 * 1024;
+    }
+  }
+  g_block.assign(g_chunkSize, 'z');
+
+  EventLoop loop;
+  TcpServer server(&loop, InetAddress(kPort), "ZeroCopyBench");
+  server.setConnectionCallback(onConnection);
+  server.setWriteCompleteCallback(sendChunk);
+  if (g_zeroCopy)
+  {
+    server.setZeroCopyThreshold(g_chunkSize);
+  }
+  server.start();
+
+  Thread client(boost::bind(runClient, &loop), "client");
+  client.start();
+  loop.loop();
+  client.join();
+  g_conn.reset();
+}